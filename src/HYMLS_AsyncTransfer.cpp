@@ -0,0 +1,207 @@
+#include "HYMLS_AsyncTransfer.hpp"
+
+#include "HYMLS_Macros.hpp"
+#include "HYMLS_Tools.hpp"
+
+#include "Epetra_BlockMap.h"
+#include "Epetra_Distributor.h"
+#include "Epetra_Import.h"
+#include "Epetra_MultiVector.h"
+
+namespace HYMLS {
+
+AsyncTransfer::AsyncTransfer()
+  :
+  import_(NULL),
+  target_(NULL),
+  reverse_(false),
+  distributed_(false),
+  imports_(NULL),
+  lenImports_(0)
+  {
+  }
+
+AsyncTransfer::~AsyncTransfer()
+  {
+  if (Pending())
+    {
+    Tools::Warning("destroying a pending transfer", __FILE__, __LINE__);
+    }
+  delete [] imports_;
+  }
+
+int AsyncTransfer::PostImport(const Epetra_MultiVector &source,
+  Epetra_MultiVector &target, const Epetra_Import &import)
+  {
+  HYMLS_PROF3("AsyncTransfer", "PostImport");
+  // SameAs() would be a collective call, so we only check the local sizes
+  if (source.MyLength() != import.SourceMap().NumMyPoints() ||
+    target.MyLength() != import.TargetMap().NumMyPoints())
+    {
+    return -1;
+    }
+  return Post(source, target, import, false);
+  }
+
+int AsyncTransfer::PostExport(const Epetra_MultiVector &source,
+  Epetra_MultiVector &target, const Epetra_Import &import)
+  {
+  HYMLS_PROF3("AsyncTransfer", "PostExport");
+  if (source.MyLength() != import.TargetMap().NumMyPoints() ||
+    target.MyLength() != import.SourceMap().NumMyPoints())
+    {
+    return -1;
+    }
+  return Post(source, target, import, true);
+  }
+
+int AsyncTransfer::Post(const Epetra_MultiVector &source,
+  Epetra_MultiVector &target, const Epetra_Import &import, bool reverse)
+  {
+  if (Pending())
+    {
+    Tools::Error("there is already a pending transfer", __FILE__, __LINE__);
+    }
+
+  const int numVectors = source.NumVectors();
+  if (target.NumVectors() != numVectors)
+    {
+    return -2;
+    }
+
+  // For an export the roles of the source and target LIDs are swapped
+  const int numPermute = import.NumPermuteIDs();
+  const int *fromLIDs = reverse ? import.PermuteToLIDs() : import.PermuteFromLIDs();
+  const int *toLIDs = reverse ? import.PermuteFromLIDs() : import.PermuteToLIDs();
+  const int numSend = reverse ? import.NumRemoteIDs() : import.NumExportIDs();
+  const int *sendLIDs = reverse ? import.RemoteLIDs() : import.ExportLIDs();
+
+  // Copy the values that stay on this processor. Epetra also inserts these
+  // in case of an export with Add.
+  for (int k = 0; k < numVectors; k++)
+    {
+    const double *from = source[k];
+    double *to = target[k];
+    if (from != to)
+      {
+      for (int i = 0; i < import.NumSameIDs(); i++)
+        {
+        to[i] = from[i];
+        }
+      }
+    for (int i = 0; i < numPermute; i++)
+      {
+      to[toLIDs[i]] = from[fromLIDs[i]];
+      }
+    }
+
+  import_ = &import;
+  target_ = &target;
+  reverse_ = reverse;
+
+  // The Epetra_Import only has a distributor if the source map is
+  // distributed. Since that is the same on all processors, they either all
+  // communicate or none of them does.
+  distributed_ = import.SourceMap().DistributedGlobal();
+  if (!distributed_)
+    {
+    return 0;
+    }
+
+  if (exports_.size() < numSend * numVectors)
+    {
+    exports_.resize(numSend * numVectors);
+    }
+  for (int i = 0; i < numSend; i++)
+    {
+    for (int k = 0; k < numVectors; k++)
+      {
+      exports_[i * numVectors + k] = source[k][sendLIDs[i]];
+      }
+    }
+
+  char *exports = reinterpret_cast<char *>(exports_.getRawPtr());
+  const int objSize = numVectors * (int)sizeof(double);
+  if (reverse)
+    {
+    CHECK_ZERO(import.Distributor().DoReversePosts(exports, objSize,
+        lenImports_, imports_));
+    }
+  else
+    {
+    CHECK_ZERO(import.Distributor().DoPosts(exports, objSize,
+        lenImports_, imports_));
+    }
+  return 0;
+  }
+
+int AsyncTransfer::Wait()
+  {
+  if (!Pending())
+    {
+    return 0;
+    }
+
+  HYMLS_PROF3("AsyncTransfer", "Wait");
+
+  const Epetra_Import &import = *import_;
+  Epetra_MultiVector &target = *target_;
+  import_ = NULL;
+  target_ = NULL;
+
+  if (!distributed_)
+    {
+    return 0;
+    }
+
+  if (reverse_)
+    {
+    CHECK_ZERO(import.Distributor().DoReverseWaits());
+    }
+  else
+    {
+    CHECK_ZERO(import.Distributor().DoWaits());
+    }
+
+  const int numVectors = target.NumVectors();
+  const int numRecv = reverse_ ? import.NumExportIDs() : import.NumRemoteIDs();
+  const int *recvLIDs = reverse_ ? import.ExportLIDs() : import.RemoteLIDs();
+  const double *imports = reinterpret_cast<const double *>(imports_);
+
+  for (int i = 0; i < numRecv; i++)
+    {
+    for (int k = 0; k < numVectors; k++)
+      {
+      if (reverse_)
+        {
+        target[k][recvLIDs[i]] += imports[i * numVectors + k];
+        }
+      else
+        {
+        target[k][recvLIDs[i]] = imports[i * numVectors + k];
+        }
+      }
+    }
+  return 0;
+  }
+
+AsyncTransferGuard::~AsyncTransferGuard()
+  {
+  if (!transfer_.Pending())
+    {
+    return;
+    }
+
+  // We are unwinding from an exception, so we may not throw another one.
+  // Wait() resets the pending transfer before it receives anything.
+  try
+    {
+    transfer_.Wait();
+    }
+  catch (...)
+    {
+    Tools::Warning("could not finish a pending transfer", __FILE__, __LINE__);
+    }
+  }
+
+  }
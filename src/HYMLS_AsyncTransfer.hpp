@@ -0,0 +1,112 @@
+#ifndef HYMLS_ASYNC_TRANSFER_H
+#define HYMLS_ASYNC_TRANSFER_H
+
+#include "HYMLS_config.h"
+
+#include "Teuchos_Array.hpp"
+
+class Epetra_Import;
+class Epetra_MultiVector;
+
+namespace HYMLS {
+
+//! Non-blocking version of Epetra_MultiVector::Import and Export with an
+//! Epetra_Import object. Post() copies the local part of the transfer and
+//! sends the remote part, Wait() receives the remote part and combines it
+//! into the target. Work that does not depend on the remote values can be
+//! done in between, while the messages are in flight.
+//!
+//! The result is the same as that of target.Import(source, import, Insert)
+//! or target.Export(source, import, Add) respectively, so in case of an
+//! export the local values are inserted and only the received values are
+//! added. Only one transfer can be pending at a time, and both the import
+//! object and the target have to stay alive until Wait() returns.
+class AsyncTransfer
+  {
+public:
+
+  //! constructor
+  AsyncTransfer();
+
+  //! destructor
+  virtual ~AsyncTransfer();
+
+  //! start target.Import(source, import, Insert)
+  int PostImport(const Epetra_MultiVector &source, Epetra_MultiVector &target,
+    const Epetra_Import &import);
+
+  //! start target.Export(source, import, Add)
+  int PostExport(const Epetra_MultiVector &source, Epetra_MultiVector &target,
+    const Epetra_Import &import);
+
+  //! finish the pending transfer. Does nothing if there is none.
+  int Wait();
+
+  //! is there a transfer that has not been finished?
+  bool Pending() const {return import_ != NULL;}
+
+private:
+
+  //! not copyable because of the receive buffer
+  AsyncTransfer(const AsyncTransfer &);
+
+  //! not copyable because of the receive buffer
+  AsyncTransfer &operator=(const AsyncTransfer &);
+
+  //! copy the values that stay on this processor and send the others
+  int Post(const Epetra_MultiVector &source, Epetra_MultiVector &target,
+    const Epetra_Import &import, bool reverse);
+
+  //! import object of the pending transfer
+  const Epetra_Import *import_;
+
+  //! target of the pending transfer
+  Epetra_MultiVector *target_;
+
+  //! true for an export
+  bool reverse_;
+
+  //! is communication involved in the pending transfer?
+  bool distributed_;
+
+  //! packed values that are sent, all vectors of a row are contiguous
+  Teuchos::Array<double> exports_;
+
+  //! receive buffer. This is (re)allocated by the Epetra_Distributor with
+  //! new[], so it is not kept in a Teuchos::Array.
+  char *imports_;
+
+  //! size of the receive buffer in bytes
+  int lenImports_;
+
+  };
+
+//! Finishes a pending transfer when it goes out of scope. If an exception
+//! is thrown between the Post and the Wait(), the messages are still
+//! received, so the transfer can be used again by the next call.
+class AsyncTransferGuard
+  {
+public:
+
+  //! constructor
+  AsyncTransferGuard(AsyncTransfer &transfer) : transfer_(transfer) {}
+
+  //! calls Wait() on the transfer if it is still pending
+  ~AsyncTransferGuard();
+
+private:
+
+  //! not copyable
+  AsyncTransferGuard(const AsyncTransferGuard &);
+
+  //! not copyable
+  AsyncTransferGuard &operator=(const AsyncTransferGuard &);
+
+  //! the guarded transfer
+  AsyncTransfer &transfer_;
+
+  };
+
+  }
+
+#endif
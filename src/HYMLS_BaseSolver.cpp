@@ -6,6 +6,7 @@
 #include "HYMLS_MatrixUtils.hpp"
 #include "HYMLS_DenseUtils.hpp"
 #include "HYMLS_ProjectedOperator.hpp"
+#include "HYMLS_PipelinedGmresSolMgr.hpp"
 
 #include "Epetra_Comm.h"
 #include "Epetra_RowMatrix.h"
@@ -23,6 +24,7 @@
 
 #include "BelosBlockCGSolMgr.hpp"
 #include "BelosBlockGmresSolMgr.hpp"
+#include "BelosGCRODRSolMgr.hpp"
 //#include "BelosPCPGSolMgr.hpp"
 
 #include "Teuchos_StandardParameterEntryValidators.hpp"
@@ -32,6 +34,8 @@ using BelosGmresType = Belos::BlockGmresSolMgr<
   double, Epetra_MultiVector, Epetra_Operator>;
 using BelosCGType = Belos::BlockCGSolMgr<
   double, Epetra_MultiVector, Epetra_Operator>;
+using BelosGCRODRType = Belos::GCRODRSolMgr<
+  double, Epetra_MultiVector, Epetra_Operator>;
 
 namespace HYMLS {
 
@@ -45,7 +49,8 @@ BaseSolver::BaseSolver(Teuchos::RCP<const Epetra_Operator> K,
   operator_(K), precond_(P),
   massMatrix_(Teuchos::null),
   V_(Teuchos::null), W_(Teuchos::null),
-  useTranspose_(false), normInf_(-1.0), numIter_(0),
+  useTranspose_(false), keepRecycledSpace_(true),
+  normInf_(-1.0), numIter_(0),
   label_("HYMLS::BaseSolver"),
   lor_default_("Right")
   {
@@ -88,9 +93,20 @@ BaseSolver::BaseSolver(Teuchos::RCP<const Epetra_Operator> K,
     {
     belosSolverPtr_ = Teuchos::rcp(new BelosGmresType(belosProblemPtr_, belosListPtr));
     }
+  else if (solverType_=="Pipelined GMRES")
+    {
+    belosSolverPtr_ = Teuchos::rcp(new PipelinedGmresSolMgr(belosProblemPtr_, belosListPtr));
+    }
+  else if (solverType_=="GCRODR")
+    {
+    // The solver keeps its recycled subspace between calls to solve(), so
+    // every ApplyInverse() starts with the space of the previous one
+    belosSolverPtr_ = Teuchos::rcp(new BelosGCRODRType(belosProblemPtr_, belosListPtr));
+    }
   else
     {
-    Tools::Error("Currently only 'GMRES' is supported as 'Belos Solver'",__FILE__,__LINE__);
+    Tools::Error("'Krylov Method' = '" + solverType_ + "' is not supported, use "
+      "'GMRES', 'CG', 'Pipelined GMRES' or 'GCRODR'", __FILE__, __LINE__);
     }
   }
 
@@ -116,6 +132,15 @@ void BaseSolver::SetTolerance(double tol)
   belosSolverPtr_->setParameters(belosListPtr);
   }
 
+void BaseSolver::ResetRecycledSpace()
+  {
+  HYMLS_PROF3(label_, "ResetRecycledSpace");
+  if (belosSolverPtr_ != Teuchos::null && solverType_ == "GCRODR")
+    {
+    belosSolverPtr_->reset(::Belos::RecycleSubspace);
+    }
+  }
+
 void BaseSolver::SetPrecond(Teuchos::RCP<Epetra_Operator> P)
   {
   HYMLS_PROF3(label_,"SetPrecond");
@@ -223,6 +248,7 @@ void BaseSolver::setParameterList(const Teuchos::RCP<Teuchos::ParameterList>& Li
 
   solverType_= PL().get("Krylov Method","GMRES");
   startVec_=PL().get("Initial Vector","Random");
+  keepRecycledSpace_ = PL().get("Keep Recycled Space", keepRecycledSpace_);
   PL().get("Left or Right Preconditioning",lor_default_);
 
   if (belosSolverPtr_!=Teuchos::null)
@@ -252,9 +278,18 @@ Teuchos::RCP<const Teuchos::ParameterList> BaseSolver::getValidParameters() cons
   Teuchos::RCP<Teuchos::StringToIntegralParameterEntryValidator<int> >
     solverValidator = Teuchos::rcp(
       new Teuchos::StringToIntegralParameterEntryValidator<int>(
-        Teuchos::tuple<std::string>( "GMRES", "CG" ),"Krylov Method"));
+        Teuchos::tuple<std::string>( "GMRES", "CG", "Pipelined GMRES", "GCRODR" ),"Krylov Method"));
   VPL().set("Krylov Method", "GMRES",
-    "Type of Krylov method to be used", solverValidator);
+    "Type of Krylov method to be used. 'Pipelined GMRES' hides the global reductions\n"
+    " of the orthogonalization behind the next preconditioner and operator application\n"
+    " (not available with 'Use Bordering' or 'Complex').\n"
+    " 'GCRODR' recycles a subspace of harmonic Ritz vectors from one solve to the next\n"
+    " (set 'Num Recycled Blocks' in the 'Iterative Solver' list, not available with\n"
+    " 'Use Bordering' or 'Complex')", solverValidator);
+
+  VPL().set("Keep Recycled Space", true,
+    "with 'Krylov Method' = 'GCRODR', keep the recycled subspace when the preconditioner\n"
+    " is recomputed (see KeepRecycledSpace())");
 
   Teuchos::RCP<Teuchos::StringToIntegralParameterEntryValidator<int> >
     x0Validator = Teuchos::rcp(
@@ -132,6 +132,16 @@ public:
   //! get number of iterations performed in last ApplyInverse() call
   inline int getNumIter() const {return numIter_;}
 
+  //! With 'Krylov Method' = 'GCRODR', the subspace that is recycled from
+  //! one ApplyInverse() call to the next is discarded, e.g. because the
+  //! preconditioner or the operator changed too much.
+  virtual void ResetRecycledSpace();
+
+  //! Whether the recycled subspace should be kept when the preconditioner
+  //! is recomputed ("Keep Recycled Space"). The owner of the preconditioner
+  //! should call ResetRecycledSpace() otherwise.
+  bool KeepRecycledSpace() const {return keepRecycledSpace_;}
+
   //! For singular problems with a known null space, add the null space
   //! as a border so that in fact the linear system
   //!
@@ -207,6 +217,9 @@ protected:
 
   //! use transposed operator?
   bool useTranspose_;
+
+  //! keep the recycled subspace when the preconditioner is recomputed
+  bool keepRecycledSpace_;
   
   //! infinity norm
   double normInf_;
@@ -0,0 +1,435 @@
+#include "HYMLS_BatchedDenseSolver.hpp"
+
+#include "HYMLS_Macros.hpp"
+#include "HYMLS_Tools.hpp"
+
+#include "Epetra_CrsMatrix.h"
+#include "Epetra_MultiVector.h"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <vector>
+
+namespace HYMLS {
+
+BatchedDenseSolver::BatchedDenseSolver(int maxBatchSize)
+  :
+  maxBatchSize_(maxBatchSize),
+  numBlocks_(0),
+  computed_(false),
+  singularBlock_(-1),
+  computeFlops_(0.0),
+  applyInverseFlops_(0.0)
+  {
+  if (maxBatchSize_ < 1)
+    {
+    Tools::Error("the batch size should be positive", __FILE__, __LINE__);
+    }
+  }
+
+BatchedDenseSolver::~BatchedDenseSolver()
+  {
+  }
+
+int BatchedDenseSolver::Initialize(int numBlocks, const int *blockPtr, const int *rows)
+  {
+  HYMLS_PROF3("BatchedDenseSolver", "Initialize");
+
+  numBlocks_ = numBlocks;
+  blockPtr_.assign(blockPtr, blockPtr + numBlocks + 1);
+  rows_.assign(rows, rows + blockPtr[numBlocks]);
+  blockBatch_.assign(numBlocks, -1);
+  blockSlot_.assign(numBlocks, -1);
+  batches_.clear();
+  computed_ = false;
+  singularBlock_ = -1;
+
+  // blocks by size, in their original order
+  std::map<int, std::vector<int> > blocksOfSize;
+  for (int blk = 0; blk < numBlocks; blk++)
+    {
+    const int n = blockPtr[blk + 1] - blockPtr[blk];
+    if (n > 0)
+      {
+      blocksOfSize[n].push_back(blk);
+      }
+    }
+
+  for (auto const &entry : blocksOfSize)
+    {
+    const int n = entry.first;
+    std::vector<int> const &blocks = entry.second;
+    for (int first = 0; first < (int)blocks.size(); first += maxBatchSize_)
+      {
+      Batch batch;
+      batch.n = n;
+      batch.m = std::min(maxBatchSize_, (int)blocks.size() - first);
+      batch.pos.resize(n * batch.m);
+      for (int b = 0; b < batch.m; b++)
+        {
+        const int blk = blocks[first + b];
+        blockBatch_[blk] = batches_.size();
+        blockSlot_[blk] = b;
+        for (int i = 0; i < n; i++)
+          {
+          batch.pos[i * batch.m + b] = blockPtr[blk] + i;
+          }
+        }
+      batch.LU.resize(n * n * batch.m);
+      batch.piv.resize(n * batch.m);
+      batches_.append(batch);
+      }
+    }
+  return 0;
+  }
+
+int BatchedDenseSolver::Compute(const Epetra_CrsMatrix &A)
+  {
+  HYMLS_PROF3("BatchedDenseSolver", "Compute");
+
+  computed_ = false;
+  singularBlock_ = -1;
+
+  // batch, block and position of each local row
+  const int numMyRows = A.NumMyRows();
+  std::vector<int> batchOf(numMyRows, -1), blockOf(numMyRows), posOf(numMyRows);
+  for (int t = 0; t < batches_.size(); t++)
+    {
+    Batch const &batch = batches_[t];
+    for (int i = 0; i < batch.n; i++)
+      {
+      for (int b = 0; b < batch.m; b++)
+        {
+        const int lid = rows_[batch.pos[i * batch.m + b]];
+        batchOf[lid] = t;
+        blockOf[lid] = b;
+        posOf[lid] = i;
+        }
+      }
+    }
+
+  int len;
+  int *indices;
+  double *values;
+  for (int t = 0; t < batches_.size(); t++)
+    {
+    Batch &batch = batches_[t];
+    const int n = batch.n;
+    const int m = batch.m;
+
+    // This does the same as Ifpack_DenseContainer::Extract
+    std::fill(batch.LU.begin(), batch.LU.end(), 0.0);
+    for (int b = 0; b < m; b++)
+      {
+      for (int i = 0; i < n; i++)
+        {
+        CHECK_ZERO(A.ExtractMyRowView(rows_[batch.pos[i * m + b]], len, values, indices));
+        for (int k = 0; k < len; k++)
+          {
+          // skip off-processor elements
+          const int lcid = indices[k];
+          if (lcid >= numMyRows || batchOf[lcid] != t || blockOf[lcid] != b)
+            continue;
+          batch.LU[(i + posOf[lcid] * n) * m + b] = values[k];
+          }
+        }
+      }
+
+    // A singular block does not stop the factorization of the other
+    // blocks, so we can report the first singular one
+    int slot = Factor(batch) - 1;
+    if (slot >= 0)
+      {
+      int blk = 0;
+      while (blockBatch_[blk] != t || blockSlot_[blk] != slot)
+        {
+        blk++;
+        }
+      Tools::Warning("singular diagonal block " + Teuchos::toString(blk) +
+        " of size " + Teuchos::toString(n), __FILE__, __LINE__);
+      if (singularBlock_ < 0 || blk < singularBlock_)
+        {
+        singularBlock_ = blk;
+        }
+      }
+    computeFlops_ += 2.0 / 3.0 * n * n * n * m;
+    }
+
+  computed_ = (singularBlock_ < 0);
+  return computed_ ? 0 : 1;
+  }
+
+int BatchedDenseSolver::Factor(Batch &batch)
+  {
+  const int n = batch.n;
+  const int m = batch.m;
+  double *LU = batch.LU.getRawPtr();
+  int *piv = batch.piv.getRawPtr();
+
+  std::vector<double> amax(m);
+  std::vector<double> inv(m);
+  int singular = 0;
+
+  // Right-looking LU with partial pivoting like LAPACK's getf2, for all
+  // blocks at once
+  for (int j = 0; j < n; j++)
+    {
+    double *Ajj = LU + (j + j * n) * m;
+    int *pj = piv + j * m;
+
+    // find the pivot in column j of each block
+    for (int b = 0; b < m; b++)
+      {
+      amax[b] = std::abs(Ajj[b]);
+      pj[b] = j;
+      }
+    for (int i = j + 1; i < n; i++)
+      {
+      const double *Aij = LU + (i + j * n) * m;
+      for (int b = 0; b < m; b++)
+        {
+        const double a = std::abs(Aij[b]);
+        if (a > amax[b])
+          {
+          amax[b] = a;
+          pj[b] = i;
+          }
+        }
+      }
+    for (int b = 0; b < m; b++)
+      {
+      if (amax[b] == 0.0 && (singular == 0 || b + 1 < singular))
+        {
+        singular = b + 1;
+        }
+      }
+
+    // swap rows j and pj over all columns
+    for (int k = 0; k < n; k++)
+      {
+      double *Ak = LU + k * n * m;
+      for (int b = 0; b < m; b++)
+        {
+        const int p = pj[b];
+        const double tmp = Ak[j * m + b];
+        Ak[j * m + b] = Ak[p * m + b];
+        Ak[p * m + b] = tmp;
+        }
+      }
+
+    // compute the multipliers
+    // a zero pivot only occurs in a singular block, whose factors are
+    // not used, so we avoid the division by zero
+    for (int b = 0; b < m; b++)
+      {
+      inv[b] = amax[b] == 0.0 ? 0.0 : 1.0 / Ajj[b];
+      }
+    for (int i = j + 1; i < n; i++)
+      {
+      double *Aij = LU + (i + j * n) * m;
+      for (int b = 0; b < m; b++)
+        {
+        Aij[b] *= inv[b];
+        }
+      }
+
+    // update the trailing submatrix
+    for (int k = j + 1; k < n; k++)
+      {
+      const double *Ajk = LU + (j + k * n) * m;
+      for (int i = j + 1; i < n; i++)
+        {
+        const double *Aij = LU + (i + j * n) * m;
+        double *Aik = LU + (i + k * n) * m;
+        for (int b = 0; b < m; b++)
+          {
+          Aik[b] -= Aij[b] * Ajk[b];
+          }
+        }
+      }
+    }
+  return singular;
+  }
+
+void BatchedDenseSolver::AddApplyInverseFlops(double flops) const
+  {
+  double old = applyInverseFlops_.load(std::memory_order_relaxed);
+  while (!applyInverseFlops_.compare_exchange_weak(old, old + flops,
+      std::memory_order_relaxed))
+    {
+    }
+  }
+
+int BatchedDenseSolver::ApplyInverse(const Epetra_MultiVector &B,
+  Epetra_MultiVector &X) const
+  {
+  return ApplyInverse(B, X, rows_.getRawPtr(), rows_.getRawPtr());
+  }
+
+int BatchedDenseSolver::ApplyInverse(const Epetra_MultiVector &B,
+  Epetra_MultiVector &X, const int *gatherLIDs, const int *scatterLIDs) const
+  {
+  HYMLS_PROF3("BatchedDenseSolver", "ApplyInverse");
+
+  const int numVectors = X.NumVectors();
+  if (B.NumVectors() != numVectors)
+    {
+    return -1;
+    }
+  if (!computed_)
+    {
+    return -2;
+    }
+
+  for (int t = 0; t < batches_.size(); t++)
+    {
+    Batch const &batch = batches_[t];
+    const int n = batch.n;
+    const int m = batch.m;
+    const double *LU = batch.LU.getRawPtr();
+    const int *piv = batch.piv.getRawPtr();
+    const int *pos = batch.pos.getRawPtr();
+
+    // right-hand sides of all blocks, entry i of vector k of block b is
+    // at x[(i+k*n)*m+b]
+    if (work_.size() < n * numVectors * m)
+      {
+      work_.resize(n * numVectors * m);
+      }
+    double *x = work_.getRawPtr();
+
+    for (int k = 0; k < numVectors; k++)
+      {
+      const double *Bk = B[k];
+      double *xk = x + k * n * m;
+      for (int i = 0; i < n * m; i++)
+        {
+        xk[i] = Bk[gatherLIDs[pos[i]]];
+        }
+      }
+
+    for (int k = 0; k < numVectors; k++)
+      {
+      double *xk = x + k * n * m;
+
+      // apply the row interchanges
+      for (int j = 0; j < n; j++)
+        {
+        const int *pj = piv + j * m;
+        for (int b = 0; b < m; b++)
+          {
+          const int p = pj[b];
+          const double tmp = xk[j * m + b];
+          xk[j * m + b] = xk[p * m + b];
+          xk[p * m + b] = tmp;
+          }
+        }
+
+      // forward solve with the unit lower triangular L
+      for (int j = 0; j < n; j++)
+        {
+        const double *xj = xk + j * m;
+        for (int i = j + 1; i < n; i++)
+          {
+          const double *Lij = LU + (i + j * n) * m;
+          double *xi = xk + i * m;
+          for (int b = 0; b < m; b++)
+            {
+            xi[b] -= Lij[b] * xj[b];
+            }
+          }
+        }
+
+      // backward solve with U
+      for (int j = n - 1; j >= 0; j--)
+        {
+        const double *Ujj = LU + (j + j * n) * m;
+        double *xj = xk + j * m;
+        for (int b = 0; b < m; b++)
+          {
+          xj[b] /= Ujj[b];
+          }
+        for (int i = 0; i < j; i++)
+          {
+          const double *Uij = LU + (i + j * n) * m;
+          double *xi = xk + i * m;
+          for (int b = 0; b < m; b++)
+            {
+            xi[b] -= Uij[b] * xj[b];
+            }
+          }
+        }
+      }
+
+    for (int k = 0; k < numVectors; k++)
+      {
+      double *Xk = X[k];
+      const double *xk = x + k * n * m;
+      for (int i = 0; i < n * m; i++)
+        {
+        Xk[scatterLIDs[pos[i]]] = xk[i];
+        }
+      }
+
+    AddApplyInverseFlops(2.0 * n * n * m * numVectors);
+    }
+  return 0;
+  }
+
+int BatchedDenseSolver::ApplyInverse(int blk, int numVectors, double *X, int ldx) const
+  {
+  if (!computed_)
+    {
+    return -2;
+    }
+
+  const int t = blockBatch_[blk];
+  if (t < 0)
+    {
+    // empty block
+    return 0;
+    }
+
+  Batch const &batch = batches_[t];
+  const int n = batch.n;
+  const int m = batch.m;
+
+  // the factors of this block, with stride m
+  const double *LU = batch.LU.getRawPtr() + blockSlot_[blk];
+  const int *piv = batch.piv.getRawPtr() + blockSlot_[blk];
+
+  for (int k = 0; k < numVectors; k++)
+    {
+    double *x = X + k * ldx;
+
+    for (int j = 0; j < n; j++)
+      {
+      const int p = piv[j * m];
+      const double tmp = x[j];
+      x[j] = x[p];
+      x[p] = tmp;
+      }
+
+    for (int j = 0; j < n; j++)
+      {
+      for (int i = j + 1; i < n; i++)
+        {
+        x[i] -= LU[(i + j * n) * m] * x[j];
+        }
+      }
+
+    for (int j = n - 1; j >= 0; j--)
+      {
+      x[j] /= LU[(j + j * n) * m];
+      for (int i = 0; i < j; i++)
+        {
+        x[i] -= LU[(i + j * n) * m] * x[j];
+        }
+      }
+    }
+  AddApplyInverseFlops(2.0 * n * n * numVectors);
+  return 0;
+  }
+
+  }
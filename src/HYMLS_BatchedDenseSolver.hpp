@@ -0,0 +1,142 @@
+#ifndef HYMLS_BATCHED_DENSE_SOLVER_H
+#define HYMLS_BATCHED_DENSE_SOLVER_H
+
+#include "HYMLS_config.h"
+
+#include "Teuchos_Array.hpp"
+
+#include <atomic>
+
+class Epetra_CrsMatrix;
+class Epetra_MultiVector;
+
+namespace HYMLS {
+
+//! Solver for many small dense diagonal blocks of a sparse matrix. Blocks
+//! of the same size are stored together in batches, interleaved so that
+//! entry (i,j) of all blocks of a batch is contiguous in memory. The LU
+//! factorization with partial pivoting and the solves then loop over the
+//! blocks of a batch in the innermost loop, which the compiler can
+//! vectorize. This replaces one Ifpack_DenseContainer per block, which
+//! copies every entry through virtual function calls.
+class BatchedDenseSolver
+  {
+public:
+
+  //! constructor. At most maxBatchSize blocks are stored in a batch, so
+  //! that the factors of a batch stay in the cache.
+  BatchedDenseSolver(int maxBatchSize = 64);
+
+  //! destructor
+  virtual ~BatchedDenseSolver();
+
+  //! set up the blocks. The local rows of block i are
+  //! rows[blockPtr[i]], ..., rows[blockPtr[i+1]-1].
+  int Initialize(int numBlocks, const int *blockPtr, const int *rows);
+
+  //! extract the diagonal blocks from A and factor them. Entries of A
+  //! outside the diagonal blocks are ignored. All blocks are factored
+  //! even if some of them are singular. In that case a positive value is
+  //! returned, SingularBlock() is the first singular block and the solver
+  //! is not computed.
+  int Compute(const Epetra_CrsMatrix &A);
+
+  //! true if Compute() was called and none of the blocks is singular
+  bool IsComputed() const {return computed_;}
+
+  //! the first singular block in the last Compute(), or -1
+  int SingularBlock() const {return singularBlock_;}
+
+  //! solve the block diagonal system for the rows of the blocks. The
+  //! other rows of X are not touched.
+  int ApplyInverse(const Epetra_MultiVector &B, Epetra_MultiVector &X) const;
+
+  //! solve the block diagonal system for vectors with a different map
+  //! than the matrix. The local index in B and X of the row that is
+  //! rows[i] in the matrix is gatherLIDs[i] and scatterLIDs[i].
+  int ApplyInverse(const Epetra_MultiVector &B, Epetra_MultiVector &X,
+    const int *gatherLIDs, const int *scatterLIDs) const;
+
+  //! solve with block blk only. X(i,k) = X[i+k*ldx] is row i of the k-th
+  //! right-hand side on input and of the solution on output. This may be
+  //! called for different blocks concurrently.
+  int ApplyInverse(int blk, int numVectors, double *X, int ldx) const;
+
+  //! number of blocks
+  int NumBlocks() const {return numBlocks_;}
+
+  //! number of rows of block blk
+  int NumRows(int blk) const {return blockPtr_[blk+1] - blockPtr_[blk];}
+
+  //! number of batches
+  int NumBatches() const {return batches_.size();}
+
+  //! flops in Compute()
+  double ComputeFlops() const {return computeFlops_;}
+
+  //! flops in all ApplyInverse() variants
+  double ApplyInverseFlops() const {return applyInverseFlops_.load(std::memory_order_relaxed);}
+
+protected:
+
+  //! blocks of the same size
+  struct Batch
+    {
+    //! number of rows of each block
+    int n;
+
+    //! number of blocks
+    int m;
+
+    //! row i of block b is rows_[pos[i*m+b]]
+    Teuchos::Array<int> pos;
+
+    //! LU factors, entry (i,j) of block b is LU[(i+j*n)*m+b]
+    Teuchos::Array<double> LU;
+
+    //! row that was swapped with row j in block b is piv[j*m+b]
+    Teuchos::Array<int> piv;
+    };
+
+  //! factor the blocks of a batch in place. Returns one plus the position
+  //! in the batch of the first singular block, or 0.
+  int Factor(Batch &batch);
+
+  //! add to the ApplyInverse() flops. This may be called concurrently.
+  void AddApplyInverseFlops(double flops) const;
+
+  //! maximum number of blocks in a batch
+  int maxBatchSize_;
+
+  //! total number of blocks
+  int numBlocks_;
+
+  //! the blocks as passed to Initialize()
+  Teuchos::Array<int> blockPtr_, rows_;
+
+  //! batch of each block and position of the block in the batch
+  Teuchos::Array<int> blockBatch_, blockSlot_;
+
+  //! the batches
+  Teuchos::Array<Batch> batches_;
+
+  //! work space for ApplyInverse()
+  mutable Teuchos::Array<double> work_;
+
+  //! the factorization succeeded
+  bool computed_;
+
+  //! first singular block in the last Compute(), or -1
+  int singularBlock_;
+
+  //! flops in Compute()
+  double computeFlops_;
+
+  //! flops in ApplyInverse()
+  mutable std::atomic<double> applyInverseFlops_;
+
+  };
+
+  }
+
+#endif
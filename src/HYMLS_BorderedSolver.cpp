@@ -62,7 +62,10 @@ BorderedSolver::BorderedSolver(Teuchos::RCP<const Epetra_Operator> K,
     }
   else
     {
-    Tools::Error("Currently only 'GMRES' is supported as 'Belos Solver'",__FILE__,__LINE__);
+    // Pipelined GMRES is only implemented for Epetra vectors, and the
+    // recycling of GCRODR is only set up for those (see BaseSolver)
+    Tools::Error("'Krylov Method' = '" + solverType_ + "' is not supported with "
+      "'Use Bordering', use 'GMRES' or 'CG'", __FILE__, __LINE__);
     }
   }
 
@@ -36,6 +36,7 @@
 #include "HYMLS_AugmentedMatrix.hpp"
 
 #include <iostream>
+#include <algorithm>
 
 namespace HYMLS
   {
@@ -53,7 +54,9 @@ CoarseSolver::CoarseSolver(
   haveBorder_(false),
   label_("CoarseSolver"),
   isEmpty_(false),
-  initialized_(false), computed_(false)
+  initialized_(false), computed_(false),
+  reuseSymbolic_(false), canRefresh_(false),
+  patternChecked_(false), samePattern_(false)
   {
   }
 
@@ -95,6 +98,9 @@ int CoarseSolver::SetParameters(Teuchos::ParameterList& List)
 
   HYMLS_DEBVAR(fix_gid_);
 
+  reuseSymbolic_ = PL().sublist("Coarse Solver").get(
+    "Reuse Symbolic Factorization", false);
+
   return 0;
   }
 
@@ -102,6 +108,28 @@ int CoarseSolver::Initialize()
   {
   HYMLS_LPROF2(label_, "Initialize");
 
+  // If the pattern is the same, Compute() only refreshes the values, so
+  // we keep everything we have. Compute() uses the result of this check.
+  samePattern_ = reuseSymbolic_ && canRefresh_ && SamePattern();
+  patternChecked_ = true;
+  if (!samePattern_)
+    {
+    CHECK_ZERO(CreateStructures());
+    computed_ = false;
+    }
+
+  initialized_ = true;
+  haveBorder_ = false;
+
+  return 0;
+  }
+
+int CoarseSolver::CreateStructures()
+  {
+  HYMLS_LPROF3(label_, "CreateStructures");
+
+  canRefresh_ = false;
+
   // reindex the reduced system, this seems to be a good idea when
   // solving it using Ifpack_Amesos
   Epetra_BlockMap const &map = matrix_->Map();
@@ -116,9 +144,89 @@ int CoarseSolver::Initialize()
   restrictX_ = Teuchos::rcp(new ::HYMLS::EpetraExt::RestrictedMultiVectorWrapper());
   restrictB_ = Teuchos::rcp(new ::HYMLS::EpetraExt::RestrictedMultiVectorWrapper());
 
-  initialized_ = true;
-  computed_ = false;
-  haveBorder_ = false;
+  // the vectors are restricted with the wrappers above in ApplyInverse()
+  linearRhs_ = Teuchos::null;
+  linearSol_ = Teuchos::null;
+
+  return 0;
+  }
+
+bool CoarseSolver::SamePattern() const
+  {
+  HYMLS_LPROF3(label_, "SamePattern");
+
+  int same = 1;
+  if (matrix_->NumMyRows() != patternRows_.size() ||
+    matrix_->NumMyNonzeros() != patternCols_.size())
+    {
+    same = 0;
+    }
+
+  int len;
+  double *values;
+  int *indices;
+  for (int i = 0; same && i < matrix_->NumMyRows(); i++)
+    {
+    CHECK_ZERO(matrix_->ExtractMyRowView(i, len, values, indices));
+    if (matrix_->GRID64(i) != patternRows_[i] ||
+      len != patternRowPtr_[i + 1] - patternRowPtr_[i])
+      {
+      same = 0;
+      break;
+      }
+    for (int j = 0; j < len; j++)
+      {
+      if (matrix_->GCID64(indices[j]) != patternCols_[patternRowPtr_[i] + j])
+        {
+        same = 0;
+        break;
+        }
+      }
+    }
+
+  // Initialize() and Compute() are collective, so all processors have to
+  // agree on this
+  int allSame;
+  CHECK_ZERO(comm_->MinAll(&same, &allSame, 1));
+  return allSame == 1;
+  }
+
+int CoarseSolver::RefreshValues()
+  {
+  HYMLS_LPROF2(label_, "RefreshValues");
+
+  // Entries that were dropped in the last full Compute() stay dropped
+  CHECK_ZERO(reducedSchur_->PutScalar(0.0));
+  CHECK_ZERO(MatrixUtils::CopyValues(*matrix_, valueRows_,
+      *reducedSchur_, valueRows_, valuePlan_));
+
+  for (int i = 0; i < fix_gid_.length(); i++)
+    {
+    CHECK_ZERO(MatrixUtils::PutDirichlet(*reducedSchur_, fix_gid_[i]));
+    }
+
+  // The reindexed and restricted matrices are views of reducedSchur_, only
+  // the serial restricted matrix is a copy
+  if (restrictedMatrix_ != Teuchos::null &&
+    Teuchos::rcp_dynamic_cast<const Epetra_MpiComm>(comm_) == Teuchos::null)
+    {
+    int len;
+    double *values, *restrictedValues;
+    for (int i = 0; i < linearMatrix_->NumMyRows(); i++)
+      {
+      CHECK_ZERO(linearMatrix_->ExtractMyRowView(i, len, values));
+      CHECK_ZERO(restrictedMatrix_->ExtractMyRowView(i, len, restrictedValues));
+      std::copy(values, values + len, restrictedValues);
+      }
+    }
+
+  if (amActive_)
+    {
+    HYMLS_DEBUG("Refactor direct solver");
+    CHECK_ZERO(reducedSchurSolver_->Compute());
+    }
+
+  computed_ = true;
 
   return 0;
   }
@@ -132,6 +240,27 @@ int CoarseSolver::Compute()
   {
   HYMLS_LPROF(label_, "Compute");
 
+  if (computed_ && canRefresh_ && reuseSymbolic_ && !HaveBorder())
+    {
+    // The pattern was already checked in Initialize(), unless the matrix
+    // was replaced after that
+    if (!patternChecked_)
+      {
+      samePattern_ = SamePattern();
+      patternChecked_ = true;
+      }
+    if (samePattern_)
+      {
+      return RefreshValues();
+      }
+    CHECK_ZERO(CreateStructures());
+    }
+  else if (computed_)
+    {
+    // the wrappers can only be used once
+    CHECK_ZERO(CreateStructures());
+    }
+
   // drop numerical zeros. We need to copy the matrix anyway because
   // we may want to put in some artificial Dirichlet conditions.
 #ifdef HYMLS_TESTING
@@ -242,6 +371,37 @@ int CoarseSolver::Compute()
     CHECK_ZERO(reducedSchurSolver_->Compute());
     }
 
+  // Store the pattern so that the next Compute() can reuse everything. In
+  // the bordered case the augmented matrix is a copy, so we do not do this.
+  if (reuseSymbolic_ && !HaveBorder())
+    {
+    const int numRows = matrix_->NumMyRows();
+    patternRows_.resize(numRows);
+    patternRowPtr_.resize(numRows + 1);
+    patternCols_.resize(matrix_->NumMyNonzeros());
+    valueRows_.resize(numRows);
+    patternRowPtr_[0] = 0;
+    int len;
+    double *values;
+    int *indices;
+    for (int i = 0; i < numRows; i++)
+      {
+      CHECK_ZERO(matrix_->ExtractMyRowView(i, len, values, indices));
+      patternRows_[i] = matrix_->GRID64(i);
+      patternRowPtr_[i + 1] = patternRowPtr_[i] + len;
+      for (int j = 0; j < len; j++)
+        {
+        patternCols_[patternRowPtr_[i] + j] = matrix_->GCID64(indices[j]);
+        }
+      valueRows_[i] = i;
+      }
+    CHECK_ZERO(MatrixUtils::CreateValueCopyPlan(*matrix_, valueRows_,
+        *reducedSchur_, valueRows_, valuePlan_));
+    canRefresh_ = true;
+    samePattern_ = true;
+    patternChecked_ = true;
+    }
+
   computed_ = true;
 
   return 0;
@@ -54,6 +54,20 @@ public:
 
   virtual ~CoarseSolver() {}
 
+  //! Replace the matrix. If "Reuse Symbolic Factorization" is set in the
+  //! "Coarse Solver" sublist and the new matrix has the same pattern, the
+  //! next Initialize() and Compute() only refresh the values and the
+  //! numerical factorization.
+  void SetMatrix(Teuchos::RCP<const Epetra_CrsMatrix> matrix)
+    {
+    matrix_ = matrix;
+    patternChecked_ = false;
+    }
+
+  //! Whether "Reuse Symbolic Factorization" is set, in which case the
+  //! solver should be kept and given the next matrix with SetMatrix()
+  bool ReuseSymbolic() const {return reuseSymbolic_;}
+
   //! \name ParameterListAcceptor interface
   //@{
 
@@ -185,6 +199,17 @@ public:
 
 protected:
 
+  //! create the maps and wrappers that Compute() fills
+  int CreateStructures();
+
+  //! check if matrix_ has the same pattern as the matrix of the last full
+  //! Compute() on all processors
+  bool SamePattern() const;
+
+  //! copy the new values of matrix_ into the existing matrices and only
+  //! redo the numerical factorization
+  int RefreshValues();
+
   //! communicator
   Teuchos::RCP<const Epetra_Comm> comm_;
 
@@ -257,6 +282,30 @@ protected:
   //! augmented matrix for V-sums, [M22 V2; W2 C]
   Teuchos::RCP<Epetra_RowMatrix> augmentedMatrix_;
 
+  //! \name data structures for reusing the pattern
+
+  //! keep the structures and the symbolic factorization if the pattern of
+  //! the matrix does not change ("Reuse Symbolic Factorization")
+  bool reuseSymbolic_;
+
+  //! true if the last Compute() stored the pattern below
+  bool canRefresh_;
+
+  //! true if samePattern_ is the result of SamePattern() for matrix_
+  bool patternChecked_;
+
+  //! matrix_ has the stored pattern on all processors
+  bool samePattern_;
+
+  //! row GIDs, start of each row and column GIDs of the matrix of the last
+  //! full Compute()
+  Teuchos::Array<hymls_gidx> patternRows_;
+  Teuchos::Array<int> patternRowPtr_;
+  Teuchos::Array<hymls_gidx> patternCols_;
+
+  //! local rows of the matrix and positions of its values in reducedSchur_
+  Teuchos::Array<int> valueRows_, valuePlan_;
+
   };
 
   }
@@ -447,6 +447,8 @@ HierarchicalMap::SpawnInterior() const
   for (int sd = 0; sd < NumMySubdomains(); sd++)
     num_interior_elements += GetInteriorGroup(sd).length();
 
+  // Keep the interior nodes of each subdomain together and in the order
+  // of the group. The subdomain solvers use the same order.
   hymls_gidx *myElements = new hymls_gidx[num_interior_elements];
   int pos = 0;
   for (int sd = 0; sd < NumMySubdomains(); sd++)
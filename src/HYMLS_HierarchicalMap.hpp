@@ -98,7 +98,13 @@ public:
     subdomains but only one group per subdomain,
     the interior nodes. The new object's Map() is
     a map without overlap that contains only the
-    interior nodes of this object.
+    interior nodes of this object. The map is
+    ordered subdomain by subdomain and within a
+    subdomain in the order of its interior group,
+    so the interior nodes of each subdomain form
+    one contiguous range of local indices.
+    MatrixBlock::ApplyInverse relies on this to
+    solve the subdomain problems in place.
 
     strat==Separators: the new object contains all the local separator
     groups as new interior groups (each group forms
@@ -12,6 +12,8 @@
 #include "Epetra_MultiVector.h"
 #include "EpetraExt_MatrixMatrix.h"
 
+#include <vector>
+
 double sign(double x)
   {
   return (x < 0) ? -1 : (x > 0);
@@ -134,31 +136,45 @@ int Householder::Construct(Epetra_CrsMatrix& H,
   Epetra_SerialDenseVector v) const
   {
   HYMLS_PROF3(label_, "Construct (3)");
-  // v is the test vector to be zeroed out by this transform,
-  // construct the according v for the Householder reflection:
   int n = v.Length();
   hymls_gidx row = inds[0];
+
+  Epetra_SerialDenseVector w;
+  CHECK_ZERO(Construct(w, v));
+
+  if (w.NormInf() == 0.0)
+      return 0;
+
+  if (H.Filled())
+    {
+    CHECK_ZERO(H.ReplaceGlobalValues(row,n,w.A(),const_cast<hymls_gidx*>(&(inds[0]))));
+    }
+  else
+    {
+    CHECK_NONNEG(H.InsertGlobalValues(row,n,w.A(),const_cast<hymls_gidx*>(&(inds[0]))));
+    }
+  return 0;
+  }
+
+int Householder::Construct(Epetra_SerialDenseVector& w,
+  Epetra_SerialDenseVector v) const
+  {
+  // v is the test vector to be zeroed out by this transform,
+  // construct the according v for the Householder reflection:
   double nrm = v.Norm2();
-  
+
   // Scale with the first element of the test vector to assure
   // that the first element is always positive
   CHECK_ZERO(v.Scale(sign(v[0])));
   v[0] = v[0] + nrm;
   nrm = v.Norm2();
 
+  CHECK_ZERO(w.Size(v.Length()));
   if (nrm < HYMLS_SMALL_ENTRY)
       return 0;
 
-  CHECK_ZERO(v.Scale(1.0 / nrm));
-
-  if (H.Filled())
-    {
-    CHECK_ZERO(H.ReplaceGlobalValues(row,n,v.A(),const_cast<hymls_gidx*>(&(inds[0]))));
-    }
-  else
-    {
-    CHECK_NONNEG(H.InsertGlobalValues(row,n,v.A(),const_cast<hymls_gidx*>(&(inds[0]))));
-    }
+  w = v;
+  CHECK_ZERO(w.Scale(1.0 / nrm));
   return 0;
   }
 
@@ -368,4 +384,204 @@ int Householder::ApplyInverse(
   return this->Apply(Tv,T,v);
   }
 
+// (2ww'-I)v for each group, which we compute as x=-v, x=x-2(w'x)w, so that
+// the rows that are not in any group end up with -v like in the sparse variant.
+int Householder::Apply(Epetra_MultiVector& v, int numGroups,
+  const int *groupPtr, const int *lids, const double *W) const
+  {
+  HYMLS_PROF2(label_,"H*v (grouped)");
+
+  const int numVectors = v.NumVectors();
+  CHECK_ZERO(v.Scale(-1.0));
+
+  double **x = v.Pointers();
+  for (int g = 0; g < numGroups; g++)
+    {
+    const int len = groupPtr[g+1] - groupPtr[g];
+    const int *l = lids + groupPtr[g];
+    const double *w = W + groupPtr[g];
+
+    // The groups are usually contiguous in the vector, in which case we
+    // can use unit-stride loops that the compiler can vectorize
+    if (len > 0 && l[len-1] - l[0] == len - 1)
+      {
+      for (int k = 0; k < numVectors; k++)
+        {
+        double *xk = x[k] + l[0];
+        double d = 0.0;
+        for (int i = 0; i < len; i++)
+          {
+          d += w[i] * xk[i];
+          }
+        d *= 2.0;
+        for (int i = 0; i < len; i++)
+          {
+          xk[i] -= d * w[i];
+          }
+        }
+      }
+    else
+      {
+      for (int k = 0; k < numVectors; k++)
+        {
+        double *xk = x[k];
+        double d = 0.0;
+        for (int i = 0; i < len; i++)
+          {
+          d += w[i] * xk[l[i]];
+          }
+        d *= 2.0;
+        for (int i = 0; i < len; i++)
+          {
+          xk[l[i]] -= d * w[i];
+          }
+        }
+      }
+    }
+  return 0;
+  }
+
+int Householder::ApplyInverse(Epetra_MultiVector& v, int numGroups,
+  const int *groupPtr, const int *lids, const double *W) const
+  {
+  return this->Apply(v, numGroups, groupPtr, lids, W);
+  }
+
+// H'AH=HAH because H is symmetric. The row transform only needs the local rows
+// of a group, so we compute it as H(HA')', where the transposes take care of
+// the communication for the column transform. No sparse matrix-matrix products
+// and no representation of H as a sparse matrix are needed.
+Teuchos::RCP<Epetra_CrsMatrix> Householder::Apply(const Epetra_CrsMatrix& A,
+  int numGroups, const int *groupPtr, const int *lids, const double *W) const
+  {
+  HYMLS_PROF2(label_,"H^TAH (grouped)");
+
+  if (!A.Filled())
+    {
+    Tools::Error("A not filled!",__FILE__,__LINE__);
+    }
+
+#ifdef HYMLS_STORE_MATRICES
+  MatrixUtils::Dump(A, "HOUSE_A.txt");
+#endif
+
+  HYMLS_DEBUG("compute A'...");
+  Teuchos::RCP<Epetra_CrsMatrix> AT = Transpose(A);
+
+  HYMLS_DEBUG("compute HA'...");
+  Teuchos::RCP<Epetra_CrsMatrix> HAT = ApplyRows(*AT, numGroups, groupPtr, lids, W);
+  AT = Teuchos::null;
+
+  HYMLS_DEBUG("compute AH=(HA')'...");
+  Teuchos::RCP<Epetra_CrsMatrix> AH = Transpose(*HAT);
+  HAT = Teuchos::null;
+
+#ifdef HYMLS_STORE_MATRICES
+  MatrixUtils::Dump(*AH, "HOUSE_C.txt");
+#endif
+
+  HYMLS_DEBUG("compute HAH...");
+  Teuchos::RCP<Epetra_CrsMatrix> HAH = ApplyRows(*AH, numGroups, groupPtr, lids, W);
+
+  HYMLS_DEBUG("done!");
+  return HAH;
+  }
+
+// For each group we first form d=sum_i w_i A(l_i,:) on the union of the
+// sparsity patterns of the rows of the group, after which the new rows are
+// 2w_i d - A(l_i,:) on that same pattern.
+Teuchos::RCP<Epetra_CrsMatrix> Householder::ApplyRows(const Epetra_CrsMatrix& A,
+  int numGroups, const int *groupPtr, const int *lids, const double *W) const
+  {
+  HYMLS_PROF3(label_,"H*A (grouped)");
+
+  const int numRows = A.NumMyRows();
+  const int numCols = A.NumMyCols();
+
+  // we only use the column indices of A, so the column map can be reused
+  Teuchos::RCP<Epetra_CrsMatrix> HA = Teuchos::rcp(new
+    Epetra_CrsMatrix(Copy, A.RowMap(), A.ColMap(), A.MaxNumEntries()));
+
+  std::vector<double> d(numCols, 0.0), row(numCols, 0.0), values;
+  std::vector<int> mark(numCols, -1), pattern;
+  std::vector<bool> inGroup(numRows, false);
+
+  int len;
+  int *indices;
+  double *vals;
+
+  for (int g = 0; g < numGroups; g++)
+    {
+    pattern.clear();
+    for (int k = groupPtr[g]; k < groupPtr[g+1]; k++)
+      {
+      inGroup[lids[k]] = true;
+      CHECK_ZERO(A.ExtractMyRowView(lids[k], len, vals, indices));
+      for (int j = 0; j < len; j++)
+        {
+        const int col = indices[j];
+        if (mark[col] != g)
+          {
+          mark[col] = g;
+          d[col] = 0.0;
+          pattern.push_back(col);
+          }
+        d[col] += W[k] * vals[j];
+        }
+      }
+
+    const int nnz = pattern.size();
+    values.resize(nnz);
+    for (int k = groupPtr[g]; k < groupPtr[g+1]; k++)
+      {
+      CHECK_ZERO(A.ExtractMyRowView(lids[k], len, vals, indices));
+      for (int j = 0; j < len; j++)
+        {
+        row[indices[j]] = vals[j];
+        }
+      const double w2 = 2.0 * W[k];
+      for (int j = 0; j < nnz; j++)
+        {
+        values[j] = w2 * d[pattern[j]] - row[pattern[j]];
+        }
+      for (int j = 0; j < len; j++)
+        {
+        row[indices[j]] = 0.0;
+        }
+      CHECK_ZERO(HA->InsertMyValues(lids[k], nnz, values.data(), pattern.data()));
+      }
+    }
+
+  // rows that are not in any group are simply negated
+  for (int i = 0; i < numRows; i++)
+    {
+    if (inGroup[i]) continue;
+    CHECK_ZERO(A.ExtractMyRowView(i, len, vals, indices));
+    values.resize(len);
+    for (int j = 0; j < len; j++)
+      {
+      values[j] = -vals[j];
+      }
+    CHECK_ZERO(HA->InsertMyValues(i, len, values.data(), indices));
+    }
+
+  CHECK_ZERO(HA->FillComplete(A.DomainMap(), A.RangeMap()));
+  return HA;
+  }
+
+Teuchos::RCP<Epetra_CrsMatrix> Householder::Transpose(const Epetra_CrsMatrix& A) const
+  {
+  HYMLS_PROF3(label_,"transpose");
+  Epetra_RowMatrixTransposer transp(const_cast<Epetra_CrsMatrix*>(&A));
+  Epetra_CrsMatrix* tmp = NULL;
+  CHECK_ZERO(transp.CreateTranspose(false, tmp,
+      const_cast<Epetra_Map*>(&A.DomainMap())));
+  Teuchos::RCP<Epetra_CrsMatrix> AT = Teuchos::rcp(tmp, true);
+  if (!AT->Filled())
+    {
+    CHECK_ZERO(AT->FillComplete(A.RangeMap(), A.DomainMap()));
+    }
+  return AT;
+  }
+
   }
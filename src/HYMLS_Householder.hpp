@@ -44,6 +44,11 @@ public:
 #endif
     Epetra_SerialDenseVector vec) const;
 
+  //! form the OT for a single group in compact form, the transform is
+  //! 2ww'-I. w is zero if the test vector is (almost) zero.
+  int Construct(Epetra_SerialDenseVector& w,
+    Epetra_SerialDenseVector vec) const;
+
   //! apply a sparse matrix representation of a set of transforms from the left
   //! and right to a sparse matrix.
   Teuchos::RCP<Epetra_CrsMatrix> Apply(
@@ -65,10 +70,36 @@ public:
   int ApplyInverse(
     Epetra_MultiVector& Tv, const Epetra_CrsMatrix& T, const Epetra_MultiVector& v) const;
 
+  //! apply a set of transforms in compact form from the left to a vector,
+  //! in place. This needs one dot product and one axpy per group and vector
+  //! instead of two sparse matrix-vector products.
+  int Apply(Epetra_MultiVector& v, int numGroups,
+    const int *groupPtr, const int *lids, const double *W) const;
+
+  //! apply the inverse of a set of transforms in compact form from the
+  //! left to a vector, in place.
+  int ApplyInverse(Epetra_MultiVector& v, int numGroups,
+    const int *groupPtr, const int *lids, const double *W) const;
+
+  //! apply a set of transforms in compact form from the left and right
+  //! to a sparse matrix. Each group of rows (and columns) is combined
+  //! directly on the union of the sparsity patterns of its rows, which
+  //! avoids the sparse matrix-matrix products and intermediate matrices
+  //! of the variant that uses a sparse matrix representation.
+  Teuchos::RCP<Epetra_CrsMatrix> Apply(const Epetra_CrsMatrix& A,
+    int numGroups, const int *groupPtr, const int *lids, const double *W) const;
+
   bool SaveMemory() const {return save_mem_;}
 
 protected:
 
+  //! compute HA for the grouped transform H, only transforming the rows
+  Teuchos::RCP<Epetra_CrsMatrix> ApplyRows(const Epetra_CrsMatrix& A,
+    int numGroups, const int *groupPtr, const int *lids, const double *W) const;
+
+  //! explicit transpose of A with the same row distribution
+  Teuchos::RCP<Epetra_CrsMatrix> Transpose(const Epetra_CrsMatrix& A) const;
+
   //! object label
   std::string label_;
 
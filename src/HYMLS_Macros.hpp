@@ -86,16 +86,23 @@
  s1 and s2 are concatenated to form the profiler/timer label.
  s1 may be e.g. an object label and s2 a function name.
  */
-#define HYMLS_PROF(s1,s2) HYMLS::TimerObject \
-Error_You_are_trying_to_start_multiple_timers_in_one_scope \
-(((std::string)(s1))+": "+(((std::string)(s2))),PRINT_TIMING); \
+#define HYMLS_PROF(s1,s2) HYMLS_PROF_LEVEL(s1,s2,-1) \
 SCOREP_USER_REGION((std::string(s1)+std::string(s2)).c_str(),SCOREP_USER_REGION_TYPE_FUNCTION)
 
 /*! @def HYMLS_LPROF(s1,s2): like HYMLS_PROF, but for HYMLS' recursively constructed 
 classes. The macro assumes that the calling scope (e.g. the class) has an int variable 
 'myLevel_', which it will append to s1.*/ 
-#define HYMLS_LPROF(s1,s2) HYMLS_PROF(s1+"_L"+Teuchos::toString(myLevel_),s2) \
+#define HYMLS_LPROF(s1,s2) HYMLS_PROF_LEVEL(s1,s2,myLevel_) \
+SCOREP_USER_REGION((std::string(s1)+"_L"+Teuchos::toString(myLevel_)+std::string(s2)).c_str(),SCOREP_USER_REGION_TYPE_FUNCTION) \
 SCOREP_USER_PARAMETER_INT64("level",(int64_t)myLevel_);
+
+// The timer id is looked up through a static cache per call site, keyed by the
+// label strings and the level, so the label strings are only concatenated the
+// first time a call site is reached with a given label on a level.
+#define HYMLS_PROF_LEVEL(s1,s2,lev) \
+static HYMLS::TimerSite HYMLS_timer_site_in_this_scope; \
+HYMLS::TimerObject Error_You_are_trying_to_start_multiple_timers_in_one_scope \
+(HYMLS_timer_site_in_this_scope.Id(s1,s2,lev),PRINT_TIMING);
 #else
 #define HYMLS_PROF(s1,s2)
 #define HYMLS_LPROF(s1,s2)
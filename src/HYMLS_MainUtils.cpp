@@ -2,8 +2,16 @@
 
 #include "HYMLS_config.h"
 
+#include <algorithm>
+#include <climits>
+#include <cstring>
 #include <iostream>
+#include <limits>
+#include <vector>
 
+#include <mpi.h>
+
+#include "Epetra_MpiComm.h"
 #include "Epetra_Map.h"
 #include "Epetra_MultiVector.h"
 #include "Epetra_Vector.h"
@@ -32,6 +40,294 @@ namespace HYMLS {
 
 namespace MainUtils {
 
+namespace {
+
+// identification of the binary files
+const char binaryMatrixMagic[8] = {'H', 'Y', 'M', 'L', 'S', 'C', 'S', 'R'};
+const char binaryVectorMagic[8] = {'H', 'Y', 'M', 'L', 'S', 'V', 'E', 'C'};
+const int binaryVersion = 1;
+
+// header at the start of a binary file. A matrix file is followed by
+// numRows+1 row pointers (64 bit), numNonzeros column indices of
+// indexSize bytes and numNonzeros values. A vector file is followed by
+// numRows values. All indices start at 0. Everything is in the native
+// byte order, which we detect from the version when reading.
+struct BinaryHeader
+  {
+  char magic[8];
+  int version;
+  int indexSize;
+  long long numRows;
+  long long numCols;
+  long long numNonzeros;
+  };
+
+MPI_Comm GetMpiComm(const Epetra_Comm& comm)
+  {
+  const Epetra_MpiComm *mpiComm = dynamic_cast<const Epetra_MpiComm *>(&comm);
+  if (mpiComm == NULL)
+    {
+    HYMLS::Tools::Error("binary files can only be used with an Epetra_MpiComm",
+      __FILE__, __LINE__);
+    }
+  return mpiComm->Comm();
+  }
+
+// sum of value over all lower ranks
+long long ExclusiveSum(long long value, MPI_Comm comm)
+  {
+  long long result = 0;
+  int rank;
+  MPI_Comm_rank(comm, &rank);
+  CHECK_ZERO(MPI_Exscan(&value, &result, 1, MPI_LONG_LONG, MPI_SUM, comm));
+  return rank == 0 ? 0 : result;
+  }
+
+// collective read or write of count elements of size bytes at offset.
+// The transfer is split into chunks so that the counts fit in an int.
+// A short transfer on any rank is an error on all of them.
+void TransferAtAll(bool write, MPI_File fh, MPI_Offset offset, void *buf,
+  long long count, int size, MPI_Comm comm)
+  {
+  const long long maxChunk = INT_MAX / size;
+  long long numChunks = (count + maxChunk - 1) / maxChunk;
+  long long maxNumChunks;
+  CHECK_ZERO(MPI_Allreduce(&numChunks, &maxNumChunks, 1, MPI_LONG_LONG,
+      MPI_MAX, comm));
+
+  int complete = 1;
+  char *ptr = static_cast<char *>(buf);
+  for (long long i = 0; i < maxNumChunks; i++)
+    {
+    int bytes = (int)std::min(maxChunk, count) * size;
+    MPI_Status status;
+    if (write)
+      {
+      CHECK_ZERO(MPI_File_write_at_all(fh, offset, ptr, bytes, MPI_BYTE, &status));
+      }
+    else
+      {
+      CHECK_ZERO(MPI_File_read_at_all(fh, offset, ptr, bytes, MPI_BYTE, &status));
+      }
+
+    // The other ranks may still need this rank for the next chunks, so
+    // we only report the error after the loop
+    int transferred;
+    CHECK_ZERO(MPI_Get_count(&status, MPI_BYTE, &transferred));
+    if (transferred != bytes)
+      {
+      complete = 0;
+      }
+
+    offset += bytes;
+    ptr += bytes;
+    count -= bytes / size;
+    }
+
+  int allComplete;
+  CHECK_ZERO(MPI_Allreduce(&complete, &allComplete, 1, MPI_INT, MPI_MIN, comm));
+  if (!allComplete)
+    {
+    HYMLS::Tools::Error(write ? "could not write the binary file" :
+      "binary file is too short", __FILE__, __LINE__);
+    }
+  }
+
+void ReadAtAll(MPI_File fh, MPI_Offset offset, void *buf,
+  long long count, int size, MPI_Comm comm)
+  {
+  TransferAtAll(false, fh, offset, buf, count, size, comm);
+  }
+
+void WriteAtAll(MPI_File fh, MPI_Offset offset, const void *buf,
+  long long count, int size, MPI_Comm comm)
+  {
+  TransferAtAll(true, fh, offset, const_cast<void *>(buf), count, size, comm);
+  }
+
+MPI_File OpenBinaryFile(std::string const &filename, bool write, MPI_Comm comm)
+  {
+  MPI_File fh;
+  int mode = write ? MPI_MODE_WRONLY | MPI_MODE_CREATE : MPI_MODE_RDONLY;
+  if (MPI_File_open(comm, const_cast<char *>(filename.c_str()), mode,
+      MPI_INFO_NULL, &fh) != MPI_SUCCESS)
+    {
+    HYMLS::Tools::Error("could not open '" + filename + "'", __FILE__, __LINE__);
+    }
+  if (write)
+    {
+    CHECK_ZERO(MPI_File_set_size(fh, 0));
+    }
+  return fh;
+  }
+
+BinaryHeader ReadBinaryHeader(MPI_File fh, const char *magic,
+  std::string const &filename, MPI_Comm comm)
+  {
+  BinaryHeader header;
+  ReadAtAll(fh, 0, &header, 1, sizeof(header), comm);
+  if (std::memcmp(header.magic, magic, sizeof(header.magic)) == 0 &&
+    header.version != binaryVersion)
+    {
+    int version = header.version;
+    char *bytes = reinterpret_cast<char *>(&version);
+    std::reverse(bytes, bytes + sizeof(version));
+    if (version == binaryVersion)
+      {
+      HYMLS::Tools::Error("'" + filename + "' was written on a machine with "
+        "a different byte order", __FILE__, __LINE__);
+      }
+    }
+  if (std::memcmp(header.magic, magic, sizeof(header.magic)) ||
+    header.version != binaryVersion)
+    {
+    HYMLS::Tools::Error("'" + filename + "' is not a valid binary file",
+      __FILE__, __LINE__);
+    }
+  return header;
+  }
+
+void WriteBinaryHeader(MPI_File fh, BinaryHeader const &header, MPI_Comm comm)
+  {
+  int rank;
+  MPI_Comm_rank(comm, &rank);
+  WriteAtAll(fh, 0, &header, rank == 0 ? 1 : 0, sizeof(header), comm);
+  }
+
+BinaryHeader CreateBinaryHeader(const char *magic, int indexSize,
+  long long numRows, long long numCols, long long numNonzeros)
+  {
+  BinaryHeader header;
+  std::memcpy(header.magic, magic, sizeof(header.magic));
+  header.version = binaryVersion;
+  header.indexSize = indexSize;
+  header.numRows = numRows;
+  header.numCols = numCols;
+  header.numNonzeros = numNonzeros;
+  return header;
+  }
+
+// every rank reads a contiguous block of rows into a matrix with a
+// linear map that has as many rows per rank as the given map
+Teuchos::RCP<Epetra_CrsMatrix> read_binary_matrix(std::string const &filename,
+  Epetra_Map const &map)
+  {
+  MPI_Comm comm = GetMpiComm(map.Comm());
+  MPI_File fh = OpenBinaryFile(filename, false, comm);
+
+  BinaryHeader header = ReadBinaryHeader(fh, binaryMatrixMagic, filename, comm);
+  if (header.numRows != map.NumGlobalElements64() ||
+    header.numCols != map.NumGlobalElements64())
+    {
+    HYMLS::Tools::Error("the size of the matrix in '" + filename +
+      "' does not match the map", __FILE__, __LINE__);
+    }
+  if (header.indexSize != sizeof(int) && header.indexSize != sizeof(long long))
+    {
+    HYMLS::Tools::Error("invalid index size in '" + filename + "'",
+      __FILE__, __LINE__);
+    }
+
+  Epetra_Map linearMap((hymls_gidx)map.NumGlobalElements64(),
+                       map.NumMyElements(),
+                       (hymls_gidx)map.IndexBase64(),
+                       map.Comm());
+
+  int numMyRows = linearMap.NumMyElements();
+  long long firstRow = ExclusiveSum(numMyRows, comm);
+
+  MPI_Offset rowPtrOffset = sizeof(header);
+  MPI_Offset indexOffset = rowPtrOffset + (header.numRows + 1) * sizeof(long long);
+  MPI_Offset valueOffset = indexOffset + header.numNonzeros * header.indexSize;
+
+  std::vector<long long> rowPtr(numMyRows + 1);
+  ReadAtAll(fh, rowPtrOffset + firstRow * sizeof(long long), rowPtr.data(),
+    numMyRows + 1, sizeof(long long), comm);
+
+  // A corrupt row pointer could make us allocate too much or read the
+  // wrong part of the file on one rank only, so we check it here and fail
+  // on all ranks together before the next collective read
+  int validRowPtr = rowPtr[0] >= 0 && rowPtr[numMyRows] <= header.numNonzeros;
+  for (int i = 0; i < numMyRows && validRowPtr; i++)
+    {
+    if (rowPtr[i + 1] < rowPtr[i] || rowPtr[i + 1] - rowPtr[i] > INT_MAX)
+      {
+      validRowPtr = 0;
+      }
+    }
+  int allValidRowPtr;
+  CHECK_ZERO(MPI_Allreduce(&validRowPtr, &allValidRowPtr, 1, MPI_INT, MPI_MIN, comm));
+  if (!allValidRowPtr)
+    {
+    CHECK_ZERO(MPI_File_close(&fh));
+    HYMLS::Tools::Error("invalid row pointer in '" + filename + "'",
+      __FILE__, __LINE__);
+    }
+
+  long long numMyNonzeros = rowPtr[numMyRows] - rowPtr[0];
+
+  std::vector<char> indexBuffer(numMyNonzeros * header.indexSize);
+  ReadAtAll(fh, indexOffset + rowPtr[0] * header.indexSize, indexBuffer.data(),
+    numMyNonzeros, header.indexSize, comm);
+
+  std::vector<double> values(numMyNonzeros);
+  ReadAtAll(fh, valueOffset + rowPtr[0] * sizeof(double), values.data(),
+    numMyNonzeros, sizeof(double), comm);
+
+  CHECK_ZERO(MPI_File_close(&fh));
+
+  int validIndices = 1;
+  std::vector<hymls_gidx> indices(numMyNonzeros);
+  for (long long i = 0; i < numMyNonzeros; i++)
+    {
+    long long col;
+    if (header.indexSize == sizeof(int))
+      col = reinterpret_cast<int *>(indexBuffer.data())[i];
+    else
+      col = reinterpret_cast<long long *>(indexBuffer.data())[i];
+
+    if (col < 0 || col >= header.numCols ||
+      col > (long long)std::numeric_limits<hymls_gidx>::max() - map.IndexBase64())
+      {
+      validIndices = 0;
+      col = 0;
+      }
+    indices[i] = (hymls_gidx)(col + map.IndexBase64());
+    }
+
+  // the import below is collective, so all ranks have to fail together
+  int allValid;
+  CHECK_ZERO(MPI_Allreduce(&validIndices, &allValid, 1, MPI_INT, MPI_MIN, comm));
+  if (!allValid)
+    {
+    HYMLS::Tools::Error("invalid column index in '" + filename + "'",
+      __FILE__, __LINE__);
+    }
+
+  std::vector<int> rowLengths(numMyRows);
+  for (int i = 0; i < numMyRows; i++)
+    {
+    rowLengths[i] = (int)(rowPtr[i + 1] - rowPtr[i]);
+    }
+
+  Epetra_CrsMatrix linearMatrix(Copy, linearMap, rowLengths.data(), true);
+  for (int i = 0; i < numMyRows; i++)
+    {
+    long long start = rowPtr[i] - rowPtr[0];
+    CHECK_ZERO(linearMatrix.InsertGlobalValues(linearMap.GID64(i), rowLengths[i],
+        values.data() + start, indices.data() + start));
+    }
+  CHECK_ZERO(linearMatrix.FillComplete());
+
+  Teuchos::RCP<Epetra_CrsMatrix> K = Teuchos::rcp(new Epetra_CrsMatrix(Copy, map, 0));
+  Epetra_Import import(map, linearMap);
+  CHECK_ZERO(K->Import(linearMatrix, import, Insert));
+  CHECK_ZERO(K->FillComplete());
+  return K;
+  }
+
+  }
+
 Teuchos::RCP<Epetra_CrsMatrix> read_matrix(std::string datadir,
   std::string file_format, Teuchos::RCP<Epetra_Map> map, std::string name)
   {
@@ -50,6 +346,10 @@ Teuchos::RCP<Epetra_CrsMatrix> read_matrix(std::string datadir,
     {
     suffix="2.mtx";
     }
+  else if (file_format=="Binary")
+    {
+    suffix=".bin";
+    }
   else
     {
     HYMLS::Tools::Error("File format '"+file_format+"' not supported",__FILE__,__LINE__);
@@ -72,6 +372,10 @@ Teuchos::RCP<Epetra_CrsMatrix> read_matrix(std::string datadir,
 #endif
     K=Teuchos::rcp(Kptr, true);
     }
+  else if (file_format=="Binary")
+    {
+    K=read_binary_matrix(filename, *map);
+    }
   else
     {
     HYMLS::Tools::Error("File format '"+file_format+"' not supported",__FILE__,__LINE__);
@@ -97,6 +401,10 @@ Teuchos::RCP<Epetra_Vector> read_vector(std::string name,std::string datadir,
     {
     suffix="2.mtx";
     }
+  else if (file_format=="Binary")
+    {
+    suffix=".bin";
+    }
   else
     {
     HYMLS::Tools::Error("File format '"+file_format+"' not supported",__FILE__,__LINE__);
@@ -126,6 +434,33 @@ Teuchos::RCP<Epetra_Vector> read_vector(std::string name,std::string datadir,
     CHECK_ZERO(v->Import(*vptr,import,Insert));
     delete vptr;
     }
+  else if (file_format=="Binary")
+    {
+    Epetra_Map linearMap((hymls_gidx)map->NumGlobalElements64(),
+                         map->NumMyElements(),
+                         (hymls_gidx)map->IndexBase64(),
+                         map->Comm());
+
+    MPI_Comm comm = GetMpiComm(map->Comm());
+    MPI_File fh = OpenBinaryFile(filename, false, comm);
+
+    BinaryHeader header = ReadBinaryHeader(fh, binaryVectorMagic, filename, comm);
+    if (header.numRows != map->NumGlobalElements64())
+      {
+      HYMLS::Tools::Error("the size of the vector in '" + filename +
+        "' does not match the map", __FILE__, __LINE__);
+      }
+
+    Epetra_Vector linearVector(linearMap);
+    long long firstRow = ExclusiveSum(linearMap.NumMyElements(), comm);
+    ReadAtAll(fh, sizeof(header) + firstRow * sizeof(double), linearVector.Values(),
+      linearMap.NumMyElements(), sizeof(double), comm);
+    CHECK_ZERO(MPI_File_close(&fh));
+
+    v=Teuchos::rcp(new Epetra_Vector(*map));
+    Epetra_Import import(*map,linearMap);
+    CHECK_ZERO(v->Import(linearVector,import,Insert));
+    }
   else
     {
     HYMLS::Tools::Error("File format '"+file_format+"' not supported",__FILE__,__LINE__);
@@ -133,6 +468,108 @@ Teuchos::RCP<Epetra_Vector> read_vector(std::string name,std::string datadir,
   return v;
   }
 
+int write_matrix(const Epetra_CrsMatrix& A, std::string datadir, std::string name)
+  {
+  std::string filename = datadir+"/"+name+".bin";
+
+  HYMLS::Tools::Out("... write matrix to file '"+filename+"'");
+
+  // reorder the rows so that every rank writes a contiguous block
+  const Epetra_Map& map = A.RowMap();
+  Epetra_Map linearMap((hymls_gidx)A.NumGlobalRows64(),
+                       map.NumMyElements(),
+                       (hymls_gidx)map.IndexBase64(),
+                       map.Comm());
+
+  Epetra_CrsMatrix linearMatrix(Copy, linearMap, 0);
+  Epetra_Import import(linearMap, map);
+  CHECK_ZERO(linearMatrix.Import(A, import, Insert));
+  CHECK_ZERO(linearMatrix.FillComplete(A.DomainMap(), A.RangeMap()));
+
+  MPI_Comm comm = GetMpiComm(map.Comm());
+
+  int numMyRows = linearMap.NumMyElements();
+  long long firstRow = ExclusiveSum(numMyRows, comm);
+  long long firstNonzero = ExclusiveSum(linearMatrix.NumMyNonzeros(), comm);
+
+  std::vector<long long> rowPtr(numMyRows + 1);
+  std::vector<hymls_gidx> indices(linearMatrix.NumMyNonzeros());
+  std::vector<double> values(linearMatrix.NumMyNonzeros());
+
+  rowPtr[0] = firstNonzero;
+  for (int i = 0; i < numMyRows; i++)
+    {
+    int len;
+    long long start = rowPtr[i] - firstNonzero;
+    CHECK_ZERO(linearMatrix.ExtractGlobalRowCopy(linearMap.GID64(i),
+        (int)(indices.size() - start), len, values.data() + start,
+        indices.data() + start));
+    for (int j = 0; j < len; j++)
+      {
+      indices[start + j] -= (hymls_gidx)map.IndexBase64();
+      }
+    rowPtr[i + 1] = rowPtr[i] + len;
+    }
+
+  // The number of nonzeros is that of the matrix we write, since the
+  // import merges rows that are on more than one rank in A
+  BinaryHeader header = CreateBinaryHeader(binaryMatrixMagic, sizeof(hymls_gidx),
+    A.NumGlobalRows64(), A.NumGlobalCols64(), linearMatrix.NumGlobalNonzeros64());
+
+  MPI_Offset rowPtrOffset = sizeof(header);
+  MPI_Offset indexOffset = rowPtrOffset + (header.numRows + 1) * sizeof(long long);
+  MPI_Offset valueOffset = indexOffset + header.numNonzeros * header.indexSize;
+
+  // the last rank also writes the final row pointer
+  int rank, numProc;
+  MPI_Comm_rank(comm, &rank);
+  MPI_Comm_size(comm, &numProc);
+  int numRowPtr = rank == numProc - 1 ? numMyRows + 1 : numMyRows;
+
+  MPI_File fh = OpenBinaryFile(filename, true, comm);
+  WriteBinaryHeader(fh, header, comm);
+  WriteAtAll(fh, rowPtrOffset + firstRow * sizeof(long long), rowPtr.data(),
+    numRowPtr, sizeof(long long), comm);
+  WriteAtAll(fh, indexOffset + firstNonzero * sizeof(hymls_gidx), indices.data(),
+    indices.size(), sizeof(hymls_gidx), comm);
+  WriteAtAll(fh, valueOffset + firstNonzero * sizeof(double), values.data(),
+    values.size(), sizeof(double), comm);
+  CHECK_ZERO(MPI_File_close(&fh));
+
+  return 0;
+  }
+
+int write_vector(const Epetra_Vector& v, std::string name, std::string datadir)
+  {
+  std::string filename = datadir+"/"+name+".bin";
+
+  HYMLS::Tools::Out("... write vector to file '"+filename+"'");
+
+  const Epetra_BlockMap& map = v.Map();
+  Epetra_Map linearMap((hymls_gidx)map.NumGlobalElements64(),
+                       map.NumMyElements(),
+                       (hymls_gidx)map.IndexBase64(),
+                       map.Comm());
+
+  Epetra_Vector linearVector(linearMap);
+  Epetra_Import import(linearMap, map);
+  CHECK_ZERO(linearVector.Import(v, import, Insert));
+
+  MPI_Comm comm = GetMpiComm(map.Comm());
+  long long firstRow = ExclusiveSum(linearMap.NumMyElements(), comm);
+
+  BinaryHeader header = CreateBinaryHeader(binaryVectorMagic, 0,
+    map.NumGlobalElements64(), 1, map.NumGlobalElements64());
+
+  MPI_File fh = OpenBinaryFile(filename, true, comm);
+  WriteBinaryHeader(fh, header, comm);
+  WriteAtAll(fh, sizeof(header) + firstRow * sizeof(double), linearVector.Values(),
+    linearMap.NumMyElements(), sizeof(double), comm);
+  CHECK_ZERO(MPI_File_close(&fh));
+
+  return 0;
+  }
+
 /////////////////////////////////////////////////////////////////////////////////////////
 
 #if 0
@@ -20,6 +20,10 @@ class ParameterList;
 namespace HYMLS {
 namespace MainUtils {
 
+// read the matrix datadir/name.mtx ("MatrixMarket"), datadir/name2.mtx
+// ("MatrixMarket (2)") or datadir/name.bin ("Binary"). Binary files are
+// read in parallel with MPI-IO. The GIDs of map should be the row
+// numbers in the file (plus the index base).
 Teuchos::RCP<Epetra_CrsMatrix> read_matrix(std::string datadir,
   std::string file_format,
   Teuchos::RCP<Epetra_Map> map,
@@ -30,6 +34,22 @@ Teuchos::RCP<Epetra_Vector> read_vector(std::string name,
   std::string file_format,
   Teuchos::RCP<Epetra_Map> map);
 
+// write the matrix to datadir/name.bin in the format that read_matrix
+// reads with file_format "Binary". This can be used to convert
+// MatrixMarket files. The file contains a header, the row pointers,
+// the column indices (32 or 64 bit) and the values in CSR order. All
+// data is stored in the byte order of the machine that writes it, so the
+// files can only be read on machines with the same byte order.
+int write_matrix(const Epetra_CrsMatrix& A,
+  std::string datadir,
+  std::string name="jac");
+
+// write the vector to datadir/name.bin in the format that read_vector
+// reads with file_format "Binary"
+int write_vector(const Epetra_Vector& v,
+  std::string name,
+  std::string datadir);
+
 Teuchos::RCP<Epetra_Map> create_map(const Epetra_Comm& comm,
   Teuchos::RCP<Teuchos::ParameterList> const &params);
 
@@ -4,7 +4,9 @@
 
 #include "Teuchos_ParameterList.hpp"
 
+#include "Epetra_Comm.h"
 #include "Epetra_Import.h"
+#include "Epetra_Map.h"
 #include "Epetra_BlockMap.h"
 #include "Epetra_CrsMatrix.h"
 #include "Epetra_MultiVector.h"
@@ -14,9 +16,9 @@
 #include "HYMLS_OverlappingPartitioner.hpp"
 #include "HYMLS_HierarchicalMap.hpp"
 #include "HYMLS_SparseDirectSolver.hpp"
+#include "HYMLS_BatchedDenseSolver.hpp"
 #include "HYMLS_InteriorGroup.hpp"
 
-#include "Ifpack_DenseContainer.h"
 #include "Ifpack_Amesos.h"
 
 #undef HAVE_MPI
@@ -26,6 +28,14 @@
 #include <mkl.h>
 #endif
 
+#ifdef HYMLS_USE_OPENMP
+#include <omp.h>
+#endif
+
+#include <vector>
+#include <algorithm>
+#include <exception>
+
 namespace HYMLS {
 
 MatrixBlock::MatrixBlock(
@@ -38,7 +48,12 @@ MatrixBlock::MatrixBlock(
   rowStrategy_(rowStrategy),
   colStrategy_(colStrategy),
   label_("MatrixBlock"),
+  localBlockRefresh_(false),
   useTranspose_(false),
+  numThreads_(-1),
+  threadedSolves_(false),
+  reuseSymbolic_(false),
+  subdomainLIDsStamp_(0),
   myLevel_(level)
   {
   // First we get the maps belonging to the rows and columns of this
@@ -82,10 +97,22 @@ int MatrixBlock::Compute(Teuchos::RCP<const Epetra_CrsMatrix> matrix,
   if (import_ == Teuchos::null)
     import_ = Teuchos::rcp(new Epetra_Import(*rowMap_, matrix->RowMap()));
 
+  // If the extended matrix is the same as last time, its pattern did not
+  // change and we can just copy the values
+  const bool refresh = block_ != Teuchos::null && planMatrix_ == extendedMatrix;
+
   if (block_ != Teuchos::null)
     {
     CHECK_ZERO(block_->PutScalar(0.0));
-    CHECK_ZERO(block_->Import(*matrix, *import_, Insert));
+    if (refresh && localBlockRefresh_)
+      {
+      CHECK_ZERO(MatrixUtils::CopyValues(*extendedMatrix, blockSourceRows_,
+          *block_, blockTargetRows_, blockPlan_));
+      }
+    else
+      {
+      CHECK_ZERO(block_->Import(*matrix, *import_, Insert));
+      }
     }
   else
     {
@@ -102,7 +129,15 @@ int MatrixBlock::Compute(Teuchos::RCP<const Epetra_CrsMatrix> matrix,
     for (int sd = 0; sd < hid_->NumMySubdomains(); sd++)
       {
       CHECK_ZERO(subBlocks_[sd]->PutScalar(0.0));
-      CHECK_ZERO(MatrixUtils::ExtractLocalBlock(*extendedMatrix, *subBlocks_[sd]));
+      if (refresh)
+        {
+        CHECK_ZERO(MatrixUtils::CopyValues(*extendedMatrix, subBlockSourceRows_[sd],
+            *subBlocks_[sd], subBlockTargetRows_[sd], subBlockPlans_[sd]));
+        }
+      else
+        {
+        CHECK_ZERO(MatrixUtils::ExtractLocalBlock(*extendedMatrix, *subBlocks_[sd]));
+        }
       }
     }
   else
@@ -110,6 +145,7 @@ int MatrixBlock::Compute(Teuchos::RCP<const Epetra_CrsMatrix> matrix,
     double nzCopy = 0;
     int num_sd = hid_->NumMySubdomains();
     subBlocks_.resize(num_sd);
+    subBlockColumnPositions_.resize(num_sd);
 
     for (int sd = 0; sd < num_sd; sd++)
       {
@@ -126,10 +162,78 @@ int MatrixBlock::Compute(Teuchos::RCP<const Epetra_CrsMatrix> matrix,
 
       CHECK_ZERO(subBlocks_[sd]->FillComplete(*subDomainMap,*subRangeMap));
 
+      // Store the position of each local column in the domain map. The
+      // pattern does not change, so this saves a search per entry every
+      // time the Schur complement is constructed.
+      Teuchos::Array<int> &positions = subBlockColumnPositions_[sd];
+      positions.resize(subBlocks_[sd]->NumMyCols());
+      for (int j = 0; j < positions.size(); j++)
+        {
+        positions[j] = subDomainMap->LID(subBlocks_[sd]->GCID64(j));
+        }
+
       nzCopy += (double)(subBlocks_[sd]->NumMyNonzeros());
       }
     }
 
+  if (!refresh)
+    {
+    CHECK_ZERO(CreateValueCopyPlans(extendedMatrix));
+    }
+
+  return 0;
+  }
+
+int MatrixBlock::CreateValueCopyPlans(Teuchos::RCP<const Epetra_CrsMatrix> extendedMatrix)
+  {
+  HYMLS_LPROF3(label_, "CreateValueCopyPlans");
+
+  planMatrix_ = extendedMatrix;
+  Epetra_Map const &extendedMap = extendedMatrix->RowMap();
+
+  // The rows of block_ may be owned by other processors, in which case we
+  // keep importing it. All processors have to agree on this.
+  int allLocal = 1;
+  blockSourceRows_.resize(block_->NumMyRows());
+  blockTargetRows_.resize(block_->NumMyRows());
+  for (int i = 0; i < block_->NumMyRows(); i++)
+    {
+    blockSourceRows_[i] = extendedMap.LID(block_->GRID64(i));
+    blockTargetRows_[i] = i;
+    if (blockSourceRows_[i] < 0)
+      {
+      allLocal = 0;
+      }
+    }
+  int allAllLocal;
+  CHECK_ZERO(block_->Comm().MinAll(&allLocal, &allAllLocal, 1));
+  localBlockRefresh_ = allAllLocal;
+  if (localBlockRefresh_)
+    {
+    CHECK_ZERO(MatrixUtils::CreateValueCopyPlan(*extendedMatrix, blockSourceRows_,
+        *block_, blockTargetRows_, blockPlan_));
+    }
+
+  // The subdomain blocks were extracted locally, so their rows are always
+  // in the extended matrix
+  const int num_sd = subBlocks_.size();
+  subBlockSourceRows_.resize(num_sd);
+  subBlockTargetRows_.resize(num_sd);
+  subBlockPlans_.resize(num_sd);
+  for (int sd = 0; sd < num_sd; sd++)
+    {
+    Epetra_CrsMatrix const &subBlock = *subBlocks_[sd];
+    subBlockSourceRows_[sd].resize(subBlock.NumMyRows());
+    subBlockTargetRows_[sd].resize(subBlock.NumMyRows());
+    for (int i = 0; i < subBlock.NumMyRows(); i++)
+      {
+      subBlockSourceRows_[sd][i] = extendedMap.LID(subBlock.GRID64(i));
+      subBlockTargetRows_[sd][i] = i;
+      }
+    CHECK_ZERO(MatrixUtils::CreateValueCopyPlan(*extendedMatrix, subBlockSourceRows_[sd],
+        *subBlocks_[sd], subBlockTargetRows_[sd], subBlockPlans_[sd]));
+    }
+
   return 0;
   }
 
@@ -142,19 +246,68 @@ int MatrixBlock::InitializeSubdomainSolvers(std::string const &solverType,
 
   numThreads_ = numThreads;
 
-  subdomainSolvers_.resize(hid_->NumMySubdomains());
+  // only our own sparse solver can refresh its factorization in place
+  reuseSymbolic_ = (solverType == "Sparse") &&
+    sd_list->get("Reuse Symbolic Factorization", false);
+
+  // Ifpack_Amesos may share state between instances (timers, the Amesos
+  // factory), so we only solve subdomains concurrently with our own solvers
+  threadedSolves_ = (solverType != "Amesos");
+
+  const int num_sd = hid_->NumMySubdomains();
 
-  for (int sd = 0; sd < hid_->NumMySubdomains(); sd++)
+  // The rows of the subdomains follow directly from the interior groups
+  Epetra_Map const &rowMap = hid_->OverlappingMap();
+  subdomainPtr_.resize(num_sd + 1);
+  subdomainPtr_[0] = 0;
+  subdomainRows_.clear();
+  for (int sd = 0; sd < num_sd; sd++)
     {
     InteriorGroup const &group = hid_->GetInteriorGroup(sd);
-    const int nrows = group.length();
+    for (hymls_gidx gid: group.nodes())
+      {
+      subdomainRows_.push_back(rowMap.LID(gid));
+      }
+    subdomainPtr_[sd + 1] = subdomainRows_.size();
+    }
+  subdomainLIDs_.clear();
 
-    if (solverType == "Dense")
+  // Position of each row in its subdomain, used to put new values in the
+  // subdomain solvers in RefreshSubdomainSolver(). The interior groups do
+  // not overlap, so every row is in at most one subdomain.
+  subdomainRowPos_.clear();
+  if (reuseSymbolic_)
+    {
+    subdomainRowPos_.resize(rowMap.NumMyElements(), -1);
+    for (int sd = 0; sd < num_sd; sd++)
       {
-      subdomainSolvers_[sd] =
-        Teuchos::rcp(new Ifpack_DenseContainer(nrows));
+      for (int j = subdomainPtr_[sd]; j < subdomainPtr_[sd + 1]; j++)
+        {
+        subdomainRowPos_[subdomainRows_[j]] = j - subdomainPtr_[sd];
+        }
       }
-    else if (solverType == "Sparse")
+    }
+
+  // The dense subdomains on the coarser levels are small and of about the
+  // same size, so we factor and solve them all at once instead of using
+  // an Ifpack_DenseContainer for each of them.
+  if (solverType == "Dense")
+    {
+    subdomainSolvers_.clear();
+    batchedSolver_ = Teuchos::rcp(new BatchedDenseSolver());
+    CHECK_ZERO(batchedSolver_->Initialize(num_sd,
+        subdomainPtr_.getRawPtr(), subdomainRows_.getRawPtr()));
+    return 0;
+    }
+
+  batchedSolver_ = Teuchos::null;
+  subdomainSolvers_.resize(num_sd);
+
+  for (int sd = 0; sd < num_sd; sd++)
+    {
+    const int nrows = subdomainPtr_[sd + 1] - subdomainPtr_[sd];
+
+    if (solverType == "Sparse")
       {
       subdomainSolvers_[sd] =
         Teuchos::rcp(new Ifpack_SparseContainer<SparseDirectSolver>(nrows));
@@ -194,13 +347,10 @@ int MatrixBlock::InitializeSubdomainSolvers(std::string const &solverType,
           __FILE__, __LINE__);
       }
 #endif
-    Epetra_Map const &rowMap = hid_->OverlappingMap();
     // set "global" ID of each partitioner row
-    int j = 0;
-    for (hymls_gidx gid: group.nodes())
+    for (int j = 0; j < nrows; j++)
       {
-      const int LRID = rowMap.LID(gid);
-      subdomainSolvers_[sd]->ID(j++) = LRID;
+      subdomainSolvers_[sd]->ID(j) = subdomainRows_[subdomainPtr_[sd] + j];
       }
     }
 
@@ -213,65 +363,90 @@ int MatrixBlock::ComputeSubdomainSolvers(Teuchos::RCP<const Epetra_CrsMatrix> ex
 
   HYMLS_DEBUG("compute subdomain solvers...");
 
-  for (int sd = 0; sd < hid_->NumMySubdomains(); sd++)
+  const int num_sd = hid_->NumMySubdomains();
+
+  // the subdomain rows are looked up again in the next ApplyInverse()
+  subdomainLIDs_.clear();
+
+  if (batchedSolver_ != Teuchos::null)
     {
-    if (subdomainSolvers_[sd]->NumRows() > 0)
+    int ierr = batchedSolver_->Compute(*extendedMatrix);
+    if (ierr)
       {
-      // Compute the subdomain factorization
-#ifdef HYMLS_TESTING
-      bool status = true;
-      try {
-#endif
-        // We have to call Initialize every time because we have to recreate
-        // the internal matrix in the SparseContainer. Otherwise we try
-        // to fill a matrix on which FillComplete was already called.
-        Epetra_Map const &rowMap = extendedMatrix->RowMap();
-        CHECK_ZERO(subdomainSolvers_[sd]->Initialize());
-        if (Teuchos::rcp_dynamic_cast<Ifpack_DenseContainer>(
-            subdomainSolvers_[sd]) != Teuchos::null)
-          {
-          InteriorGroup const &group = hid_->GetInteriorGroup(sd);
+      Tools::Error("singular dense subdomain matrix " +
+        Teuchos::toString(batchedSolver_->SingularBlock()) + " on partition " +
+        Teuchos::toString(Comm().MyPID()), __FILE__, __LINE__);
+      }
+    return 0;
+    }
 
-          // Initialize destroys the indices for the Ifpack_DenseContainer :(
-          int j = 0;
-          for (hymls_gidx gid: group.nodes())
-            {
-            const int LRID = rowMap.LID(gid);
-            subdomainSolvers_[sd]->ID(j++) = LRID;
-            }
-          }
+  // Factor the largest subdomains first so that the threads that pick up
+  // the last (small) subdomains do not keep the others waiting at the end.
+  // The sort is stable to keep the order deterministic.
+  std::vector<int> order(num_sd);
+  for (int sd = 0; sd < num_sd; sd++)
+    {
+    order[sd] = sd;
+    }
+  std::stable_sort(order.begin(), order.end(), [this](int sd1, int sd2) {
+      return subdomainSolvers_[sd1]->NumRows() > subdomainSolvers_[sd2]->NumRows();
+    });
 
-        CHECK_ZERO(subdomainSolvers_[sd]->Compute(*extendedMatrix));
+  std::exception_ptr eptr = nullptr;
 
-#ifdef HYMLS_TESTING
-        } TEUCHOS_STANDARD_CATCH_STATEMENTS(true, std::cerr, status);
-      if (!status)
-        {
-        Tools::Fatal("caught an exception in subdomain factorization of sd="+
-          Teuchos::toString(sd)+" on partition "+Teuchos::toString(Comm().MyPID()),
-          __FILE__, __LINE__);
-        }
+#if defined(HYMLS_USE_OPENMP) && HYMLS_TIMING_LEVEL>1
+  // per-thread timers to measure the load imbalance of the factorization.
+  // They are registered once, and only if the subdomains are factored
+  // concurrently.
+  if (numThreads_ > 1 && threadedSolves_ && (int)threadTimerIds_.size() != numThreads_)
+    {
+    threadTimerIds_.resize(numThreads_);
+    for (int thread = 0; thread < numThreads_; thread++)
+      {
+      threadTimerIds_[thread] = Tools::RegisterTimer(label_ + "_L" +
+        Teuchos::toString(myLevel_) + ": ComputeSubdomainSolvers (thread " +
+        Teuchos::toString(thread) + ")", myLevel_);
+      }
+    }
 #endif
 
-#ifdef STORE_SUBDOMAIN_MATRICES
-      Teuchos::RCP<Ifpack_SparseContainer<SparseDirectSolver> > container =
-        Teuchos::rcp_dynamic_cast<Ifpack_SparseContainer<SparseDirectSolver> >(
-          subdomainSolvers_[sd]);
-      if (container != Teuchos::null)
-        {
-        Tools::Warning("STORE_SUBDOMAIN_MATRICES is defined, this produces lots of output"
-          " and makes the code VERY slow", __FILE__, __LINE__);
-        const Epetra_RowMatrix& Asd = container->Inverse()->Matrix();
-        std::string filename = "SubdomainMatrix_P"+Teuchos::toString(Comm().MyPID())+
-          "_L"+Teuchos::toString(myLevel_)+
-          "_SD"+Teuchos::toString(sd)+".txt";
-        std::ofstream ofs(filename.c_str());
-        MatrixUtils::PrintRowMatrix(Asd,ofs);
-        ofs.close();
-        }
+#ifdef HYMLS_USE_OPENMP
+#pragma omp parallel num_threads(numThreads_) if (numThreads_ > 1 && threadedSolves_)
 #endif
+  {
+#if defined(HYMLS_USE_OPENMP) && HYMLS_TIMING_LEVEL>1
+  Teuchos::RCP<TimerObject> threadTimer;
+  if (numThreads_ > 1 && threadedSolves_)
+    {
+    threadTimer = Teuchos::rcp(new TimerObject(
+        threadTimerIds_[omp_get_thread_num()], PRINT_TIMING));
+    }
+#endif
+
+#ifdef HYMLS_USE_OPENMP
+#pragma omp for schedule(dynamic)
+#endif
+  for (int i = 0; i < num_sd; i++)
+    {
+    try
+      {
+      TraceSubdomain traceSd(order[i]);
+      CHECK_ZERO(ComputeSubdomainSolver(order[i], *extendedMatrix));
+      }
+    catch (...)
+      {
+#ifdef HYMLS_USE_OPENMP
+#pragma omp critical (HYMLS_MatrixBlock_ComputeSubdomainSolvers)
+#endif
+      if (!eptr) eptr = std::current_exception();
       }
     }
+  }
+
+  if (eptr)
+    {
+    std::rethrow_exception(eptr);
+    }
 
 #ifdef STORE_SD_LU
   if (hid_->NumMySubdomains() > 0)
@@ -291,6 +466,130 @@ int MatrixBlock::ComputeSubdomainSolvers(Teuchos::RCP<const Epetra_CrsMatrix> ex
   return 0;
   }
 
+int MatrixBlock::ComputeSubdomainSolver(int sd, Epetra_CrsMatrix const &extendedMatrix)
+  {
+  if (subdomainSolvers_[sd]->NumRows() == 0)
+    {
+    return 0;
+    }
+
+  // Only refresh the values if the pattern did not change
+  if (reuseSymbolic_ && subdomainSolvers_[sd]->IsComputed() &&
+    RefreshSubdomainSolver(sd, extendedMatrix) == 0)
+    {
+    return 0;
+    }
+
+  // Compute the subdomain factorization
+#ifdef HYMLS_TESTING
+  bool status = true;
+  try {
+#endif
+    // We have to call Initialize every time because we have to recreate
+    // the internal matrix in the SparseContainer. Otherwise we try
+    // to fill a matrix on which FillComplete was already called.
+    CHECK_ZERO(subdomainSolvers_[sd]->Initialize());
+    CHECK_ZERO(subdomainSolvers_[sd]->Compute(extendedMatrix));
+
+#ifdef HYMLS_TESTING
+    } TEUCHOS_STANDARD_CATCH_STATEMENTS(true, std::cerr, status);
+  if (!status)
+    {
+    Tools::Fatal("caught an exception in subdomain factorization of sd="+
+      Teuchos::toString(sd)+" on partition "+Teuchos::toString(Comm().MyPID()),
+      __FILE__, __LINE__);
+    }
+#endif
+
+#ifdef STORE_SUBDOMAIN_MATRICES
+  Teuchos::RCP<Ifpack_SparseContainer<SparseDirectSolver> > container =
+    Teuchos::rcp_dynamic_cast<Ifpack_SparseContainer<SparseDirectSolver> >(
+      subdomainSolvers_[sd]);
+  if (container != Teuchos::null)
+    {
+    Tools::Warning("STORE_SUBDOMAIN_MATRICES is defined, this produces lots of output"
+      " and makes the code VERY slow", __FILE__, __LINE__);
+    const Epetra_RowMatrix& Asd = container->Inverse()->Matrix();
+    std::string filename = "SubdomainMatrix_P"+Teuchos::toString(Comm().MyPID())+
+      "_L"+Teuchos::toString(myLevel_)+
+      "_SD"+Teuchos::toString(sd)+".txt";
+    std::ofstream ofs(filename.c_str());
+    MatrixUtils::PrintRowMatrix(Asd,ofs);
+    ofs.close();
+    }
+#endif
+
+  return 0;
+  }
+
+int MatrixBlock::RefreshSubdomainSolver(int sd, Epetra_CrsMatrix const &extendedMatrix)
+  {
+  HYMLS_LPROF3(label_, "RefreshSubdomainSolver");
+
+  Teuchos::RCP<Ifpack_SparseContainer<SparseDirectSolver> > container =
+    Teuchos::rcp_dynamic_cast<Ifpack_SparseContainer<SparseDirectSolver> >(
+      subdomainSolvers_[sd]);
+  if (container == Teuchos::null)
+    {
+    return -1;
+    }
+
+  // The container does not give us access to its matrix, but the solver
+  // holds a pointer to it, which is an Epetra_CrsMatrix.
+  SparseDirectSolver &solver = const_cast<SparseDirectSolver &>(*container->Inverse());
+  Epetra_CrsMatrix *block = const_cast<Epetra_CrsMatrix *>(
+    dynamic_cast<Epetra_CrsMatrix const *>(&solver.Matrix()));
+  if (block == NULL)
+    {
+    return -1;
+    }
+
+  if (subdomainRowPos_.size() < extendedMatrix.NumMyRows())
+    {
+    return 1;
+    }
+
+  const int nrows = container->NumRows();
+  const int *rows = subdomainRows_.getRawPtr() + subdomainPtr_[sd];
+
+  CHECK_ZERO(block->PutScalar(0.0));
+
+  // This does the same as Ifpack_SparseContainer::Extract, but replaces the
+  // values instead of inserting them.
+  int len = extendedMatrix.MaxNumEntries();
+  std::vector<double> values(len);
+  std::vector<int> indices(len);
+  for (int j = 0; j < nrows; j++)
+    {
+    int numEntries;
+    CHECK_ZERO(extendedMatrix.ExtractMyRowCopy(container->ID(j), len, numEntries,
+        &values[0], &indices[0]));
+    for (int k = 0; k < numEntries; k++)
+      {
+      // skip off-processor elements
+      if (indices[k] >= extendedMatrix.NumMyRows())
+        continue;
+
+      int pos = subdomainRowPos_[indices[k]];
+      if (pos >= 0 && pos < nrows && rows[pos] == indices[k])
+        {
+        // a positive return value means the entry is not in the pattern
+        if (block->ReplaceGlobalValues(j, 1, &values[k], &pos))
+          {
+          return 1;
+          }
+        }
+      }
+    }
+
+  // The container can not do this for us, because its Compute() extracts
+  // the matrix again and initializes a new solver. The solver keeps track
+  // of its number of calls and the time spent in Compute() itself.
+  CHECK_ZERO(solver.Compute());
+
+  return 0;
+  }
+
 int MatrixBlock::Apply(const Epetra_MultiVector& X, Epetra_MultiVector& Y)
   {
   HYMLS_LPROF3(label_, "Apply");
@@ -310,7 +609,8 @@ int MatrixBlock::Apply(const Epetra_MultiVector& X, Epetra_MultiVector& Y)
 
 int MatrixBlock::ApplyInverse(const Epetra_MultiVector& B, Epetra_MultiVector& X)
   {
-  if (!subdomainSolvers_.size() && hid_->NumMySubdomains() > 0)
+  if (!subdomainSolvers_.size() && batchedSolver_ == Teuchos::null &&
+    hid_->NumMySubdomains() > 0)
     {
     Tools::Warning("Subdomain Solvers have not been computed!", __FILE__, __LINE__);
     return -1;
@@ -342,46 +642,205 @@ int MatrixBlock::ApplyInverse(const Epetra_MultiVector& B, Epetra_MultiVector& X
         }
       }
     }
+  const int num_sd = subdomainSolvers_.size();
+
+  // precomputed positions of the subdomain rows in B and X
+  const int gatherPos = SubdomainLIDs(B.Map());
+  const int scatterPos = SubdomainLIDs(X.Map());
+  const int *gatherLIDs = subdomainLIDs_[gatherPos].lids.getRawPtr();
+  const int *scatterLIDs = subdomainLIDs_[scatterPos].lids.getRawPtr();
+
+  // one batched solve for all dense subdomains
+  if (batchedSolver_ != Teuchos::null)
+    {
+    IFPACK_CHK_ERR(batchedSolver_->ApplyInverse(B, X, gatherLIDs, scatterLIDs));
+    return 0;
+    }
+
+  // If the rows of each subdomain are contiguous in B and X, which is the
+  // case for the interior map of the partitioner, the sparse direct solvers
+  // can work on views of B and X and we do not have to copy anything
+  const bool inPlace = subdomainLIDs_[gatherPos].contiguous &&
+    subdomainLIDs_[scatterPos].contiguous &&
+    B.ConstantStride() && X.ConstantStride();
+
+  // The subdomains are independent and write to disjoint rows of X, so we
+  // can distribute them over threads. Each subdomain is still solved by
+  // exactly the same operations, so the result does not depend on the
+  // number of threads. Exceptions can not leave a parallel region, so we
+  // keep the first one and rethrow it afterwards.
+  int ierr = 0;
+  std::exception_ptr eptr = nullptr;
+
   // step 1: solve subdomain problems for temporary vector y
-  for (int sd = 0 ; sd < subdomainSolvers_.size() ; sd++)
+#ifdef HYMLS_USE_OPENMP
+#pragma omp parallel for schedule(dynamic) num_threads(numThreads_) \
+  if (numThreads_ > 1 && threadedSolves_) reduction(min: ierr)
+#endif
+  for (int sd = 0 ; sd < num_sd ; sd++)
     {
+    TraceSubdomain traceSd(sd);
     const int rows = subdomainSolvers_[sd]->NumRows();
+    if (rows == 0)
+      continue;
 
-    // copy IDs to be able to walk through the vectors columnwise
-    int *IDlist = new int[rows];
-    for (int j = 0 ; j < rows ; j++)
-      IDlist[j] = B.Map().LID(hid_->OverlappingMap().GID64(subdomainSolvers_[sd]->ID(j)));
+    // positions of the rows of subdomain sd in B and X
+    const int *gather = gatherLIDs + subdomainPtr_[sd];
+    const int *scatter = scatterLIDs + subdomainPtr_[sd];
 
-    // extract RHS from X
-    for (int k = 0 ; k < B.NumVectors() ; k++)
+    // apply the inverse of each block. NOTE: flops occurred
+    // in ApplyInverse() of each block are summed up in method
+    // ApplyInverseFlops().
+    int ret = -99;
+    try
       {
-      const double *Bvec = B[k];
-      for (int j = 0 ; j < rows ; j++)
+      if (inPlace)
         {
-        subdomainSolvers_[sd]->RHS(j,k) = Bvec[IDlist[j]];
+        ret = ApplyInverseInPlace(sd, X.NumVectors(),
+          B.Values() + gather[0], B.Stride(), X.Values() + scatter[0], X.Stride());
+        }
+
+      if (ret == -99)
+        {
+        // extract RHS from B. The columns of the RHS and LHS of a
+        // container are contiguous.
+        for (int k = 0 ; k < B.NumVectors() ; k++)
+          {
+          const double *Bvec = B[k];
+          double *rhs = &subdomainSolvers_[sd]->RHS(0, k);
+          for (int j = 0 ; j < rows ; j++)
+            {
+            rhs[j] = Bvec[gather[j]];
+            }
+          }
+
+        ret = subdomainSolvers_[sd]->ApplyInverse();
+
+        // copy back into solution vector X
+        for (int k = 0 ; k < X.NumVectors() ; k++)
+          {
+          double *Xvec = X[k];
+          const double *lhs = &subdomainSolvers_[sd]->LHS(0, k);
+          for (int j = 0 ; j < rows ; j++)
+            {
+            Xvec[scatter[j]] = lhs[j];
+            }
+          }
         }
       }
+    catch (...)
+      {
+      ret = 0;
+#ifdef HYMLS_USE_OPENMP
+#pragma omp critical (HYMLS_MatrixBlock_ApplyInverse)
+#endif
+      if (!eptr) eptr = std::current_exception();
+      }
+    ierr = std::min(ierr, ret);
+    }
 
-    // apply the inverse of each block. NOTE: flops occurred
-    // in ApplyInverse() of each block are summed up in method
-    // ApplyInverseFlops().
-    if (subdomainSolvers_[sd]->NumRows()>0)
+  if (eptr)
+    {
+    std::rethrow_exception(eptr);
+    }
+  IFPACK_CHK_ERR(ierr);
+
+  return 0;
+  }
+
+int MatrixBlock::ApplyInverseInPlace(int sd, int numVectors,
+  const double *B, int ldb, double *X, int ldx) const
+  {
+  Ifpack_SparseContainer<SparseDirectSolver> const *container =
+    dynamic_cast<Ifpack_SparseContainer<SparseDirectSolver> const *>(
+      subdomainSolvers_[sd].get());
+  if (container == NULL)
+    {
+    return -99;
+    }
+
+  // The solver makes a copy of B if it is the same as X. Any other overlap
+  // would be overwritten while we still need it, so we copy in that case.
+  const int rows = container->NumRows();
+  if (B != X && B < X + (numVectors - 1) * ldx + rows &&
+    X < B + (numVectors - 1) * ldb + rows)
+    {
+    return -99;
+    }
+
+  // Views of the rows of subdomain sd. The maps belong to this subdomain
+  // only, so this is safe when the subdomains are solved concurrently.
+  // The container reports the flops of its solver, and the solver counts
+  // its calls, time and flops itself, so calling it directly is the same
+  // for the accounting as going through the container.
+  SparseDirectSolver const &solver = *container->Inverse();
+  Epetra_MultiVector rhs(View, solver.OperatorRangeMap(),
+    const_cast<double *>(B), ldb, numVectors);
+  Epetra_MultiVector sol(View, solver.OperatorDomainMap(), X, ldx, numVectors);
+
+  return solver.ApplyInverse(rhs, sol);
+  }
+
+int MatrixBlock::SubdomainLIDs(Epetra_BlockMap const &map)
+  {
+  for (int i = 0; i < subdomainLIDs_.size(); i++)
+    {
+    if (subdomainLIDs_[i].map->DataPtr() == map.DataPtr())
       {
-      IFPACK_CHK_ERR(subdomainSolvers_[sd]->ApplyInverse());
+      subdomainLIDs_[i].lastUse = ++subdomainLIDsStamp_;
+      return i;
       }
-    // copy back into solution vector Y
-    for (int k = 0 ; k < X.NumVectors() ; k++)
+    }
+
+  HYMLS_LPROF3(label_, "SubdomainLIDs");
+
+  const int num_sd = subdomainPtr_.size() - 1;
+
+  SubdomainIndices indices;
+  indices.map = Teuchos::rcp(new Epetra_BlockMap(map));
+  indices.lids.resize(subdomainPtr_[num_sd]);
+  indices.contiguous = true;
+
+  Epetra_Map const &overlappingMap = hid_->OverlappingMap();
+  for (int sd = 0; sd < num_sd; sd++)
+    {
+    int *l = indices.lids.getRawPtr() + subdomainPtr_[sd];
+    const int *rows = subdomainRows_.getRawPtr() + subdomainPtr_[sd];
+    for (int j = 0; j < subdomainPtr_[sd + 1] - subdomainPtr_[sd]; j++)
       {
-      double *Xvec = X[k];
-      for (int j = 0 ; j < rows ; j++)
+      l[j] = map.LID(overlappingMap.GID64(rows[j]));
+#ifdef HYMLS_TESTING
+      if (l[j] < 0)
         {
-        Xvec[IDlist[j]] = subdomainSolvers_[sd]->LHS(j,k);
+        Tools::Error("subdomain row not in the map of the vector", __FILE__, __LINE__);
+        }
+#endif
+      if (l[j] != l[0] + j)
+        {
+        indices.contiguous = false;
         }
       }
-    delete[] IDlist;
     }
 
-  return 0;
+  indices.lastUse = ++subdomainLIDsStamp_;
+
+  // Replace the least recently used entry if the cache is full. This is
+  // never the entry of the other vector in the current ApplyInverse().
+  if (subdomainLIDs_.size() < maxSubdomainLIDs_)
+    {
+    subdomainLIDs_.push_back(indices);
+    return subdomainLIDs_.size() - 1;
+    }
+  int pos = 0;
+  for (int i = 1; i < subdomainLIDs_.size(); i++)
+    {
+    if (subdomainLIDs_[i].lastUse < subdomainLIDs_[pos].lastUse)
+      {
+      pos = i;
+      }
+    }
+  subdomainLIDs_[pos] = indices;
+  return pos;
   }
 
 int MatrixBlock::SetUseTranspose(bool useTranspose)
@@ -393,6 +852,12 @@ int MatrixBlock::SetUseTranspose(bool useTranspose)
     block_->SetUseTranspose(useTranspose);
     }
 
+  if (batchedSolver_ != Teuchos::null && useTranspose)
+    {
+    Tools::Error("Transpose not implemented for dense subdomain solver!",
+      __FILE__, __LINE__);
+    }
+
   // Set transpose for the subdomain solvers
   Teuchos::RCP<const Ifpack_SparseContainer<SparseDirectSolver> > sparseLU = Teuchos::null;
 
@@ -437,8 +902,22 @@ Teuchos::RCP<const Epetra_CrsMatrix> MatrixBlock::SubBlock(int sd) const
   return subBlocks_[sd];
   }
 
+Teuchos::Array<int> const &MatrixBlock::SubBlockColumnPositions(int sd) const
+  {
+  if (subBlockColumnPositions_.size() <= sd)
+    {
+    Tools::Error("Matrix block for subdomain "+Teuchos::toString(sd)+
+      " has not been computed!", __FILE__, __LINE__);
+    }
+  return subBlockColumnPositions_[sd];
+  }
+
 Teuchos::RCP<Ifpack_Container> MatrixBlock::SubdomainSolver(int sd) const
   {
+  if (batchedSolver_ != Teuchos::null)
+    {
+    return Teuchos::null;
+    }
   if (subdomainSolvers_.size() < sd)
     {
       Tools::Warning("Solver for subdomain "+Teuchos::toString(sd)+
@@ -472,6 +951,10 @@ double MatrixBlock::ComputeFlops() const
       total += subdomainSolvers_[i]->ComputeFlops();
       }
     }
+  if (batchedSolver_ != Teuchos::null)
+    {
+    total += batchedSolver_->ComputeFlops();
+    }
 
   return total;
   }
@@ -486,6 +969,10 @@ double MatrixBlock::ApplyInverseFlops() const
       total += subdomainSolvers_[i]->ApplyInverseFlops();
       }
     }
+  if (batchedSolver_ != Teuchos::null)
+    {
+    total += batchedSolver_->ApplyInverseFlops();
+    }
 
   return total;
   }
@@ -4,6 +4,8 @@
 #include "Teuchos_RCP.hpp"
 #include "Teuchos_Array.hpp"
 
+#include <vector>
+
 #include "HYMLS_HierarchicalMap.hpp"
 
 namespace Teuchos {
@@ -15,6 +17,7 @@ class Epetra_Import;
 class Epetra_CrsMatrix;
 class Epetra_Comm;
 class Epetra_Map;
+class Epetra_BlockMap;
 
 class Ifpack_Container;
 
@@ -22,6 +25,7 @@ namespace HYMLS
   {
 
 class OverlappingPartitioner;
+class BatchedDenseSolver;
 
 
 //! This class implements the blocks that are used in a Schur complement.
@@ -53,7 +57,9 @@ public:
   int InitializeSubdomainSolvers(std::string const &solverType,
   Teuchos::RCP<Teuchos::ParameterList>, int numThreads);
 
-  //! Compute the subdomain solvers for the A11 block
+  //! Compute the subdomain solvers for the A11 block. If more than one
+  //! subdomain solver thread is used, the subdomains are factored
+  //! concurrently, largest first.
   int ComputeSubdomainSolvers(Teuchos::RCP<const Epetra_CrsMatrix> extendedMatrix);
 
   //! Apply a block
@@ -71,9 +77,24 @@ public:
   //! Get the sd-th subdomain block
   Teuchos::RCP<const Epetra_CrsMatrix> SubBlock(int sd) const;
 
-  //! Get the sd-th subdomain solver
+  //! Get the position in the domain map of the sd-th subdomain block
+  //! for each of its local column indices, or -1 if it is not in there
+  Teuchos::Array<int> const &SubBlockColumnPositions(int sd) const;
+
+  //! Get the sd-th subdomain solver. This is null if the subdomains are
+  //! solved by the batched dense solver.
   Teuchos::RCP<Ifpack_Container> SubdomainSolver(int sd) const;
 
+  //! Get the batched dense solver that solves all subdomains if the
+  //! subdomain solver type is "Dense". Block sd of this solver is
+  //! subdomain sd. This is a raw pointer so that it can be used in
+  //! threaded loops without touching the reference count.
+  const BatchedDenseSolver *BatchedSolver() const {return batchedSolver_.get();}
+
+  //! Get the local indices in the overlapping map of the rows of subdomain
+  //! sd, in the order of the subdomain solver
+  const int *SubdomainRows(int sd) const {return subdomainRows_.getRawPtr() + subdomainPtr_[sd];}
+
   //! Communicator object
   Epetra_Comm const &Comm() const;
 
@@ -109,6 +130,31 @@ public:
 
 protected:
 
+  //! Compute the factorization of subdomain sd
+  int ComputeSubdomainSolver(int sd, Epetra_CrsMatrix const &extendedMatrix);
+
+  //! Put the new values of subdomain sd in the matrix of an already computed
+  //! sparse subdomain solver and refactor it without recomputing the ordering
+  //! and symbolic factorization. Returns 1 if the pattern has changed.
+  int RefreshSubdomainSolver(int sd, Epetra_CrsMatrix const &extendedMatrix);
+
+  //! Compute where the values of the extended matrix go in block_ and the
+  //! subdomain blocks, so that later calls of Compute() with the same
+  //! extended matrix only have to copy the values
+  int CreateValueCopyPlans(Teuchos::RCP<const Epetra_CrsMatrix> extendedMatrix);
+
+  //! Return the position in subdomainLIDs_ of the local indices in map of
+  //! the rows of all subdomain solvers, computing them if necessary
+  int SubdomainLIDs(Epetra_BlockMap const &map);
+
+  //! Solve subdomain sd directly on the rows of B and X if the subdomain
+  //! solver is our own sparse direct solver. B and X are column major with
+  //! leading dimensions ldb and ldx. B may be the same as X, but may not
+  //! overlap with it otherwise. Returns -99 if the solver does not support
+  //! this or B and X overlap, in which case nothing is done.
+  int ApplyInverseInPlace(int sd, int numVectors,
+    const double *B, int ldb, double *X, int ldx) const;
+
   //! Overlapping partitioner on which the blocks are based
   Teuchos::RCP<const OverlappingPartitioner> hid_;
 
@@ -142,9 +188,70 @@ protected:
   //! Ifpack conainers for solving the subdomain problems
   Teuchos::Array<Teuchos::RCP<Ifpack_Container> > subdomainSolvers_;
 
+  //! Solver for all subdomains at once, used instead of the containers
+  //! for the "Dense" subdomain solver type
+  Teuchos::RCP<BatchedDenseSolver> batchedSolver_;
+
   //! Subdomain blocks for this block
   Teuchos::Array<Teuchos::RCP<Epetra_CrsMatrix> > subBlocks_;
 
+  //! Position in the domain map for each local column of the subdomain blocks
+  Teuchos::Array<Teuchos::Array<int> > subBlockColumnPositions_;
+
+  //! Extended matrix for which the value copy plans below were made
+  Teuchos::RCP<const Epetra_CrsMatrix> planMatrix_;
+
+  //! Whether the rows of block_ are in the extended matrix on all
+  //! processors, so that block_ can be refreshed without an import
+  bool localBlockRefresh_;
+
+  //! Rows of the extended matrix and of block_, and positions of the values
+  //! in block_ (see MatrixUtils::CreateValueCopyPlan)
+  Teuchos::Array<int> blockSourceRows_, blockTargetRows_, blockPlan_;
+
+  //! Same as above for each of the subdomain blocks
+  Teuchos::Array<Teuchos::Array<int> > subBlockSourceRows_;
+  Teuchos::Array<Teuchos::Array<int> > subBlockTargetRows_;
+  Teuchos::Array<Teuchos::Array<int> > subBlockPlans_;
+
+  //! Start of the rows of each subdomain in subdomainRows_ and in the
+  //! arrays of subdomainLIDs_
+  Teuchos::Array<int> subdomainPtr_;
+
+  //! Local indices in the overlapping map of the rows of all subdomains,
+  //! one subdomain after the other
+  Teuchos::Array<int> subdomainRows_;
+
+  //! Position of each row of the overlapping map in its subdomain, or -1,
+  //! only used when reusing the symbolic factorization
+  Teuchos::Array<int> subdomainRowPos_;
+
+  //! Local indices of the rows of all subdomain solvers in the map of a
+  //! vector passed to ApplyInverse()
+  struct SubdomainIndices
+    {
+    //! A copy of the map so that its data can not be reused by another
+    //! map while we still have the indices
+    Teuchos::RCP<const Epetra_BlockMap> map;
+
+    //! The local indices, one subdomain after the other
+    Teuchos::Array<int> lids;
+
+    //! Whether the rows of every subdomain are a contiguous range of
+    //! local indices in the map, in the order of the subdomain solver
+    bool contiguous;
+
+    //! Value of subdomainLIDsStamp_ when these indices were last used
+    long long lastUse;
+    };
+
+  //! Indices of the subdomain rows for the maps that were used most
+  //! recently, at most maxSubdomainLIDs_ of them
+  Teuchos::Array<SubdomainIndices> subdomainLIDs_;
+
+  //! B and X usually have one of only a few different maps
+  static const int maxSubdomainLIDs_ = 4;
+
   //! Bool to set whether we want to perform transpose operations or not
   bool useTranspose_;
 
@@ -160,9 +267,23 @@ protected:
   //! The amount of flops from the ApplyInverse method
   double applyInverseFlops_;
 
-  //! Amount of threads used by the subdomain solvers
+  //! Amount of threads used by the subdomain solvers. If this is larger
+  //! than 1, the subdomains are also solved concurrently in ApplyInverse
   int numThreads_;
 
+  //! Whether the subdomain solvers may be applied concurrently
+  bool threadedSolves_;
+
+  //! Timer ids of the threads in ComputeSubdomainSolvers
+  std::vector<int> threadTimerIds_;
+
+  //! Keep the subdomain solvers and only refresh their values in
+  //! ComputeSubdomainSolvers ("Reuse Symbolic Factorization")
+  bool reuseSymbolic_;
+
+  //! Counts the lookups in subdomainLIDs_
+  long long subdomainLIDsStamp_;
+
   //! Level only used for debugging and timing
   int myLevel_;
   };
@@ -1879,4 +1879,72 @@ int MatrixUtils::ExtractLocalBlock(const Epetra_RowMatrix& A, Epetra_CrsMatrix&
   delete [] vals;
   return ierr;
   }
+
+int MatrixUtils::CreateValueCopyPlan(const Epetra_CrsMatrix& src,
+  const Teuchos::Array<int>& srcRows, const Epetra_CrsMatrix& tgt,
+  const Teuchos::Array<int>& tgtRows, Teuchos::Array<int>& plan)
+  {
+  HYMLS_PROF3(Label(), "CreateValueCopyPlan");
+
+  if (!src.Filled() || !tgt.Filled()) return -1;
+  if (srcRows.size() != tgtRows.size()) return -2;
+
+  plan.clear();
+  for (int r = 0; r < srcRows.size(); r++)
+    {
+    int len, tlen;
+    double *vals, *tvals;
+    int *inds, *tinds;
+    CHECK_ZERO(src.ExtractMyRowView(srcRows[r], len, vals, inds));
+    CHECK_ZERO(tgt.ExtractMyRowView(tgtRows[r], tlen, tvals, tinds));
+    for (int j = 0; j < len; j++)
+      {
+      int pos = -1;
+      int lcid = tgt.LCID(src.GCID64(inds[j]));
+      if (lcid >= 0)
+        {
+        // matrix rows are short, so a linear search is fine here
+        for (int k = 0; k < tlen; k++)
+          {
+          if (tinds[k] == lcid)
+            {
+            pos = k;
+            break;
+            }
+          }
+        }
+      plan.push_back(pos);
+      }
+    }
+  return 0;
+  }
+
+int MatrixUtils::CopyValues(const Epetra_CrsMatrix& src,
+  const Teuchos::Array<int>& srcRows, Epetra_CrsMatrix& tgt,
+  const Teuchos::Array<int>& tgtRows, const Teuchos::Array<int>& plan)
+  {
+  HYMLS_PROF3(Label(), "CopyValues");
+
+  if (srcRows.size() != tgtRows.size()) return -2;
+
+  int pos = 0;
+  for (int r = 0; r < srcRows.size(); r++)
+    {
+    int len, tlen;
+    double *vals, *tvals;
+    CHECK_ZERO(src.ExtractMyRowView(srcRows[r], len, vals));
+    CHECK_ZERO(tgt.ExtractMyRowView(tgtRows[r], tlen, tvals));
+    if (pos + len > plan.size()) return -3;
+    for (int j = 0; j < len; j++)
+      {
+      if (plan[pos + j] >= 0)
+        {
+        tvals[plan[pos + j]] = vals[j];
+        }
+      }
+    pos += len;
+    }
+  return pos == plan.size() ? 0 : -3;
+  }
+
   }
@@ -247,6 +247,23 @@ class MatrixUtils
     //! We do not call FillComplete in this function.
     static int ExtractLocalBlock(const Epetra_RowMatrix& A, Epetra_CrsMatrix& A_loc);
 
+    //! compute for each entry of the rows srcRows of src the position of the
+    //! entry with the same column in the corresponding row tgtRows of tgt, or
+    //! -1 if tgt does not have it. With this plan, CopyValues() refreshes the
+    //! values of tgt without searching as long as neither pattern changes.
+    //! Both matrices should be Filled.
+    static int CreateValueCopyPlan(const Epetra_CrsMatrix& src,
+      const Teuchos::Array<int>& srcRows, const Epetra_CrsMatrix& tgt,
+      const Teuchos::Array<int>& tgtRows, Teuchos::Array<int>& plan);
+
+    //! copy the values of the rows srcRows of src into the rows tgtRows of
+    //! tgt using a plan from CreateValueCopyPlan(). Entries of tgt that are
+    //! not in the plan are not changed. Returns -3 if the number of entries
+    //! of src does not match the plan.
+    static int CopyValues(const Epetra_CrsMatrix& src,
+      const Teuchos::Array<int>& srcRows, Epetra_CrsMatrix& tgt,
+      const Teuchos::Array<int>& tgtRows, const Teuchos::Array<int>& plan);
+
   private:
   
     //! returns a string describing the class
@@ -0,0 +1,65 @@
+#include "HYMLS_MultiVectorPool.hpp"
+
+#include "HYMLS_Macros.hpp"
+#include "HYMLS_Tools.hpp"
+
+#include "Epetra_BlockMap.h"
+#include "Epetra_MultiVector.h"
+
+namespace HYMLS {
+
+MultiVectorPool::MultiVectorPool()
+  {
+  }
+
+MultiVectorPool::~MultiVectorPool()
+  {
+  }
+
+Epetra_MultiVector &MultiVectorPool::Get(int slot, Epetra_BlockMap const &map,
+  int numVectors)
+  {
+  Teuchos::RCP<Epetra_MultiVector> &vec = vectors_[std::make_pair(slot, numVectors)];
+
+  // SameAs() would be a collective call, but maps that are copies of each
+  // other share their data, so we compare that instead
+  if (vec == Teuchos::null || vec->Map().DataPtr() != map.DataPtr())
+    {
+    HYMLS_PROF("MultiVectorPool", "allocate workspace");
+    vec = Teuchos::rcp(new Epetra_MultiVector(map, numVectors));
+    Tools::CountWorkspaceAllocation();
+    }
+  return *vec;
+  }
+
+Epetra_MultiVector &MultiVectorPool::View(int slot, Epetra_MultiVector &vec,
+  int firstRow, Epetra_BlockMap const &map)
+  {
+  const int numVectors = vec.NumVectors();
+  Teuchos::RCP<Epetra_MultiVector> &view = vectors_[std::make_pair(slot, numVectors)];
+
+  double *values = vec.Values() + firstRow;
+  if (view == Teuchos::null || view->Map().DataPtr() != map.DataPtr() ||
+    view->Values() != values || view->Stride() != vec.Stride())
+    {
+    if (firstRow < 0 || firstRow + map.NumMyPoints() > vec.MyLength())
+      {
+      Tools::Error("view out of range", __FILE__, __LINE__);
+      }
+    view = Teuchos::rcp(new Epetra_MultiVector(::View, map, values,
+        vec.Stride(), numVectors));
+    }
+  return *view;
+  }
+
+void MultiVectorPool::Clear()
+  {
+  vectors_.clear();
+  }
+
+long long MultiVectorPool::NumAllocations()
+  {
+  return Tools::NumWorkspaceAllocations();
+  }
+
+  }
@@ -0,0 +1,56 @@
+#ifndef HYMLS_MULTIVECTOR_POOL_H
+#define HYMLS_MULTIVECTOR_POOL_H
+
+#include "HYMLS_config.h"
+
+#include "Teuchos_RCP.hpp"
+
+#include <map>
+#include <utility>
+
+class Epetra_BlockMap;
+class Epetra_MultiVector;
+
+namespace HYMLS {
+
+//! Persistent workspace for the temporary vectors of ApplyInverse(), so that
+//! repeated applications of a preconditioner do not allocate any vectors.
+//! Vectors are identified by a slot number and their number of columns.
+class MultiVectorPool
+  {
+public:
+
+  //! constructor
+  MultiVectorPool();
+
+  //! destructor
+  virtual ~MultiVectorPool();
+
+  //! return the workspace vector in the given slot with numVectors columns.
+  //! It is only allocated the first time or if the map changed, otherwise
+  //! it still holds the values of the previous use.
+  Epetra_MultiVector &Get(int slot, Epetra_BlockMap const &map, int numVectors);
+
+  //! return a view of the rows firstRow, ..., firstRow+map.NumMyPoints()-1
+  //! of vec with the given map, stored in the given slot. The view is only
+  //! created again if vec or the map changed.
+  Epetra_MultiVector &View(int slot, Epetra_MultiVector &vec, int firstRow,
+    Epetra_BlockMap const &map);
+
+  //! release all workspace vectors
+  void Clear();
+
+  //! total number of vectors that were allocated by all pools, which
+  //! PrintTiming() also reports
+  static long long NumAllocations();
+
+private:
+
+  //! workspace vectors by slot and number of columns
+  std::map<std::pair<int, int>, Teuchos::RCP<Epetra_MultiVector> > vectors_;
+
+  };
+
+  }
+
+#endif
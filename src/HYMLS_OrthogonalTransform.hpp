@@ -47,6 +47,12 @@ public:
 #endif
     Epetra_SerialDenseVector vec) const = 0;
 
+  //! form the OT for a single group in a compact form: w is a vector of the
+  //! same length as the test vector vec, such that the transform can be
+  //! applied by the grouped Apply() function below.
+  virtual int Construct(Epetra_SerialDenseVector& w,
+    Epetra_SerialDenseVector vec) const = 0;
+
   //! apply a sparse matrix representation of a set of transforms from the left
   //! and right to a sparse matrix.
   virtual Teuchos::RCP<Epetra_CrsMatrix> Apply
@@ -68,6 +74,27 @@ public:
   virtual int ApplyInverse
     (Epetra_MultiVector& vT, const Epetra_CrsMatrix& T, const Epetra_MultiVector& v) const = 0;
 
+  //! apply a set of transforms in compact form (see Construct()) from the
+  //! left to a vector, in place. Group g acts on the local rows
+  //! lids[groupPtr[g]], ..., lids[groupPtr[g+1]-1] and is defined by the
+  //! entries of W at the same positions. The lids of a group should be
+  //! increasing. Rows that are not in any group are transformed as a group
+  //! with W=0.
+  virtual int Apply(Epetra_MultiVector& v, int numGroups,
+    const int *groupPtr, const int *lids, const double *W) const = 0;
+
+  //! apply the inverse of a set of transforms in compact form to a vector,
+  //! in place.
+  virtual int ApplyInverse(Epetra_MultiVector& v, int numGroups,
+    const int *groupPtr, const int *lids, const double *W) const = 0;
+
+  //! apply a set of transforms in compact form from the left and right to
+  //! a sparse matrix, with the groups defined on the local rows of A as in
+  //! the grouped Apply() for vectors. The rows and columns are transformed
+  //! directly, without forming the transform as a sparse matrix.
+  virtual Teuchos::RCP<Epetra_CrsMatrix> Apply(const Epetra_CrsMatrix& A,
+    int numGroups, const int *groupPtr, const int *lids, const double *W) const = 0;
+
   //! this can be used to indicate that no memory is stored inside the class and thus
   //! you always have to call the variant of Apply which returns a sparse matrix
   virtual bool SaveMemory() const {return false;}
@@ -15,12 +15,182 @@
 #include "Teuchos_Array.hpp"
 #include "Teuchos_toString.hpp"
 
-#include <algorithm>
+#include "Epetra_Comm.h"
+#include "Epetra_Map.h"
 
-class Epetra_Map;
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <initializer_list>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <vector>
 
 namespace HYMLS {
 
+namespace {
+
+// file identification and version of Save()
+const char saveMagic[8] = {'H', 'Y', 'M', 'L', 'S', 'H', 'I', 'D'};
+const int saveVersion = 3;
+
+template<typename T>
+void Write(std::ostream &os, T const &value)
+  {
+  os.write(reinterpret_cast<const char *>(&value), sizeof(T));
+  }
+
+template<typename T>
+void WriteArray(std::ostream &os, Teuchos::Array<T> const &array)
+  {
+  Write(os, (int)array.size());
+  if (array.size() > 0)
+    os.write(reinterpret_cast<const char *>(array.getRawPtr()),
+      array.size() * sizeof(T));
+  }
+
+template<typename T>
+bool Read(std::istream &is, T &value)
+  {
+  is.read(reinterpret_cast<char *>(&value), sizeof(T));
+  return !is.fail();
+  }
+
+template<typename T>
+bool ReadArray(std::istream &is, Teuchos::Array<T> &array)
+  {
+  int len;
+  if (!Read(is, len) || len < 0)
+    return false;
+  array.resize(len);
+  if (len > 0)
+    is.read(reinterpret_cast<char *>(array.getRawPtr()), len * sizeof(T));
+  return !is.fail();
+  }
+
+// 64 bit FNV-1a hash
+const unsigned long long hashOffset = 14695981039346656037ULL;
+
+void Hash(unsigned long long &hash, const void *data, size_t size)
+  {
+  const unsigned char *bytes = static_cast<const unsigned char *>(data);
+  for (size_t i = 0; i < size; i++)
+    {
+    hash ^= bytes[i];
+    hash *= 1099511628211ULL;
+    }
+  }
+
+void Hash(unsigned long long &hash, std::string const &str)
+  {
+  Hash(hash, str.c_str(), str.size() + 1);
+  }
+
+// hash a parameter if it is set
+void HashEntry(unsigned long long &hash, Teuchos::ParameterList const &list,
+  std::string const &name)
+  {
+  if (list.isParameter(name) && !list.isSublist(name))
+    {
+    Hash(hash, name);
+    Hash(hash, Teuchos::toString(list.getEntry(name).getAny(false)));
+    }
+  }
+
+// names of the entries of a list that start with prefix, in alphabetical
+// order, so that the order in which they were set does not matter
+std::vector<std::string> NamesWithPrefix(Teuchos::ParameterList const &list,
+  std::string const &prefix)
+  {
+  std::vector<std::string> names;
+  for (auto it = list.begin(); it != list.end(); ++it)
+    {
+    if (list.name(it).compare(0, prefix.size(), prefix) == 0)
+      names.push_back(list.name(it));
+    }
+  std::sort(names.begin(), names.end());
+  return names;
+  }
+
+// hash the parameters that are read by the partitioners (see
+// BasePartitioner::SetParameters() and CartesianPartitioner), including
+// the "Variable i" sublists of the "Problem" list. Other parameters do
+// not change the partitioning.
+void HashPartitionerParameters(unsigned long long &hash,
+  Teuchos::ParameterList const &params)
+  {
+  if (params.isSublist("Problem"))
+    {
+    Teuchos::ParameterList const &probList = params.sublist("Problem");
+    Hash(hash, "Problem");
+    for (const char *name: {"Dimension", "nx", "ny", "nz",
+          "x-periodic", "y-periodic", "z-periodic", "Periodicity",
+          "Equations", "Complex Arithmetic", "Degrees of Freedom",
+          "Pressure Variable", "Retained Pressure Nodes"})
+      {
+      HashEntry(hash, probList, name);
+      }
+    for (std::string const &name: NamesWithPrefix(probList, "Variable "))
+      {
+      if (probList.isSublist(name))
+        {
+        Hash(hash, name);
+        HashEntry(hash, probList.sublist(name), "Variable Type");
+        }
+      }
+    }
+
+  if (params.isSublist("Preconditioner"))
+    {
+    Teuchos::ParameterList const &precList = params.sublist("Preconditioner");
+    Hash(hash, "Preconditioner");
+    for (const char *name: {"Partitioner", "B-Grid Transform",
+          "Eliminate Retained Nodes Together", "Eliminate Velocities Together"})
+      {
+      HashEntry(hash, precList, name);
+      }
+    // this includes the variants for each direction and level
+    for (const char *prefix: {"Separator Length", "Coarsening Factor", "Retain Nodes"})
+      {
+      for (std::string const &name: NamesWithPrefix(precList, prefix))
+        {
+        HashEntry(hash, precList, name);
+        }
+      }
+    }
+  }
+
+Teuchos::Array<hymls_gidx> MyGIDs(Epetra_Map const &map)
+  {
+  Teuchos::Array<hymls_gidx> gids(map.NumMyElements());
+  for (int i = 0; i < map.NumMyElements(); i++)
+    gids[i] = map.GID64(i);
+  return gids;
+  }
+
+  }
+
+// the data of one level as it is read from a file. The maps are only
+// created once all processors have read their file successfully.
+struct OverlappingPartitioner::SavedLevel
+  {
+  int level;
+  double partitionTime;
+  long long numGlobalElements;
+  long long indexBase;
+  Teuchos::Array<hymls_gidx> gids;
+  long long inputIndexBase;
+  Teuchos::Array<hymls_gidx> inputGids;
+  int hasOverlappingMap;
+  Teuchos::Array<hymls_gidx> overlappingGids;
+  Teuchos::Array<InteriorGroup> interiorGroups;
+  Teuchos::Array<Teuchos::Array<SeparatorGroup> > separatorGroups;
+  Teuchos::RCP<const Epetra_Map> map;
+  Teuchos::RCP<const Epetra_Map> inputMap;
+  Teuchos::RCP<const Epetra_Map> overlappingMap;
+  };
+
 //constructor
 
 // we call the base class constructor with a lot of null-pointers and create the
@@ -34,9 +204,13 @@ OverlappingPartitioner::OverlappingPartitioner(
   Teuchos::RCP<const Epetra_Map> overlappingMap)
   :
   HierarchicalMap(map, overlappingMap, 0, "OverlappingPartitioner", level),
-  PLA("Problem")
+  PLA("Problem"),
+  inputMap_(map),
+  nextLevelLoaded_(false),
+  partitionTime_(0.0)
   {
   HYMLS_PROF2(Label(),"Constructor");
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
 
   setParameterList(params);
 
@@ -74,9 +248,46 @@ OverlappingPartitioner::OverlappingPartitioner(
 
   CHECK_ZERO(DetectSeparators(partitioner));
   HYMLS_DEBVAR(*this);
+
+  partitionTime_ = std::chrono::duration<double>(
+    std::chrono::steady_clock::now() - start).count();
   return;
   }
 
+OverlappingPartitioner::OverlappingPartitioner(SavedLevel const &saved,
+  Teuchos::RCP<Teuchos::ParameterList> params)
+  :
+  HierarchicalMap(saved.map, saved.overlappingMap, 0, "OverlappingPartitioner",
+    saved.level),
+  PLA("Problem"),
+  inputMap_(saved.inputMap),
+  nextLevelLoaded_(false),
+  partitionTime_(saved.partitionTime)
+  {
+  HYMLS_PROF2(Label(),"Constructor");
+
+  setParameterList(params);
+
+  // the partitioner is only needed to set the parameters for the next
+  // level, the groups are taken from the saved data
+  Teuchos::RCP<const BasePartitioner> partitioner = CreatePartitioner();
+
+  nextLevelParams_ = Teuchos::rcp(new Teuchos::ParameterList(*getMyParamList()));
+  partitioner->SetNextLevelParameters(*nextLevelParams_);
+
+  Reset(saved.interiorGroups.size());
+
+  for (int sd = 0; sd < saved.interiorGroups.size(); sd++)
+    {
+    CHECK_ZERO(AddInteriorGroup(sd, saved.interiorGroups[sd]));
+    for (auto const &group: saved.separatorGroups[sd])
+      AddSeparatorGroup(sd, group);
+    }
+
+  CHECK_ZERO(FillComplete());
+  HYMLS_DEBVAR(*this);
+  }
+
 OverlappingPartitioner::~OverlappingPartitioner()
   {
   HYMLS_PROF3(Label(),"Destructor");
@@ -96,6 +307,15 @@ void OverlappingPartitioner::setParameterList(
 Teuchos::RCP<const BasePartitioner> OverlappingPartitioner::Partition()
   {
   HYMLS_PROF2(Label(), "Partition");
+  Teuchos::RCP<BasePartitioner> partitioner = CreatePartitioner();
+
+  CHECK_ZERO(partitioner->Partition(false));
+
+  return partitioner;
+  }
+
+Teuchos::RCP<BasePartitioner> OverlappingPartitioner::CreatePartitioner()
+  {
   Teuchos::RCP<BasePartitioner> partitioner = Teuchos::null;
   if (partitioningMethod_ == "Cartesian")
     {
@@ -112,9 +332,6 @@ Teuchos::RCP<const BasePartitioner> OverlappingPartitioner::Partition()
     Tools::Error("Up to now we only support Cartesian partitioning",
       __FILE__, __LINE__);
     }
-
-  CHECK_ZERO(partitioner->Partition(false));
-
   return partitioner;
   }
 
@@ -152,10 +369,223 @@ Teuchos::RCP<const OverlappingPartitioner> OverlappingPartitioner::SpawnNextLeve
   {
   HYMLS_PROF2(Label(), "SpawnNextLevel");
 
-  Teuchos::RCP<const OverlappingPartitioner> newLevel;
-  newLevel = Teuchos::rcp(new OverlappingPartitioner(
+  // A level that was read by Load() is only used for exactly the map it
+  // was partitioned from. Both conditions are the same on all processors.
+  if (nextLevelLoaded_ && nextLevel_ != Teuchos::null &&
+    nextLevel_->InputMap().SameAs(*map))
+    {
+    return nextLevel_;
+    }
+
+  nextLevel_ = Teuchos::rcp(new OverlappingPartitioner(
       map, nextLevelParams_, Level()+1, overlappingMap));
-  return newLevel;
+  nextLevelLoaded_ = false;
+  return nextLevel_;
+  }
+
+std::string OverlappingPartitioner::CacheKey(Epetra_Map const &map,
+  Teuchos::ParameterList const &params)
+  {
+  HYMLS_PROF3("OverlappingPartitioner", "CacheKey");
+
+  unsigned long long hash = hashOffset;
+  for (int i = 0; i < map.NumMyElements(); i++)
+    {
+    hymls_gidx gid = map.GID64(i);
+    Hash(hash, &gid, sizeof(gid));
+    }
+
+  // combine the hashes of all processors in order, so the key also
+  // depends on the distribution of the map
+  long long myHash = (long long)hash;
+  std::vector<long long> hashes(map.Comm().NumProc());
+  CHECK_ZERO(map.Comm().GatherAll(&myHash, hashes.data(), 1));
+
+  hash = hashOffset;
+  Hash(hash, hashes.data(), hashes.size() * sizeof(long long));
+
+  HashPartitionerParameters(hash, params);
+
+  std::ostringstream ss;
+  ss << std::hex << std::setw(16) << std::setfill('0') << hash;
+  return ss.str();
+  }
+
+double OverlappingPartitioner::PartitionTime() const
+  {
+  double time = 0.0;
+  for (const OverlappingPartitioner *hid = this; hid != NULL;
+       hid = hid->nextLevel_.get())
+    {
+    time += hid->partitionTime_;
+    }
+  return time;
+  }
+
+int OverlappingPartitioner::Save(std::ostream &os) const
+  {
+  HYMLS_PROF2(Label(), "Save");
+
+  os.write(saveMagic, sizeof(saveMagic));
+  Write(os, saveVersion);
+  Write(os, Comm().NumProc());
+  Write(os, Comm().MyPID());
+  Write(os, (int)sizeof(hymls_gidx));
+
+  for (const OverlappingPartitioner *hid = this; hid != NULL;
+       hid = hid->nextLevel_.get())
+    {
+    Write(os, 1);
+    CHECK_ZERO(hid->SaveLevel(os));
+    }
+  Write(os, 0);
+
+  return os.fail() ? -1 : 0;
+  }
+
+int OverlappingPartitioner::SaveLevel(std::ostream &os) const
+  {
+  Write(os, Level());
+  Write(os, partitionTime_);
+
+  Write(os, (long long)Map().NumGlobalElements64());
+  Write(os, (long long)Map().IndexBase64());
+  WriteArray(os, MyGIDs(Map()));
+
+  Write(os, (long long)inputMap_->IndexBase64());
+  WriteArray(os, MyGIDs(*inputMap_));
+
+  Write(os, baseOverlappingMap_ != Teuchos::null ? 1 : 0);
+  if (baseOverlappingMap_ != Teuchos::null)
+    WriteArray(os, MyGIDs(*baseOverlappingMap_));
+
+  Write(os, NumMySubdomains());
+  for (int sd = 0; sd < NumMySubdomains(); sd++)
+    {
+    InteriorGroup const &interior_group = GetInteriorGroup(sd);
+    Write(os, interior_group.type());
+    WriteArray(os, interior_group.nodes());
+
+    Write(os, NumSeparatorGroups(sd));
+    for (SeparatorGroup const &group: GetSeparatorGroups(sd))
+      {
+      Write(os, group.type());
+      WriteArray(os, group.nodes());
+      }
+    }
+  return os.fail() ? -1 : 0;
+  }
+
+int OverlappingPartitioner::ReadLevel(std::istream &is, SavedLevel &saved)
+  {
+  if (!Read(is, saved.level) || !Read(is, saved.partitionTime) ||
+    !Read(is, saved.numGlobalElements) ||
+    !Read(is, saved.indexBase) || !ReadArray(is, saved.gids) ||
+    !Read(is, saved.inputIndexBase) || !ReadArray(is, saved.inputGids) ||
+    !Read(is, saved.hasOverlappingMap))
+    return -1;
+
+  if (saved.hasOverlappingMap && !ReadArray(is, saved.overlappingGids))
+    return -1;
+
+  int numMySubdomains;
+  if (!Read(is, numMySubdomains) || numMySubdomains < 0)
+    return -1;
+
+  saved.interiorGroups.resize(numMySubdomains);
+  saved.separatorGroups.resize(numMySubdomains);
+  for (int sd = 0; sd < numMySubdomains; sd++)
+    {
+    int type, numGroups;
+    if (!Read(is, type) || !ReadArray(is, saved.interiorGroups[sd].nodes()))
+      return -1;
+    saved.interiorGroups[sd].set_type(type);
+
+    if (!Read(is, numGroups) || numGroups < 0)
+      return -1;
+    saved.separatorGroups[sd].resize(numGroups);
+    for (SeparatorGroup &group: saved.separatorGroups[sd])
+      {
+      if (!Read(is, type) || !ReadArray(is, group.nodes()))
+        return -1;
+      group.set_type(type);
+      }
+    }
+  return 0;
+  }
+
+Teuchos::RCP<OverlappingPartitioner> OverlappingPartitioner::Load(
+  std::istream &is, Epetra_Comm const &comm,
+  Teuchos::RCP<Teuchos::ParameterList> params)
+  {
+  HYMLS_PROF2("OverlappingPartitioner", "Load");
+
+  // first read everything, so that all processors can agree on whether
+  // the data is usable before any collective calls are made
+  Teuchos::Array<SavedLevel> levels;
+
+  int ierr = 0;
+  char magic[sizeof(saveMagic)];
+  int version, numProc, myPID, gidxSize, hasLevel;
+  is.read(magic, sizeof(magic));
+  if (is.fail() || std::memcmp(magic, saveMagic, sizeof(magic)) ||
+    !Read(is, version) || version != saveVersion ||
+    !Read(is, numProc) || numProc != comm.NumProc() ||
+    !Read(is, myPID) || myPID != comm.MyPID() ||
+    !Read(is, gidxSize) || gidxSize != (int)sizeof(hymls_gidx))
+    {
+    ierr = -1;
+    }
+
+  while (!ierr && Read(is, hasLevel) && hasLevel)
+    {
+    levels.resize(levels.size() + 1);
+    ierr = ReadLevel(is, levels.back());
+    if (!ierr && levels.back().level != levels[0].level + levels.size() - 1)
+      ierr = -1;
+    }
+
+  if (is.fail() || levels.size() == 0)
+    ierr = -1;
+
+  int globalErr;
+  comm.MinAll(&ierr, &globalErr, 1);
+  if (globalErr)
+    {
+    Tools::Warning("could not read the partitioning",
+      __FILE__, __LINE__);
+    return Teuchos::null;
+    }
+
+  Teuchos::RCP<OverlappingPartitioner> hid;
+  OverlappingPartitioner *prev = NULL;
+  for (SavedLevel &saved: levels)
+    {
+    saved.map = Teuchos::rcp(new Epetra_Map((hymls_gidx)saved.numGlobalElements,
+        saved.gids.size(), saved.gids.getRawPtr(),
+        (hymls_gidx)saved.indexBase, comm));
+    saved.inputMap = Teuchos::rcp(new Epetra_Map((hymls_gidx)saved.numGlobalElements,
+        saved.inputGids.size(), saved.inputGids.getRawPtr(),
+        (hymls_gidx)saved.inputIndexBase, comm));
+    if (saved.hasOverlappingMap)
+      {
+      saved.overlappingMap = Teuchos::rcp(new Epetra_Map((hymls_gidx)(-1),
+          saved.overlappingGids.size(), saved.overlappingGids.getRawPtr(),
+          (hymls_gidx)saved.indexBase, comm));
+      }
+
+    Teuchos::RCP<OverlappingPartitioner> level = Teuchos::rcp(
+      new OverlappingPartitioner(saved, prev ? prev->nextLevelParams_ : params));
+    if (prev)
+      {
+      prev->nextLevel_ = level;
+      prev->nextLevelLoaded_ = true;
+      }
+    else
+      hid = level;
+    prev = level.get();
+    }
+  return hid;
   }
 
 }//namespace
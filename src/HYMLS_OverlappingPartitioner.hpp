@@ -8,6 +8,7 @@
 
 #include "Teuchos_RCP.hpp"
 
+#include <iosfwd>
 #include <string>
 
 namespace Teuchos
@@ -16,6 +17,7 @@ class ParameterList;
 template <typename T> class Array;
   }
 
+class Epetra_Comm;
 class Epetra_Map;
 
 namespace HYMLS {
@@ -58,14 +60,44 @@ public:
   //! (I think the RecursiveO.P. should become the Base, and this class
   //! the sole implementation)
   //!
-  //! Whereas the Spawn functions in HierarchicalMap
-  //! retain a copy of the spawned object, this class doesn't. So you
-  //! should call it only once and keep an RCP yourself.
+  //! The spawned object is kept, so that Save() can write the whole
+  //! hierarchy. If the next level was read by Load() and it was
+  //! partitioned from the same map, that object is returned instead of
+  //! partitioning the map again.
   //!
   Teuchos::RCP<const OverlappingPartitioner> SpawnNextLevel(
     Teuchos::RCP<const Epetra_Map> map,
     Teuchos::RCP<const Epetra_Map> overlappingMap) const;
 
+  //! the map that was partitioned. Map() is the map of the partitioner,
+  //! which may distribute the same elements differently.
+  Epetra_Map const &InputMap() const {return *inputMap_;}
+
+  //! wall time in seconds that this processor spent partitioning this
+  //! level and the levels spawned from it. For levels read by Load() this
+  //! is the time it took when they were saved, which is the time that
+  //! loading them saves.
+  double PartitionTime() const;
+
+  //! write the subdomains and groups of this level and all levels spawned
+  //! from it to a binary stream. Every processor writes its own part, so
+  //! the stream should be a separate file per processor. Only the
+  //! partitioning is written, nothing that depends on the matrix values.
+  int Save(std::ostream &os) const;
+
+  //! read a hierarchy written by Save() on the same number of processors.
+  //! The partitioning is not computed again. This is a collective call,
+  //! it returns null on all processors if any of the streams is invalid.
+  static Teuchos::RCP<OverlappingPartitioner> Load(std::istream &is,
+    Epetra_Comm const &comm, Teuchos::RCP<Teuchos::ParameterList> params);
+
+  //! returns a key that identifies the partitioning of map with the given
+  //! parameters, built from a hash of the GIDs on all processors and of
+  //! the parameters in the "Problem" and "Preconditioner" sublists that
+  //! the partitioners read. This is a collective call.
+  static std::string CacheKey(Epetra_Map const &map,
+    Teuchos::ParameterList const &params);
+
   //! from the PLA base class
   void setParameterList(const Teuchos::RCP<Teuchos::ParameterList>& params);
 
@@ -76,6 +108,22 @@ protected:
 
 private:
 
+  //! one level of a hierarchy as read by Load()
+  struct SavedLevel;
+
+  //! constructor from a level read by Load(), skips the partitioning
+  OverlappingPartitioner(SavedLevel const &saved,
+    Teuchos::RCP<Teuchos::ParameterList> params);
+
+  //! create the partitioner object without partitioning yet
+  Teuchos::RCP<BasePartitioner> CreatePartitioner();
+
+  //! write the subdomains and groups of this level only
+  int SaveLevel(std::ostream &os) const;
+
+  //! read the data written by SaveLevel() without creating any maps
+  static int ReadLevel(std::istream &is, SavedLevel &saved);
+
   //! Step 2: construct overlapping maps after partitioning
   //! the result is a HierarchicalMap with three groups per
   //! subdomain: interior, separator and retained.
@@ -87,6 +135,18 @@ private:
   //! Parameterlist for the next level
   Teuchos::RCP<Teuchos::ParameterList> nextLevelParams_;
 
+  //! map passed to the constructor (or the one it had when it was saved)
+  Teuchos::RCP<const Epetra_Map> inputMap_;
+
+  //! next level object, either spawned or loaded
+  mutable Teuchos::RCP<const OverlappingPartitioner> nextLevel_;
+
+  //! nextLevel_ was read by Load() and not spawned
+  mutable bool nextLevelLoaded_;
+
+  //! time spent partitioning this level, see PartitionTime()
+  double partitionTime_;
+
   //!@}
   };
 
@@ -0,0 +1,491 @@
+#include "HYMLS_PipelinedGmresSolMgr.hpp"
+
+#include "HYMLS_Macros.hpp"
+#include "HYMLS_Tools.hpp"
+
+#include "Epetra_Comm.h"
+#include "Epetra_BLAS.h"
+#include "Epetra_MultiVector.h"
+#include "Epetra_Operator.h"
+
+#ifdef HAVE_MPI
+#include "Epetra_MpiComm.h"
+#include <mpi.h>
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+namespace HYMLS {
+
+namespace {
+
+//! Sum of values over all processes that can be completed later, so that
+//! other work can be done while the reduction is in progress.
+class Reduction
+  {
+public:
+
+  Reduction(Epetra_Comm const &comm)
+    :
+    comm_(comm),
+    active_(false)
+    {
+#ifdef HAVE_MPI
+    mpiComm_ = dynamic_cast<Epetra_MpiComm const *>(&comm);
+    request_ = MPI_REQUEST_NULL;
+#endif
+    }
+
+  ~Reduction()
+    {
+    Wait();
+    }
+
+  //! start summing the values. They may only be used after Wait().
+  void Start(double *values, int count)
+    {
+    Wait();
+    active_ = true;
+
+    if (comm_.NumProc() == 1)
+      {
+      return;
+      }
+
+#ifdef HAVE_MPI
+    if (mpiComm_ != NULL)
+      {
+      MPI_Iallreduce(MPI_IN_PLACE, values, count, MPI_DOUBLE, MPI_SUM,
+        mpiComm_->GetMpiComm(), &request_);
+      return;
+      }
+#endif
+
+    std::vector<double> local(values, values + count);
+    CHECK_ZERO(comm_.SumAll(&local[0], values, count));
+    }
+
+  //! wait for the reduction to finish
+  void Wait()
+    {
+    if (!active_)
+      {
+      return;
+      }
+    active_ = false;
+
+#ifdef HAVE_MPI
+    if (request_ != MPI_REQUEST_NULL)
+      {
+      MPI_Wait(&request_, MPI_STATUS_IGNORE);
+      }
+#endif
+    }
+
+private:
+
+  Epetra_Comm const &comm_;
+
+  bool active_;
+
+#ifdef HAVE_MPI
+  Epetra_MpiComm const *mpiComm_;
+
+  MPI_Request request_;
+#endif
+  };
+
+//! local parts of the dot products of z with the first n columns of V,
+//! followed by that of z with itself
+void LocalDots(Epetra_BLAS const &blas, Epetra_MultiVector const &V, int n,
+  double const *z, double *dots)
+  {
+  const int len = V.MyLength();
+  if (len == 0)
+    {
+    std::fill(dots, dots + n + 1, 0.0);
+    return;
+    }
+  blas.GEMV('T', len, n, 1.0, V[0], V.Stride(), z, 0.0, dots);
+  dots[n] = blas.DOT(len, z, z);
+  }
+
+//! y = y + alpha * V(:,first:first+n-1) * h
+void AddCombination(Epetra_BLAS const &blas, Epetra_MultiVector const &V,
+  int first, int n, double alpha, double const *h, double *y)
+  {
+  const int len = V.MyLength();
+  if (len == 0 || n == 0)
+    {
+    return;
+    }
+  blas.GEMV('N', len, n, alpha, V[first], V.Stride(), h, 1.0, y);
+  }
+
+  }
+
+PipelinedGmresSolMgr::PipelinedGmresSolMgr(Teuchos::RCP<ProblemType> const &problem,
+  Teuchos::RCP<Teuchos::ParameterList> const &params)
+  :
+  problem_(problem),
+  tol_(1.0e-8),
+  maxIters_(1000),
+  numBlocks_(300),
+  verbosity_(Belos::Errors),
+  outputFreq_(-1),
+  outputStream_(Teuchos::rcp(&std::cout, false)),
+  numIters_(0),
+  achievedTol_(0.0),
+  label_("PipelinedGmresSolMgr")
+  {
+  setParameters(params);
+  }
+
+PipelinedGmresSolMgr::~PipelinedGmresSolMgr()
+  {
+  }
+
+Teuchos::RCP<PipelinedGmresSolMgr::SolMgrType> PipelinedGmresSolMgr::clone() const
+  {
+  return Teuchos::rcp(new PipelinedGmresSolMgr(Teuchos::null,
+      Teuchos::rcp(new Teuchos::ParameterList(*params_))));
+  }
+
+Teuchos::RCP<const Teuchos::ParameterList> PipelinedGmresSolMgr::getValidParameters() const
+  {
+  static Teuchos::RCP<Teuchos::ParameterList> validParams;
+  if (validParams != Teuchos::null)
+    {
+    return validParams;
+    }
+
+  validParams = Teuchos::rcp(new Teuchos::ParameterList());
+  validParams->set("Convergence Tolerance", 1.0e-8,
+    "residual norm relative to that of the initial residual at which the solver stops");
+  validParams->set("Maximum Iterations", 1000,
+    "maximum number of iterations over all restarts");
+  validParams->set("Num Blocks", 300,
+    "number of iterations before a restart");
+  validParams->set("Verbosity", (int)Belos::Errors,
+    "sum of Belos::MsgType values");
+  validParams->set("Output Frequency", -1,
+    "print the residual norm every so many iterations, -1: never");
+  validParams->set("Output Stream", Teuchos::rcp(&std::cout, false),
+    "stream for the output");
+  validParams->set("Output Style", 1,
+    "ignored, there is only one output style");
+  return validParams;
+  }
+
+Teuchos::RCP<const Teuchos::ParameterList> PipelinedGmresSolMgr::getCurrentParameters() const
+  {
+  return params_;
+  }
+
+void PipelinedGmresSolMgr::setProblem(Teuchos::RCP<ProblemType> const &problem)
+  {
+  problem_ = problem;
+  }
+
+void PipelinedGmresSolMgr::setParameters(Teuchos::RCP<Teuchos::ParameterList> const &params)
+  {
+  if (params != Teuchos::null)
+    {
+    // Other Belos parameters, like the orthogonalization, do not apply
+    // here and are ignored. We warn about each of them once.
+    Teuchos::RCP<const Teuchos::ParameterList> validParams = getValidParameters();
+    for (Teuchos::ParameterList::ConstIterator it = params->begin();
+         it != params->end(); it++)
+      {
+      const std::string &name = params->name(it);
+      if (!validParams->isParameter(name) && ignoredParams_.insert(name).second)
+        {
+        Tools::Warning("parameter '" + name + "' is not supported by "
+          "'Pipelined GMRES' and is ignored", __FILE__, __LINE__);
+        }
+      }
+
+    if (params->isParameter("Convergence Tolerance"))
+      tol_ = params->get<double>("Convergence Tolerance");
+    if (params->isParameter("Maximum Iterations"))
+      maxIters_ = params->get<int>("Maximum Iterations");
+    if (params->isParameter("Num Blocks"))
+      numBlocks_ = params->get<int>("Num Blocks");
+    if (params->isParameter("Verbosity"))
+      verbosity_ = params->get<int>("Verbosity");
+    if (params->isParameter("Output Frequency"))
+      outputFreq_ = params->get<int>("Output Frequency");
+    if (params->isParameter("Output Stream"))
+      outputStream_ = params->get<Teuchos::RCP<std::ostream> >("Output Stream");
+    }
+
+  if (numBlocks_ < 1)
+    {
+    Tools::Error("'Num Blocks' should be positive", __FILE__, __LINE__);
+    }
+
+  params_ = Teuchos::rcp(new Teuchos::ParameterList(*getValidParameters()));
+  params_->set("Convergence Tolerance", tol_);
+  params_->set("Maximum Iterations", maxIters_);
+  params_->set("Num Blocks", numBlocks_);
+  params_->set("Verbosity", verbosity_);
+  params_->set("Output Frequency", outputFreq_);
+  params_->set("Output Stream", outputStream_);
+  }
+
+void PipelinedGmresSolMgr::reset(const Belos::ResetType type)
+  {
+  if ((type & Belos::Problem) && problem_ != Teuchos::null)
+    {
+    problem_->setProblem();
+    }
+  }
+
+Belos::ReturnType PipelinedGmresSolMgr::solve()
+  {
+  HYMLS_PROF(label_, "solve");
+
+  if (problem_ == Teuchos::null)
+    {
+    Tools::Error("the linear problem is not set", __FILE__, __LINE__);
+    }
+  if (!problem_->isProblemSet() && !problem_->setProblem())
+    {
+    Tools::Error("the linear problem could not be set up", __FILE__, __LINE__);
+    }
+
+  const int numRhs = problem_->getRHS()->NumVectors();
+  const bool printing = (problem_->getRHS()->Comm().MyPID() == 0);
+
+  numIters_ = 0;
+  achievedTol_ = 0.0;
+  bool converged = true;
+
+  for (int k = 0; k < numRhs; k++)
+    {
+    std::vector<int> index(1, k);
+    problem_->setLSIndex(index);
+
+    int numIters;
+    double relResidual;
+    converged = SolveCurrentSystem(numIters, relResidual) && converged;
+
+    problem_->setCurrLS();
+
+    numIters_ = std::max(numIters_, numIters);
+    achievedTol_ = std::max(achievedTol_, relResidual);
+
+    if (printing && (verbosity_ & Belos::FinalSummary))
+      {
+      *outputStream_ << "Pipelined GMRES [" << k + 1 << "]: "
+                     << numIters << " iterations, relative residual "
+                     << std::scientific << std::setprecision(6) << relResidual
+                     << std::endl;
+      }
+    }
+
+  return converged ? Belos::Converged : Belos::Unconverged;
+  }
+
+bool PipelinedGmresSolMgr::SolveCurrentSystem(int &numIters, double &relResidual)
+  {
+  HYMLS_PROF2(label_, "SolveCurrentSystem");
+
+  Teuchos::RCP<Epetra_MultiVector> X = problem_->getCurrLHSVec();
+  Epetra_BlockMap const &map = X->Map();
+  const bool printing = (X->Comm().MyPID() == 0) &&
+    (verbosity_ & Belos::IterationDetails) && outputFreq_ > 0;
+
+  const int m = numBlocks_;
+  const int ldh = m + 1;
+
+  // Orthonormal basis V and Z with Z(:,j+1) = OP*V(:,j), which is computed
+  // by a recurrence one iteration before V(:,j+1)
+  Epetra_MultiVector V(map, m + 1);
+  Epetra_MultiVector Z(map, m + 1);
+  Epetra_MultiVector W(map, 1);
+  Epetra_MultiVector R(map, 1);
+
+  // Hessenberg matrix, which is reduced to upper triangular form by Givens
+  // rotations, and the rotated right-hand side of the least squares problem
+  std::vector<double> H(ldh * m), cs(m), sn(m), g(m + 1), y(m);
+
+  // <z_i, v_j> for all j < i and <z_i, z_i>, summed by a single reduction
+  std::vector<double> dots(m + 2);
+
+  Epetra_BLAS blas;
+  Reduction reduction(X->Comm());
+
+  // Below this ratio of the squared norm of v_i to that of z_i, computing the
+  // norm from the dot products would lose more than half of the digits
+  const double cancellationTol = std::sqrt(std::numeric_limits<double>::epsilon());
+
+  double r0Norm = -1.0;
+  numIters = 0;
+  relResidual = 1.0;
+
+  while (true)
+    {
+    // Explicit (preconditioned) residual at every restart
+    problem_->computeCurrPrecResVec(&R);
+    double beta;
+    CHECK_ZERO(R.Norm2(&beta));
+    if (r0Norm < 0.0)
+      {
+      r0Norm = beta;
+      }
+    relResidual = r0Norm > 0.0 ? beta / r0Norm : 0.0;
+    if (relResidual <= tol_)
+      {
+      return true;
+      }
+    if (numIters >= maxIters_)
+      {
+      return false;
+      }
+
+    Epetra_MultiVector v0(View, V, 0, 1);
+    Epetra_MultiVector z1(View, Z, 1, 1);
+    CHECK_ZERO(v0.Scale(1.0 / beta, R));
+    std::fill(g.begin(), g.end(), 0.0);
+    g[0] = beta;
+
+    problem_->apply(v0, z1);
+    LocalDots(blas, V, 1, Z[1], &dots[0]);
+    reduction.Start(&dots[0], 2);
+
+    int k = 0;
+    bool breakdown = false;
+    for (int i = 1; i <= m; i++)
+      {
+      Epetra_MultiVector zi(View, Z, i, 1);
+      Epetra_MultiVector vi(View, V, i, 1);
+
+      // This is where the reduction of the previous iteration is hidden
+      if (i < m)
+        {
+        problem_->apply(zi, W);
+        }
+      reduction.Wait();
+
+      // column i-1 of the Hessenberg matrix
+      double *h = &H[(i - 1) * ldh];
+      double s = dots[i];
+      for (int j = 0; j < i; j++)
+        {
+        h[j] = dots[j];
+        s -= h[j] * h[j];
+        }
+
+      // v_i = (z_i - V*h) / h_i
+      CHECK_ZERO(vi.Update(1.0, zi, 0.0));
+      AddCombination(blas, V, 0, i, -1.0, h, V[i]);
+      if (s > cancellationTol * dots[i])
+        {
+        h[i] = std::sqrt(s);
+        }
+      else
+        {
+        CHECK_ZERO(vi.Norm2(&h[i]));
+        }
+
+      breakdown = (h[i] <= std::numeric_limits<double>::epsilon() * std::sqrt(dots[i]));
+      if (!breakdown)
+        {
+        CHECK_ZERO(vi.Scale(1.0 / h[i]));
+        }
+
+      // z_{i+1} = OP*v_i = (OP*z_i - Z*h) / h_i, and start the reduction for
+      // the next column, which is completed in the next iteration
+      if (i < m && !breakdown)
+        {
+        Epetra_MultiVector zn(View, Z, i + 1, 1);
+        CHECK_ZERO(zn.Update(1.0 / h[i], W, 0.0));
+        for (int j = 0; j < i; j++)
+          {
+          y[j] = h[j] / h[i];
+          }
+        AddCombination(blas, Z, 1, i, -1.0, &y[0], Z[i + 1]);
+        LocalDots(blas, V, i + 1, Z[i + 1], &dots[0]);
+        reduction.Start(&dots[0], i + 2);
+        }
+
+      // apply the previous rotations to the new column
+      for (int j = 0; j < i - 1; j++)
+        {
+        const double tmp = cs[j] * h[j] + sn[j] * h[j + 1];
+        h[j + 1] = -sn[j] * h[j] + cs[j] * h[j + 1];
+        h[j] = tmp;
+        }
+
+      // and compute a new one to eliminate h_i
+      const double a = h[i - 1];
+      const double b = h[i];
+      if (b == 0.0)
+        {
+        cs[i - 1] = 1.0;
+        sn[i - 1] = 0.0;
+        }
+      else if (std::abs(b) > std::abs(a))
+        {
+        const double t = a / b;
+        sn[i - 1] = 1.0 / std::sqrt(1.0 + t * t);
+        cs[i - 1] = sn[i - 1] * t;
+        }
+      else
+        {
+        const double t = b / a;
+        cs[i - 1] = 1.0 / std::sqrt(1.0 + t * t);
+        sn[i - 1] = cs[i - 1] * t;
+        }
+      h[i - 1] = cs[i - 1] * a + sn[i - 1] * b;
+      h[i] = 0.0;
+      g[i] = -sn[i - 1] * g[i - 1];
+      g[i - 1] = cs[i - 1] * g[i - 1];
+
+      k = i;
+      numIters++;
+      relResidual = std::abs(g[i]) / r0Norm;
+
+      if (printing && numIters % outputFreq_ == 0)
+        {
+        *outputStream_ << "Iter " << std::setw(5) << numIters << " : "
+                       << std::scientific << std::setprecision(6) << relResidual
+                       << std::endl;
+        }
+
+      if (relResidual <= tol_ || numIters >= maxIters_ || breakdown)
+        {
+        break;
+        }
+      }
+
+    // a reduction may still be in progress if we stopped early
+    reduction.Wait();
+
+    // solve the upper triangular system and update the solution with V*y.
+    // The linear problem applies the right preconditioner to the update.
+    for (int j = k - 1; j >= 0; j--)
+      {
+      y[j] = g[j];
+      for (int l = j + 1; l < k; l++)
+        {
+        y[j] -= H[j + l * ldh] * y[l];
+        }
+      y[j] /= H[j + j * ldh];
+      }
+
+    CHECK_ZERO(R.PutScalar(0.0));
+    AddCombination(blas, V, 0, k, 1.0, &y[0], R[0]);
+    problem_->updateSolution(Teuchos::rcp(&R, false), true);
+    }
+
+  return false;
+  }
+
+  }
@@ -0,0 +1,146 @@
+#ifndef HYMLS_PIPELINED_GMRES_SOLMGR_H
+#define HYMLS_PIPELINED_GMRES_SOLMGR_H
+
+#include "HYMLS_config.h"
+
+#include "Teuchos_RCP.hpp"
+#include "Teuchos_ParameterList.hpp"
+
+#include "BelosTypes.hpp"
+#include "BelosSolverManager.hpp"
+#include "BelosLinearProblem.hpp"
+
+#include <ostream>
+#include <set>
+#include <string>
+
+class Epetra_MultiVector;
+class Epetra_Operator;
+
+namespace HYMLS {
+
+//! Pipelined GMRES, p(1)-GMRES from Ghysels et al. (2013), as a Belos
+//! solver manager for Epetra objects.
+//!
+//! In standard GMRES every iteration has to wait for the global reductions
+//! of the Gram-Schmidt process before the next operator application can
+//! start. Here the next basis vector is computed by a recurrence one
+//! iteration ahead, so the reduction for the orthogonalization of iteration
+//! i is started with a non-blocking allreduce and completed only after the
+//! operator (and preconditioner) application of iteration i+1. The dot
+//! products of an iteration are combined in a single reduction, and the norm
+//! of the new basis vector follows from them. If that would lose too much
+//! accuracy, the norm is computed explicitly (with a blocking reduction).
+//!
+//! Multiple right-hand sides are solved one after the other. Preconditioning
+//! is done by the linear problem, so both left and right preconditioning
+//! are supported.
+//!
+//! Parameters (in the "Iterative Solver" list):
+//!
+//! - "Convergence Tolerance": relative to the norm of the initial
+//!   (preconditioned) residual (default 1e-8)
+//! - "Maximum Iterations": total number of iterations (default 1000)
+//! - "Num Blocks": number of iterations before a restart (default 300)
+//! - "Verbosity", "Output Frequency", "Output Stream": as for the Belos
+//!   solvers.
+//!
+//! Other parameters are ignored with a warning.
+class PipelinedGmresSolMgr :
+    public Belos::SolverManager<double, Epetra_MultiVector, Epetra_Operator>
+  {
+
+  using ProblemType = Belos::LinearProblem<
+    double, Epetra_MultiVector, Epetra_Operator>;
+  using SolMgrType = Belos::SolverManager<
+    double, Epetra_MultiVector, Epetra_Operator>;
+
+public:
+
+  //! constructor
+  PipelinedGmresSolMgr(Teuchos::RCP<ProblemType> const &problem,
+    Teuchos::RCP<Teuchos::ParameterList> const &params);
+
+  //! destructor
+  virtual ~PipelinedGmresSolMgr();
+
+  //! create a new solver manager with the same parameters, but no problem
+  virtual Teuchos::RCP<SolMgrType> clone() const;
+
+  //! the linear problem
+  virtual const ProblemType &getProblem() const {return *problem_;}
+
+  //! valid parameters
+  virtual Teuchos::RCP<const Teuchos::ParameterList> getValidParameters() const;
+
+  //! the parameters in use
+  virtual Teuchos::RCP<const Teuchos::ParameterList> getCurrentParameters() const;
+
+  //! largest relative residual norm of the last solve
+  virtual double achievedTol() const {return achievedTol_;}
+
+  //! largest number of iterations of the right-hand sides in the last solve
+  virtual int getNumIters() const {return numIters_;}
+
+  //! loss of accuracy detection is not implemented
+  virtual bool isLOADetected() const {return false;}
+
+  //! set the linear problem
+  virtual void setProblem(Teuchos::RCP<ProblemType> const &problem);
+
+  //! set the parameters
+  virtual void setParameters(Teuchos::RCP<Teuchos::ParameterList> const &params);
+
+  //! reset the solver manager
+  virtual void reset(const Belos::ResetType type);
+
+  //! solve the linear problem
+  virtual Belos::ReturnType solve();
+
+protected:
+
+  //! solve the current linear system, which has a single right-hand side.
+  //! Returns whether it converged and sets the number of iterations and the
+  //! relative residual norm.
+  bool SolveCurrentSystem(int &numIters, double &relResidual);
+
+  //! the linear problem
+  Teuchos::RCP<ProblemType> problem_;
+
+  //! the current parameters
+  Teuchos::RCP<Teuchos::ParameterList> params_;
+
+  //! convergence tolerance
+  double tol_;
+
+  //! maximum number of iterations
+  int maxIters_;
+
+  //! restart length
+  int numBlocks_;
+
+  //! Belos verbosity
+  int verbosity_;
+
+  //! print the residual every so many iterations, -1: never
+  int outputFreq_;
+
+  //! output stream
+  Teuchos::RCP<std::ostream> outputStream_;
+
+  //! parameters that we warned about because they are ignored
+  std::set<std::string> ignoredParams_;
+
+  //! number of iterations of the last solve
+  int numIters_;
+
+  //! achieved tolerance of the last solve
+  double achievedTol_;
+
+  //! label for timing
+  std::string label_;
+  };
+
+  }
+
+#endif
@@ -24,6 +24,7 @@
 #include "Epetra_MultiVector.h"
 #include "Epetra_Vector.h"
 #include "Epetra_CrsMatrix.h"
+#include "Epetra_CrsGraph.h"
 #include "Epetra_FECrsMatrix.h"
 
 #include "EpetraExt_MatrixMatrix.h"
@@ -38,10 +39,22 @@
 #include "Teuchos_StandardParameterEntryValidators.hpp"
 #include "Teuchos_Utils.hpp"
 
+#include <cstdio>
 #include <fstream>
+#include <vector>
+
+#include <unistd.h>
 
 namespace HYMLS {
 
+namespace {
+
+//! slots of the workspace vectors used in ApplyInverse()
+enum {WS_X1, WS_B1, WS_B2, WS_Y1, WS_Y2, WS_SCHUR_RHS, WS_SCHUR_SOL, WS_BT, WS_XT,
+  WS_X12, WS_B12};
+
+  }
+
 // constructor
 Preconditioner::Preconditioner(Teuchos::RCP<const Epetra_RowMatrix> K,
   Teuchos::RCP<Teuchos::ParameterList> params,
@@ -57,7 +70,7 @@ Preconditioner::Preconditioner(Teuchos::RCP<const Epetra_RowMatrix> K,
     numInitialize_(0), numCompute_(0), numApplyInverse_(0),
     flopsInitialize_(0.0), flopsCompute_(0.0), flopsApplyInverse_(0.0),
     timeInitialize_(0.0), timeCompute_(0.0), timeApplyInverse_(0.0),
-    numThreadsSD_(-1), bgridTransform_(false)
+    numThreadsSD_(-1), bgridTransform_(false), asyncComm_(false)
   {
   HYMLS_LPROF3(label_,"Constructor");
   serialComm_=Teuchos::rcp(new Epetra_SerialComm());
@@ -103,6 +116,8 @@ int Preconditioner::SetParameters(Teuchos::ParameterList& List)
   sdSolverType_ = PL().get("Subdomain Solver Type", "Sparse");
   numThreadsSD_ = PL().get("Subdomain Solver Num Threads", numThreadsSD_);
   bgridTransform_ = PL().get("B-Grid Transform", false);
+  asyncComm_ = PL().get("Asynchronous Communication", false);
+  partitionCache_ = PL().get("Partition Cache Directory", "");
   maxLevel_ = PL().get("Number of Levels", 1);
 
   if (schurPrec_!=Teuchos::null)
@@ -260,6 +275,15 @@ Preconditioner::getValidParameters() const
 
   VPL().set("B-Grid Transform", false, "Apply a transformation to turn a B-grid type matrix into an F-matrix");
 
+  VPL().set("Asynchronous Communication", false,
+    "Overlap the import of the right-hand side and the export of the solution "
+    "with the subdomain solves in ApplyInverse");
+
+  VPL().set("Partition Cache Directory", "",
+    "Directory in which the partitioning of all levels is stored, so that "
+    "later runs with the same map and parameters can skip the partitioning. "
+    "Caching is disabled if this is empty");
+
   std::string retainExtensions[4] = {"", " (x)", " (y)", " (z)"};
   for (std::string const &extension : retainExtensions)
     {
@@ -280,6 +304,18 @@ int Preconditioner::Initialize()
   {
   HYMLS_LPROF(label_,"Initialize");
   time_->ResetStartTime();
+  if (hid_==Teuchos::null && partitionCache_ != "")
+    {
+    // the partitioning only depends on the map and the parameters, so
+    // we can reuse one that was computed by an earlier run
+    std::string filename = partitionCache_ + "/partition_" +
+      OverlappingPartitioner::CacheKey(*rangeMap_, *getMyParamList());
+    if (Load(filename) != 0)
+      {
+      partitionCacheFile_ = filename;
+      }
+    }
+
   if (hid_==Teuchos::null)
     {
     HYMLS_DEBVAR(*getMyNonconstParamList());
@@ -345,6 +381,24 @@ int Preconditioner::Initialize()
   A22_ = Teuchos::rcp(new MatrixBlock(hid_,
       HierarchicalMap::Separators, HierarchicalMap::Separators, myLevel_));
 
+  // The interior and separator nodes of a processor are disjoint, so the
+  // right-hand side and solution of both blocks can be communicated in
+  // a single import/export with the combined map
+  Epetra_Map const &map1 = A12_->RowMap();
+  Epetra_Map const &map2 = A21_->RowMap();
+  std::vector<hymls_gidx> gids12(map1.NumMyElements() + map2.NumMyElements());
+  for (int i = 0; i < map1.NumMyElements(); i++)
+    {
+    gids12[i] = map1.GID64(i);
+    }
+  for (int i = 0; i < map2.NumMyElements(); i++)
+    {
+    gids12[map1.NumMyElements() + i] = map2.GID64(i);
+    }
+  map12_ = Teuchos::rcp(new Epetra_Map((hymls_gidx)(-1), (int)gids12.size(),
+      gids12.data(), (hymls_gidx)map1.IndexBase64(), *comm_));
+  import12_ = Teuchos::rcp(new Epetra_Import(*map12_, *rangeMap_));
+
   Teuchos::RCP<Teuchos::ParameterList> sd_list = Teuchos::rcp(new
     Teuchos::ParameterList(PL().sublist("Sparse Solver")));
 
@@ -353,8 +407,6 @@ int Preconditioner::Initialize()
 
   HYMLS_DEBUG("Create Schur-complement");
 
-  Epetra_Map const &map2 = A22_->RowMap();
-
   // construct the Schur-complement operator (no computations, just
   // pass in pointers of the LU's)
   Schur_ = Teuchos::rcp(new SchurComplement(
@@ -380,10 +432,10 @@ int Preconditioner::Initialize()
     CHECK_ZERO(schurPrec_->Initialize());
     }
 
-  // create Belos' view of the Schur-complement problem
-  schurRhs_=Teuchos::rcp(new Epetra_Vector(map2));
-  schurSol_=Teuchos::rcp(new Epetra_Vector(map2));
-  schurSol_->PutScalar(0.0);
+  // the maps of the workspace vectors may have changed
+  workspace_.Clear();
+  reorderedMatrix_ = Teuchos::null;
+  reorderedSource_ = Teuchos::null;
 
   initialized_ = true;
   computed_ = false;
@@ -415,7 +467,6 @@ int Preconditioner::Compute()
 
     TransformMatrix();
 
-    int MaxNumEntriesPerRow = matrix_->MaxNumEntries();
     Teuchos::RCP<const Epetra_CrsMatrix> Acrs = Teuchos::null;
     Acrs = Teuchos::rcp_dynamic_cast<const Epetra_CrsMatrix>(matrix_);
 
@@ -425,11 +476,8 @@ int Preconditioner::Compute()
       }
 
     HYMLS_DEBUG("Reorder global matrix");
-    Teuchos::RCP<Epetra_CrsMatrix> reorderedMatrix =
-      Teuchos::rcp(new Epetra_CrsMatrix(Copy, *rowMap_, MaxNumEntriesPerRow));
-
-    CHECK_ZERO(reorderedMatrix->Import(*Acrs, *importer_, Insert));
-    CHECK_ZERO(reorderedMatrix->FillComplete());
+    CHECK_ZERO(ReorderMatrix(Acrs));
+    Teuchos::RCP<Epetra_CrsMatrix> reorderedMatrix = reorderedMatrix_;
 
     // Compute the A12, A21, A22 blocks
     CHECK_ZERO(A12_->Compute(Acrs, reorderedMatrix));
@@ -493,9 +541,19 @@ int Preconditioner::Compute()
 
     CHECK_ZERO(Schur_->Construct(matrix));
 
-    schurPrec_ = Teuchos::rcp(new CoarseSolver(
-        MatrixUtils::DropByValue(matrix, HYMLS_SMALL_ENTRY), myLevel_));
-    CHECK_ZERO(schurPrec_->SetParameters(PL()));
+    // keep the coarse solver if it can reuse its pattern
+    Teuchos::RCP<CoarseSolver> coarseSolver =
+      Teuchos::rcp_dynamic_cast<CoarseSolver>(schurPrec_);
+    if (coarseSolver != Teuchos::null && coarseSolver->ReuseSymbolic())
+      {
+      coarseSolver->SetMatrix(MatrixUtils::DropByValue(matrix, HYMLS_SMALL_ENTRY));
+      }
+    else
+      {
+      schurPrec_ = Teuchos::rcp(new CoarseSolver(
+          MatrixUtils::DropByValue(matrix, HYMLS_SMALL_ENTRY), myLevel_));
+      CHECK_ZERO(schurPrec_->SetParameters(PL()));
+      }
     CHECK_ZERO(schurPrec_->Initialize());
     }
 
@@ -507,6 +565,39 @@ int Preconditioner::Compute()
   timeCompute_ += time_->ElapsedTime();
   numCompute_++;
 
+  if (partitionCacheFile_ != "")
+    {
+    // write to a temporary file first, so other runs that use the same
+    // cache never read a partially written file. All processors use the
+    // process id of the first one for the name.
+    std::string rank = "." + Teuchos::toString(comm_->MyPID());
+    int pid = (int)getpid();
+    CHECK_ZERO(comm_->Broadcast(&pid, 1, 0));
+    std::string tmpFile = partitionCacheFile_ + ".tmp" + Teuchos::toString(pid);
+    int ierr = Save(tmpFile);
+    if (ierr == 0)
+      {
+      // If any of the renames fails, we remove all files of this cache
+      // entry, so a later Load() fails on all processors
+      ierr = std::rename((tmpFile + rank).c_str(),
+        (partitionCacheFile_ + rank).c_str()) == 0 ? 0 : -1;
+      int globalErr;
+      CHECK_ZERO(comm_->MinAll(&ierr, &globalErr, 1));
+      ierr = globalErr;
+      if (ierr)
+        {
+        std::remove((partitionCacheFile_ + rank).c_str());
+        }
+      }
+    if (ierr)
+      {
+      std::remove((tmpFile + rank).c_str());
+      Tools::Warning("could not write the partitioning to " + partitionCacheFile_,
+        __FILE__, __LINE__);
+      }
+    partitionCacheFile_ = "";
+    }
+
   if (PL().get("Visualize Solver",false)==true)
     {
     Tools::out() << "MATLAB file for visualizing the solver is written to hid_data.m" << std::endl;
@@ -778,6 +869,72 @@ void Preconditioner::Visualize(std::string mfilename, bool no_recurse) const
     }
   }
 
+int Preconditioner::Save(std::string const &filename) const
+  {
+  HYMLS_LPROF2(label_,"Save");
+  if (!initialized_)
+    {
+    Tools::Warning("preconditioner is not initialized", __FILE__, __LINE__);
+    return -1;
+    }
+
+  std::ofstream ofs((filename + "." + Teuchos::toString(comm_->MyPID())).c_str(),
+    std::ios::out | std::ios::binary | std::ios::trunc);
+  int ierr = ofs ? hid_->Save(ofs) : -1;
+  ofs.close();
+
+  int globalErr;
+  comm_->MinAll(&ierr, &globalErr, 1);
+  return globalErr;
+  }
+
+int Preconditioner::Load(std::string const &filename)
+  {
+  HYMLS_LPROF2(label_,"Load");
+  const double startTime = time_->WallTime();
+  std::ifstream ifs((filename + "." + Teuchos::toString(comm_->MyPID())).c_str(),
+    std::ios::in | std::ios::binary);
+
+  int ierr = ifs ? 0 : -1;
+  int globalErr;
+  comm_->MinAll(&ierr, &globalErr, 1);
+  if (globalErr)
+    {
+    return -1;
+    }
+
+  Teuchos::RCP<const OverlappingPartitioner> hid =
+    OverlappingPartitioner::Load(ifs, *comm_, getMyNonconstParamList());
+  if (hid == Teuchos::null)
+    {
+    return -2;
+    }
+
+  // The partitioner may have moved the elements, so we compare the map
+  // that was partitioned. SameAs is collective, the level is the same on
+  // all processors.
+  if (hid->Level() != myLevel_ || !hid->InputMap().SameAs(*rangeMap_))
+    {
+    Tools::Warning("the partitioning in " + filename +
+      " does not match the matrix", __FILE__, __LINE__);
+    return -3;
+    }
+
+  hid_ = hid;
+  initialized_ = false;
+  computed_ = false;
+
+  // Only the partitioning is read, so this is all the time we save.
+  // Compute() still builds the Schur complements and factorizations.
+  double times[2] = {time_->WallTime() - startTime, hid_->PartitionTime()};
+  double maxTimes[2];
+  CHECK_ZERO(comm_->MaxAll(times, maxTimes, 2));
+  Tools::out() << "Partitioning read from " << filename << " in "
+               << maxTimes[0] << " s, computing it took " << maxTimes[1]
+               << " s" << std::endl;
+  return 0;
+  }
+
 Teuchos::RCP<Epetra_Vector> Preconditioner::CreateTestVector()
   {
   if (testVector_==Teuchos::null)
@@ -953,30 +1110,50 @@ int Preconditioner::ApplyInverse(const Epetra_MultiVector& B, const Epetra_Seria
   Epetra_Map const &map1 = A12_->RowMap();
   Epetra_Map const &map2 = A21_->RowMap();
 
-  Epetra_MultiVector x1(map1, numvec);
-  Epetra_MultiVector x2(map2, numvec);
-
-  Epetra_MultiVector b1(map1, numvec);
-  Epetra_MultiVector b2(map2, numvec);
-
-  Epetra_MultiVector y1(map1, numvec);
-  Epetra_MultiVector y2(map2, numvec);
+  // Temporary vectors are kept between calls, so this does not allocate
+  // anything after the first call with the same number of vectors. The
+  // Schur complement solution is used as x2 and is also the starting vector
+  // for the Schur complement solve.
+  // The interior and separator parts of b and x are views of a single
+  // vector on map12_.
+  Epetra_MultiVector &b12 = workspace_.Get(WS_B12, *map12_, numvec);
+  Epetra_MultiVector &x12 = workspace_.Get(WS_X12, *map12_, numvec);
+  Epetra_MultiVector &b1 = workspace_.View(WS_B1, b12, 0, map1);
+  Epetra_MultiVector &b2 = workspace_.View(WS_B2, b12, map1.NumMyPoints(), map2);
+  Epetra_MultiVector &x1 = workspace_.View(WS_X1, x12, 0, map1);
+  Epetra_MultiVector &x2 = workspace_.View(WS_SCHUR_SOL, x12, map1.NumMyPoints(), map2);
+  Epetra_MultiVector &y1 = workspace_.Get(WS_Y1, map1, numvec);
+  Epetra_MultiVector &y2 = workspace_.Get(WS_Y2, map2, numvec);
+  Epetra_MultiVector &schurRhs = workspace_.Get(WS_SCHUR_RHS, map2, numvec);
 
   // We first import B into the parts of B belonging to their blocks
+  const Epetra_MultiVector *Bsrc = &B;
   if (T_ != Teuchos::null)
     {
-    Epetra_MultiVector BT(B);
+    Epetra_MultiVector &BT = workspace_.Get(WS_BT, B.Map(), B.NumVectors());
     Tools::StartTiming("TransformMatix: MV transform 1");
     CHECK_ZERO(T_->Multiply(true, B, BT));
     Tools::StopTiming("TransformMatix: MV transform 1");
+    Bsrc = &BT;
+    }
 
-    CHECK_ZERO(b1.Import(BT, import1, Insert));
-    CHECK_ZERO(b2.Import(BT, import2, Insert));
+  // If anything throws while a transfer is pending, the guards finish it,
+  // so the next call can still use the transfers.
+  AsyncTransferGuard guard1(transfer1_);
+  AsyncTransferGuard guard2(transfer2_);
+
+  if (asyncComm_)
+    {
+    // b2 is not needed until after the first A11 solve, so it can be
+    // received while the subdomains are solved. This needs separate
+    // transfers for the two parts instead of the single one on map12_.
+    CHECK_ZERO(transfer1_.PostImport(*Bsrc, b1, import1));
+    CHECK_ZERO(transfer2_.PostImport(*Bsrc, b2, import2));
+    CHECK_ZERO(transfer1_.Wait());
     }
   else
     {
-    CHECK_ZERO(b1.Import(B, import1, Insert));
-    CHECK_ZERO(b2.Import(B, import2, Insert));
+    CHECK_ZERO(b12.Import(*Bsrc, *import12_, Insert));
     }
 
   // We want to compute
@@ -993,14 +1170,10 @@ int Preconditioner::ApplyInverse(const Epetra_MultiVector& B, const Epetra_Seria
   // Now we compute y2 = A21*A11\b1
   CHECK_ZERO(A21_->Apply(x1, y2));
 
+  CHECK_ZERO(transfer2_.Wait());
+
   // We now compute the right-hand side for the Schur complement solve
-  if (schurRhs_->NumVectors() != X.NumVectors())
-    {
-    schurRhs_ = Teuchos::rcp(new Epetra_MultiVector(map2, X.NumVectors()));
-    schurSol_ = Teuchos::rcp(new Epetra_MultiVector(map2, X.NumVectors()));
-    schurSol_->PutScalar(0.0);
-    }
-  CHECK_ZERO(schurRhs_->Update(1.0, b2, -1.0, y2, 0.0));
+  CHECK_ZERO(schurRhs.Update(1.0, b2, -1.0, y2, 0.0));
 
   // We now compute the border in case it is present
   Epetra_SerialDenseMatrix q;
@@ -1018,9 +1191,17 @@ int Preconditioner::ApplyInverse(const Epetra_MultiVector& B, const Epetra_Seria
     HYMLS::Tools::Error("No bordered interface specified for the Schur complement solver", __FILE__, __LINE__);
     }
 
-  CHECK_ZERO(borderedPrec->ApplyInverse(*schurRhs_, q, *schurSol_, S));
+  CHECK_ZERO(borderedPrec->ApplyInverse(schurRhs, q, x2, S));
 
-  x2 = *schurSol_;
+  // x2 is final, so in the asynchronous case we can already send it to the
+  // other processors while we compute x1. See below for why we zero out X.
+  // The interior and separator nodes are disjoint, so the x2 values that
+  // are inserted here are not touched by the export of x1.
+  if (asyncComm_)
+    {
+    CHECK_ZERO(X.PutScalar(0.0));
+    CHECK_ZERO(transfer2_.PostExport(x2, X, import2));
+    }
 
   // We have x2 now, so now we can compute x1. Remember that part of the solution
   // is already in there. We first compute y1=A12*x2
@@ -1047,13 +1228,22 @@ int Preconditioner::ApplyInverse(const Epetra_MultiVector& B, const Epetra_Seria
   //'Insert' would put the empty overlap nodes into
   // the other subdomains, so we need to zero out X
   // and 'Add' instead.
-  CHECK_ZERO(X.PutScalar(0.0));
-  CHECK_ZERO(X.Export(x1, import1, Add));
-  CHECK_ZERO(X.Export(x2, import2, Add));
+  if (asyncComm_)
+    {
+    CHECK_ZERO(transfer1_.PostExport(x1, X, import1));
+    CHECK_ZERO(transfer2_.Wait());
+    CHECK_ZERO(transfer1_.Wait());
+    }
+  else
+    {
+    CHECK_ZERO(X.PutScalar(0.0));
+    CHECK_ZERO(X.Export(x12, *import12_, Add));
+    }
   if (T_ != Teuchos::null)
     {
     Tools::StartTiming("TransformMatix: MV transform 2");
-    Epetra_MultiVector XT(X);
+    Epetra_MultiVector &XT = workspace_.Get(WS_XT, X.Map(), numvec);
+    XT = X;
     CHECK_ZERO(T_->Multiply(false, XT, X));
     Tools::StopTiming("TransformMatix: MV transform 2");
     }
@@ -1069,6 +1259,84 @@ int Preconditioner::ApplyInverse(const Epetra_MultiVector& B, const Epetra_Seria
   return 0;
   }
 
+int Preconditioner::ReorderMatrix(Teuchos::RCP<const Epetra_CrsMatrix> matrix)
+  {
+  HYMLS_LPROF2(label_, "ReorderMatrix");
+
+  // The graph data is shared by all copies of a graph and we keep the
+  // matrix alive, so the pointer can not be reused by another pattern.
+  // All processors have to take the same path because of the imports.
+  int samePattern = 0;
+  if (reorderedMatrix_ != Teuchos::null && reorderedSource_ != Teuchos::null)
+    {
+    samePattern = (reorderedSource_->Graph().DataPtr() == matrix->Graph().DataPtr() &&
+      reorderedSource_->NumMyNonzeros() == matrix->NumMyNonzeros()) ? 1 : 0;
+    }
+  int allSamePattern;
+  CHECK_ZERO(comm_->MinAll(&samePattern, &allSamePattern, 1));
+
+  if (allSamePattern)
+    {
+    CHECK_ZERO(remoteRows_->PutScalar(0.0));
+    CHECK_ZERO(remoteRows_->Import(*matrix, *remoteImport_, Insert));
+
+    CHECK_ZERO(reorderedMatrix_->PutScalar(0.0));
+    CHECK_ZERO(MatrixUtils::CopyValues(*matrix, localSourceRows_,
+        *reorderedMatrix_, localTargetRows_, localPlan_));
+    CHECK_ZERO(MatrixUtils::CopyValues(*remoteRows_, remoteSourceRows_,
+        *reorderedMatrix_, remoteTargetRows_, remotePlan_));
+    return 0;
+    }
+
+  int MaxNumEntriesPerRow = matrix->MaxNumEntries();
+  reorderedMatrix_ = Teuchos::rcp(new Epetra_CrsMatrix(Copy, *rowMap_, MaxNumEntriesPerRow));
+  CHECK_ZERO(reorderedMatrix_->Import(*matrix, *importer_, Insert));
+  CHECK_ZERO(reorderedMatrix_->FillComplete());
+  reorderedSource_ = matrix;
+
+  // Rows that are on this processor are copied directly. These are the
+  // same and permuted rows of the importer.
+  const int numSame = importer_->NumSameIDs();
+  const int numPermute = importer_->NumPermuteIDs();
+  localSourceRows_.resize(numSame + numPermute);
+  localTargetRows_.resize(numSame + numPermute);
+  for (int i = 0; i < numSame; i++)
+    {
+    localSourceRows_[i] = i;
+    localTargetRows_[i] = i;
+    }
+  for (int i = 0; i < numPermute; i++)
+    {
+    localSourceRows_[numSame + i] = importer_->PermuteFromLIDs()[i];
+    localTargetRows_[numSame + i] = importer_->PermuteToLIDs()[i];
+    }
+  CHECK_ZERO(MatrixUtils::CreateValueCopyPlan(*matrix, localSourceRows_,
+      *reorderedMatrix_, localTargetRows_, localPlan_));
+
+  // The remote rows are imported into a separate matrix which has the same
+  // pattern every time
+  const int numRemote = importer_->NumRemoteIDs();
+  remoteSourceRows_.resize(numRemote);
+  remoteTargetRows_.resize(numRemote);
+  std::vector<hymls_gidx> remoteGIDs(numRemote);
+  for (int i = 0; i < numRemote; i++)
+    {
+    remoteSourceRows_[i] = i;
+    remoteTargetRows_[i] = importer_->RemoteLIDs()[i];
+    remoteGIDs[i] = rowMap_->GID64(remoteTargetRows_[i]);
+    }
+  Epetra_Map remoteMap((hymls_gidx)(-1), numRemote, remoteGIDs.data(),
+    (hymls_gidx)rowMap_->IndexBase64(), *comm_);
+  remoteImport_ = Teuchos::rcp(new Epetra_Import(remoteMap, matrix->RowMap()));
+  remoteRows_ = Teuchos::rcp(new Epetra_CrsMatrix(Copy, remoteMap, MaxNumEntriesPerRow));
+  CHECK_ZERO(remoteRows_->Import(*matrix, *remoteImport_, Insert));
+  CHECK_ZERO(remoteRows_->FillComplete());
+  CHECK_ZERO(MatrixUtils::CreateValueCopyPlan(*remoteRows_, remoteSourceRows_,
+      *reorderedMatrix_, remoteTargetRows_, remotePlan_));
+
+  return 0;
+  }
+
 int Preconditioner::TransformMatrix()
   {
   HYMLS_LPROF2(label_, "TransformMatix");
@@ -5,10 +5,13 @@
 
 #include "HYMLS_PLA.hpp"
 #include "HYMLS_BorderedOperator.hpp"
+#include "HYMLS_MultiVectorPool.hpp"
+#include "HYMLS_AsyncTransfer.hpp"
 
 #include "Ifpack_Preconditioner.h"
 
 #include "Teuchos_RCP.hpp"
+#include "Teuchos_Array.hpp"
 
 #include <iosfwd>
 #include <string>
@@ -90,6 +93,24 @@ public:
   //! to an m-file so that it can be imported to MATLAB.
   void Visualize(std::string mfilename, bool no_recurse=false) const;
 
+  //! write the partitioning of all levels to the files filename.<rank>,
+  //! so that a later run on the same number of processors can skip the
+  //! partitioning step by calling Load(). This is also what the
+  //! "Partition Cache Directory" option uses. Only the partitioning is
+  //! written: the Schur complements and the factorizations are not,
+  //! because they depend on the matrix values, so Load() only saves the
+  //! time of the partitioning and not that of Compute(). Requires
+  //! Initialize() to have been called.
+  int Save(std::string const &filename) const;
+
+  //! read the partitioning written by Save(). Initialize() and Compute()
+  //! still have to be called afterwards, but Initialize() will use the
+  //! partitioning that was read instead of computing it again. Prints
+  //! the time it took to read it and the time it took to compute it when
+  //! it was saved. Returns -1 if the files can not be opened, -2 if they
+  //! can not be read and -3 if they do not match the map of the matrix.
+  int Load(std::string const &filename);
+
   //!\name Ifpack_Preconditioner interface
 
   //@{
@@ -258,6 +279,10 @@ protected:
   //! Transform the matrix to an F-matrix when possible
   int TransformMatrix();
 
+  //! Import the matrix into reorderedMatrix_. If the pattern of the matrix
+  //! did not change since the previous call, only the values are copied.
+  int ReorderMatrix(Teuchos::RCP<const Epetra_CrsMatrix> matrix);
+
   //! communicator
   Teuchos::RCP<const Epetra_Comm> comm_;
 
@@ -276,6 +301,33 @@ protected:
   //! importer from range to row map
   Teuchos::RCP<Epetra_Import> importer_;
 
+  //! interior nodes followed by the separator nodes of this processor, so
+  //! that both parts of a vector can be imported or exported at once
+  Teuchos::RCP<const Epetra_Map> map12_;
+
+  //! importer from range map to map12_
+  Teuchos::RCP<Epetra_Import> import12_;
+
+  //! the matrix imported into rowMap_. It is kept between calls of Compute()
+  //! so that only its values have to be refreshed.
+  Teuchos::RCP<Epetra_CrsMatrix> reorderedMatrix_;
+
+  //! the matrix that reorderedMatrix_ was imported from
+  Teuchos::RCP<const Epetra_CrsMatrix> reorderedSource_;
+
+  //! rows of the source that are on this processor, the rows of
+  //! reorderedMatrix_ they go to and the positions of their values
+  Teuchos::Array<int> localSourceRows_, localTargetRows_, localPlan_;
+
+  //! the rows of reorderedMatrix_ that are owned by other processors,
+  //! and the importer that gets them
+  Teuchos::RCP<Epetra_CrsMatrix> remoteRows_;
+  Teuchos::RCP<Epetra_Import> remoteImport_;
+
+  //! rows of remoteRows_, the rows of reorderedMatrix_ they go to and the
+  //! positions of their values
+  Teuchos::Array<int> remoteSourceRows_, remoteTargetRows_, remotePlan_;
+
   //! our own minimally overlapped and reordered partitioning:
   Teuchos::RCP<const OverlappingPartitioner> hid_;
 
@@ -298,11 +350,13 @@ protected:
   //! The range and domain of these operators are the rowMap_.
   Teuchos::RCP<MatrixBlock> A11_, A12_, A21_, A22_;
 
-  //! right-hand side vector for Schur complement
-  mutable Teuchos::RCP<Epetra_MultiVector> schurRhs_;
+  //! temporary vectors for ApplyInverse(), including the right-hand side
+  //! and solution of the Schur complement problem
+  mutable MultiVectorPool workspace_;
 
-  //! solution vector for Schur complement
-  mutable Teuchos::RCP<Epetra_MultiVector> schurSol_;
+  //! non-blocking transfers of the interior and separator parts of the
+  //! right-hand side and solution in ApplyInverse()
+  mutable AsyncTransfer transfer1_, transfer2_;
 
   //! a test vector for constructing good orthogonal transformations
   //! (all ones on the first level, passed to the approximate SC)
@@ -386,6 +440,16 @@ protected:
   //! Transform B-grid type matrix into an F-matrix
   bool bgridTransform_;
 
+  //! overlap the imports and exports in ApplyInverse() with local work
+  bool asyncComm_;
+
+  //! directory in which partitionings are cached between runs
+  std::string partitionCache_;
+
+  //! cache file that the partitioning is written to after the first
+  //! Compute(), when all levels have been created
+  std::string partitionCacheFile_;
+
 #ifdef HYMLS_DEBUGGING
 public:
 #else
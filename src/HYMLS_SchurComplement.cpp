@@ -3,6 +3,8 @@
 #include "HYMLS_SchurComplement.hpp"
 #include "HYMLS_OverlappingPartitioner.hpp"
 #include "HYMLS_MatrixBlock.hpp"
+#include "HYMLS_SparseDirectSolver.hpp"
+#include "HYMLS_BatchedDenseSolver.hpp"
 #include "HYMLS_DenseUtils.hpp"
 #include "HYMLS_Macros.hpp"
 #include "HYMLS_Tools.hpp"
@@ -17,9 +19,12 @@
 
 #include "Ifpack_ConfigDefs.h"
 #include "Ifpack_Container.h"
+#include "Ifpack_SparseContainer.h"
 
 #include "EpetraExt_MatrixMatrix.h"
 
+#include <vector>
+
 namespace HYMLS {
 
 // operator representation of our Schur complement.
@@ -143,7 +148,6 @@ int SchurComplement::Construct11(int sd, Epetra_SerialDenseMatrix &Sk,
   const OverlappingPartitioner &hid = A22_->Partitioner();
   const Epetra_CrsMatrix &A12 = *A12_->SubBlock(sd);
   const Epetra_CrsMatrix &A21 = *A21_->SubBlock(sd);
-  Ifpack_Container &A11 = *A11_->SubdomainSolver(sd);
 
   if (sd < 0 || sd > hid.NumMySubdomains())
     {
@@ -151,12 +155,22 @@ int SchurComplement::Construct11(int sd, Epetra_SerialDenseMatrix &Sk,
     return -1;
     }
 
+  // On the levels with dense subdomain solvers, all subdomains are
+  // solved by one batched solver and there is no container
+  const BatchedDenseSolver *batchedSolver = A11_->BatchedSolver();
+  Teuchos::RCP<Ifpack_Container> container = A11_->SubdomainSolver(sd);
+  const int numRows11 = batchedSolver != NULL ?
+    batchedSolver->NumRows(sd) : container->NumRows();
+
+  // local indices in the overlapping map of the rows of the subdomain solver
+  const int *rows11 = A11_->SubdomainRows(sd);
+
 #ifdef HYMLS_TESTING
   // verify that the ID array of the subdomain solver is sorted
   // in ascending order, I think we assume that...
-  for (int i = 1; i < A11.NumRows(); i++)
+  for (int i = 1; i < numRows11; i++)
     {
-    if (A11.ID(i) < A11.ID(i - 1))
+    if (rows11[i] < rows11[i - 1])
       {
       Tools::Warning("re-indexing of blocks is not supported!", __FILE__, __LINE__);
       }
@@ -168,69 +182,193 @@ int SchurComplement::Construct11(int sd, Epetra_SerialDenseMatrix &Sk,
   CHECK_ZERO(inds.Size(nrows));
   CHECK_ZERO(Sk.Shape(nrows, nrows));
 
-  if (A11.NumRows() == 0)
+  if (numRows11 == 0)
     {
     return 0; // has only an A22-contribution (no interior elements)
     }
 
   CHECK_ZERO(A21.RowMap().MyGlobalElements(inds.Values()));
 
-  CHECK_ZERO(A11.SetNumVectors(nrows));
-
   HYMLS_DEBVAR(sd);
   HYMLS_DEBVAR(inds);
   HYMLS_DEBVAR(nrows);
 
+#ifdef HYMLS_TESTING
+  // the columns of A12 should be ordered like the rows of A21
+  if (!A12.DomainMap().SameAs(A21.RowMap()))
+    {
+    Tools::Error("A12 and A21 have different separator maps", __FILE__, __LINE__);
+    }
+#endif
+
   int len;
   int *indices;
   double *values;
   int int_elems = hid.NumInteriorElements(sd);
 
-  // Loop over all interior elements
-  for (int i = 0; i < int_elems; i++)
+  // position of every column of A12 among the separators around this subdomain
+  const int *positions = A12_->SubBlockColumnPositions(sd).getRawPtr();
+
+  // the solution, B=A11\A12, as a MultiVector in the domain map of operator A21
+  Epetra_MultiVector B(A12.RowMap(), nrows);
+
+  // Our own sparse solver can exploit that the columns of A12 only have a
+  // few nonzeros near the boundary of the subdomain, and that A21 only
+  // needs the rows of B close to the separators.
+  Ifpack_SparseContainer<SparseDirectSolver> *sparseContainer =
+    dynamic_cast<Ifpack_SparseContainer<SparseDirectSolver> *>(container.get());
+  if (batchedSolver != NULL)
     {
-    // Get a view of the matrix row (with all separator couplings)
-    CHECK_ZERO(A12.ExtractMyRowView(i, len, values, indices));
+    // A12 as a dense matrix with the rows of the subdomain solver, which
+    // is solved in place
+    std::vector<double> X(numRows11 * nrows + 1, 0.0);
+    for (int i = 0; i < int_elems; i++)
+      {
+      CHECK_ZERO(A12.ExtractMyRowView(i, len, values, indices));
+      for (int k = 0; k < len; k++)
+        {
+        const int j = positions[indices[k]];
+        if (j >= 0)
+          {
+          X[i + j * numRows11] = values[k];
+          }
+        }
+      }
 
-    // A11 ID stores local indices of the original matrix
-    // loop over the matrix row and look for matching entries
-    for (int k = 0 ; k < len; k++)
+    CHECK_ZERO(batchedSolver->ApplyInverse(sd, nrows, &X[0], numRows11));
+#ifdef FLOPS_COUNT
+    flops += 2.0 * numRows11 * numRows11 * nrows;
+#endif
+
+    for (int j = 0; j < numRows11; j++)
+      {
+      const int lrid = A12.LRID(hid.OverlappingMap().GID64(rows11[j]));
+      for (int k = 0; k < nrows; k++)
+        {
+        B[k][lrid] = X[j + k * numRows11];
+        }
+      }
+    }
+  else if (sparseContainer != NULL &&
+    sparseContainer->Inverse()->HasSparseApplyInverse())
+    {
+    // A12 in compressed column format, with the rows of the container
+    std::vector<int> Bp(nrows + 1, 0);
+    for (int i = 0; i < int_elems; i++)
       {
-      const hymls_gidx gcid = A12.GCID64(indices[k]);
+      CHECK_ZERO(A12.ExtractMyRowView(i, len, values, indices));
+      for (int k = 0; k < len; k++)
+        {
+        const int j = positions[indices[k]];
+        if (j >= 0) Bp[j + 1]++;
+        }
+      }
+    for (int j = 0; j < nrows; j++)
+      {
+      Bp[j + 1] += Bp[j];
+      }
+    std::vector<int> Bi(Bp[nrows] + 1);
+    std::vector<double> Bx(Bp[nrows] + 1);
+    std::vector<int> next(Bp.begin(), Bp.end() - 1);
+    for (int i = 0; i < int_elems; i++)
+      {
+      CHECK_ZERO(A12.ExtractMyRowView(i, len, values, indices));
+      for (int k = 0; k < len; k++)
+        {
+        const int j = positions[indices[k]];
+        if (j >= 0)
+          {
+          Bi[next[j]] = i;
+          Bx[next[j]++] = values[k];
+          }
+        }
+      }
 
-      // Loop over all GIDs of separators around this subdomain
-      for (int j = 0; j < nrows; j++)
+    // rows of B that are used by A21
+    std::vector<bool> used(B.MyLength(), false);
+    for (int i = 0; i < nrows; i++)
+      {
+      CHECK_ZERO(A21.ExtractMyRowView(i, len, values, indices));
+      for (int k = 0; k < len; k++)
         {
-        if (gcid == inds[j])
+        const int lrid = A12.LRID(A21.GCID64(indices[k]));
+        if (lrid >= 0) used[lrid] = true;
+        }
+      }
+    std::vector<int> rowsX, lrids;
+    for (int j = 0; j < B.MyLength(); j++)
+      {
+      const int lrid = A12.LRID(hid.OverlappingMap().GID64(rows11[j]));
+      if (used[lrid])
+        {
+        rowsX.push_back(j);
+        lrids.push_back(lrid);
+        }
+      }
+
+    const int numRowsX = rowsX.size();
+    std::vector<double> X(numRowsX * nrows + 1);
+#ifdef FLOPS_COUNT
+    double flopsOld = sparseContainer->Inverse()->ApplyInverseFlops();
+#endif
+    CHECK_ZERO(sparseContainer->Inverse()->ApplyInverseSparse(nrows,
+        &Bp[0], &Bi[0], &Bx[0], numRowsX, &rowsX[0], &X[0], numRowsX));
+#ifdef FLOPS_COUNT
+    flops += sparseContainer->Inverse()->ApplyInverseFlops() - flopsOld;
+#endif
+
+    for (int k = 0; k < nrows; k++)
+      {
+      for (int t = 0; t < numRowsX; t++)
+        {
+        B[k][lrids[t]] = X[k * numRowsX + t];
+        }
+      }
+    }
+  else
+    {
+    Ifpack_Container &A11 = *container;
+    CHECK_ZERO(A11.SetNumVectors(nrows));
+
+    // Loop over all interior elements
+    for (int i = 0; i < int_elems; i++)
+      {
+      // Get a view of the matrix row (with all separator couplings)
+      CHECK_ZERO(A12.ExtractMyRowView(i, len, values, indices));
+
+      // A11 ID stores local indices of the original matrix
+      // loop over the matrix row and put the entries in place
+      for (int k = 0 ; k < len; k++)
+        {
+        const int j = positions[indices[k]];
+        if (j >= 0)
           {
           A11.RHS(i, j) = values[k];
-          break;
           }
         }
       }
-    }
 
 //    HYMLS_DEBUG("Apply A11 inverse...");
 #ifdef FLOPS_COUNT
-  double flopsOld = A11.ApplyInverseFlops();
+    double flopsOld = A11.ApplyInverseFlops();
 #endif
-  IFPACK_CHK_ERR(A11.ApplyInverse());
+    IFPACK_CHK_ERR(A11.ApplyInverse());
 #ifdef FLOPS_COUNT
-  double flopsNew = A11.ApplyInverseFlops();
-  //TODO: these flops are counted twice: in Solver->ApplyInverse() they shouldn't
-  //      contribute!
-  flops += flopsNew - flopsOld;
+    double flopsNew = A11.ApplyInverseFlops();
+    //TODO: these flops are counted twice: in Solver->ApplyInverse() they shouldn't
+    //      contribute!
+    flops += flopsNew - flopsOld;
 #endif
 
-  // get the solution, B=A11\A12, as a MultiVector in the domain map of operator A21
-  Epetra_MultiVector B(A12.RowMap(), nrows);
-  for (int j = 0; j < B.MyLength(); j++)
-    {
-    const int lrid = A12.LRID(hid.OverlappingMap().GID64(A11.ID(j)));
-    for (int k = 0; k < nrows; k++)
+    for (int j = 0; j < B.MyLength(); j++)
       {
-      B[k][lrid] = A11.LHS(j, k);
+      const int lrid = A12.LRID(hid.OverlappingMap().GID64(A11.ID(j)));
+      for (int k = 0; k < nrows; k++)
+        {
+        B[k][lrid] = A11.LHS(j, k);
+        }
       }
+    CHECK_ZERO(A11.SetNumVectors(1));
     }
 
   // multiply by A21, giving A21*(A11\A12) in a vector based on Map2 (i.e. with a row
@@ -246,8 +384,6 @@ int SchurComplement::Construct11(int sd, Epetra_SerialDenseMatrix &Sk,
   flops += 2 * B.NumVectors() *A21.NumGlobalNonzeros64();
 #endif
 
-  CHECK_ZERO(A11.SetNumVectors(1));
-
 //    HYMLS_DEBUG("Block constructed successfully!");
 #ifdef FLOPS_COUNT
   if (count_flops != NULL) *count_flops += flops;
@@ -281,24 +417,30 @@ int SchurComplement::Construct22(int sd, Epetra_SerialDenseMatrix &Sk,
 
   CHECK_ZERO(A22.RowMap().MyGlobalElements(inds.Values()));
 
+#ifdef HYMLS_TESTING
+  if (!A22.DomainMap().SameAs(A22.RowMap()))
+    {
+    Tools::Error("A22 has different row and column separator maps", __FILE__, __LINE__);
+    }
+#endif
+
   int len;
   int *indices;
   double *values;
 
+  // position of every column of A22 among the separators around this subdomain
+  const int *positions = A22_->SubBlockColumnPositions(sd).getRawPtr();
+
   for (int i = 0; i < nrows; i++)
     {
     // A22 part
     CHECK_ZERO(A22.ExtractMyRowView(i, len, values, indices));
     for (int k = 0; k < len; k++)
       {
-      const hymls_gidx gcid = A22.GCID64(indices[k]);
-      for (int j = 0; j < nrows; j++)
+      const int j = positions[indices[k]];
+      if (j >= 0)
         {
-        if (gcid == inds[j])
-          {
-          Sk(i, j) = values[k];
-          break;
-          }
+        Sk(i, j) = values[k];
         }
       }
     }
@@ -15,6 +15,7 @@
 #include "HYMLS_RestrictedOT.hpp"
 #include "HYMLS_SeparatorGroup.hpp"
 #include "HYMLS_CoarseSolver.hpp"
+#include "HYMLS_BatchedDenseSolver.hpp"
 
 #include "Epetra_Comm.h"
 #include "Epetra_Map.h"
@@ -55,10 +56,20 @@
 #include <fstream>
 #include <algorithm>
 #include <iostream>
+#include <exception>
+#include <vector>
+#include <utility>
 
 namespace HYMLS
   {
 
+namespace {
+
+//! slots of the workspace vectors used in ApplyInverse()
+enum {WS_B, WS_VSUM_RHS, WS_VSUM_SOL};
+
+  }
+
 
 // private constructor
 SchurPreconditioner::SchurPreconditioner(
@@ -74,9 +85,11 @@ SchurPreconditioner::SchurPreconditioner(
     variant_("Block Diagonal"),
     denseSwitch_(99), applyDropping_(true),
     applyOT_(true),
+    numThreads_(-1), threadedAssembly_(false),
     hid_(hid), map_(Teuchos::rcp(&(SC->OperatorDomainMap()), false)),
     testVector_(testVector),
-    sparseMatrixOT_(Teuchos::null),
+    otGlobalLength_(0.0),
+    batchedBlocks_(true),
     matrix_(Teuchos::null),
     nextLevelHID_(Teuchos::null),
     useTranspose_(false), haveBorder_(false), normInf_(-1.0),
@@ -150,6 +163,11 @@ int SchurPreconditioner::SetParameters(Teuchos::ParameterList &List)
   denseSwitch_ = PL().get("Dense Solvers on Level", denseSwitch_);
   applyDropping_ = PL().get("Apply Dropping", true);
   applyOT_ = PL().get("Apply Orthogonal Transformation", applyDropping_);
+  numThreads_ = PL().get("Subdomain Solver Num Threads", numThreads_);
+  batchedBlocks_ = PL().sublist("Dense Solver").get("Batched Solves", true);
+
+  // Ifpack_Amesos may share state between instances, see MatrixBlock
+  threadedAssembly_ = (PL().get("Subdomain Solver Type", "Sparse") != "Amesos");
 
   if (reducedSchurSolver_ != Teuchos::null)
     {
@@ -185,10 +203,11 @@ int SchurPreconditioner::Initialize()
   time_->ResetStartTime();
 
   // force next Compute to rebuild everything
-  sparseMatrixOT_ = Teuchos::null;
+  otGroupPtr_.clear();
   matrix_ = Teuchos::null;
   reducedSchurSolver_ = Teuchos::null;
   blockSolver_.resize(0);
+  batchedSolver_ = Teuchos::null;
 
   CHECK_ZERO(InitializeOT());
 
@@ -205,8 +224,7 @@ int SchurPreconditioner::Initialize()
   HYMLS_DEBUG(label_);
   HYMLS_DEBVAR(*vsumMap_);
 
-  vsumRhs_ = Teuchos::rcp(new Epetra_MultiVector(*vsumMap_, 1));
-  vsumSol_ = Teuchos::rcp(new Epetra_MultiVector(*vsumMap_, 1));
+  workspace_.Clear();
   vsumImporter_ = Teuchos::rcp(new Epetra_Import(*vsumMap_, *map_));
 
   if (myLevel_ + 1 < maxLevel_)
@@ -250,6 +268,11 @@ int SchurPreconditioner::Compute()
   if (variant_ == "Do Nothing" || !applyDropping_)
     {
     blockSolver_.resize(0);
+    batchedSolver_ = Teuchos::null;
+    }
+  else if (variant_ == "Block Diagonal" && batchedBlocks_)
+    {
+    CHECK_ZERO(InitializeBatchedBlocks());
     }
   else if (variant_ == "Block Diagonal" ||
     variant_ == "Lower Triangular")
@@ -288,6 +311,10 @@ int SchurPreconditioner::Compute()
       {
       CHECK_ZERO(blockSolver_[i]->Compute(*matrix_));
       }
+    if (batchedSolver_ != Teuchos::null)
+      {
+      CHECK_ZERO(batchedSolver_->Compute(*matrix_));
+      }
     }
 
   computed_ = true;
@@ -307,6 +334,7 @@ int SchurPreconditioner::InitializeBlocks()
 
   // create an array of solvers for all the diagonal blocks
   blockSolver_.resize(0);
+  batchedSolver_ = Teuchos::null;
   for (int sd = 0; sd < sepObject->NumMySubdomains(); sd++)
     {
     for (auto const &linked_groups : sepObject->GetLinkedSeparatorGroups(sd))
@@ -339,6 +367,50 @@ int SchurPreconditioner::InitializeBlocks()
   return 0;
   }
 
+int SchurPreconditioner::InitializeBatchedBlocks()
+  {
+  HYMLS_LPROF2(label_, "InitializeBatchedBlocks");
+
+  blockSolver_.resize(0);
+
+  // The batched solver overwrites all values in Compute(), so unlike the
+  // Ifpack containers it only has to be set up once
+  if (batchedSolver_ != Teuchos::null)
+    {
+    return 0;
+    }
+
+  Teuchos::RCP<const HierarchicalMap> sepObject
+    = hid_->Spawn(HierarchicalMap::LocalSeparators);
+
+  // the same blocks as in InitializeBlocks(), without the Vsums
+  Teuchos::Array<int> blockPtr(1, 0);
+  Teuchos::Array<int> rows;
+  for (int sd = 0; sd < sepObject->NumMySubdomains(); sd++)
+    {
+    for (auto const &linked_groups : sepObject->GetLinkedSeparatorGroups(sd))
+      {
+      for (SeparatorGroup const &group : linked_groups)
+        {
+        if (group.length() == 0)
+          HYMLS::Tools::Error("there is an empty separator, which is probably dangerous", __FILE__, __LINE__);
+
+        // skip first element, which is a Vsum
+        for (int j = 1; j < group.length(); j++)
+          {
+          rows.append(map_->LID(group[j]));
+          }
+        }
+      blockPtr.append(rows.size());
+      }
+    }
+
+  batchedSolver_ = Teuchos::rcp(new BatchedDenseSolver());
+  CHECK_ZERO(batchedSolver_->Initialize(blockPtr.size() - 1,
+      blockPtr.getRawPtr(), rows.getRawPtr()));
+  return 0;
+  }
+
 int SchurPreconditioner::InitializeSingleBlock()
   {
   HYMLS_LPROF2(label_, "InitializeSingleBlock");
@@ -388,8 +460,8 @@ int SchurPreconditioner::InitializeOT()
   if (!applyOT_)
     return 0;
 
-  // create orthogonal transform as a sparse matrix representation
-  if (sparseMatrixOT_ == Teuchos::null)
+  // create orthogonal transform in compact form
+  if (otGroupPtr_.size() == 0)
     {
 
     // Get an object with only local separators and remote connected separators.
@@ -409,11 +481,13 @@ int SchurPreconditioner::InitializeOT()
 #else
     Epetra_IntSerialDenseVector inds;
 #endif
-    Epetra_SerialDenseVector vec;
-
-    int nnzPerRow = sepObject->NumMySubdomains() > 0 ? sepObject->NumSeparatorElements(0) : 0;
+    Epetra_SerialDenseVector vec, w;
 
-    sparseMatrixOT_ = Teuchos::rcp(new Epetra_CrsMatrix(Copy, *map_, nnzPerRow));
+    otGroupPtr_.resize(1);
+    otGroupPtr_[0] = 0;
+    otLIDs_.clear();
+    otW_.clear();
+    std::vector<std::pair<int, double> > entries;
 
     // loop over all separators connected to a local subdomain
     for (int sd = 0; sd < sepObject->NumMySubdomains(); sd++)
@@ -447,22 +521,34 @@ int SchurPreconditioner::InitializeOT()
           {
           //          HYMLS_DEBVAR(inds);
           //          HYMLS_DEBVAR(vec);
-          int ierr = OT_->Construct(*sparseMatrixOT_, inds, vec);
-          if (ierr)
+
+          // compact form, sorted by local index so that the entries
+          // of a group are usually contiguous
+          CHECK_ZERO(OT_->Construct(w, vec));
+          entries.resize(pos);
+          for (int i = 0; i < pos; i++)
             {
-            Tools::Warning("Error code " + Teuchos::toString(ierr) + " returned from Epetra call!",
-              __FILE__, __LINE__);
-            return ierr;
+            entries[i] = std::make_pair(map_->LID(inds[i]), w[i]);
+            if (entries[i].first < 0)
+              {
+              Tools::Error("separator group is not local", __FILE__, __LINE__);
+              }
             }
+          std::sort(entries.begin(), entries.end());
+          for (auto const &entry : entries)
+            {
+            otLIDs_.append(entry.first);
+            otW_.append(entry.second);
+            }
+          otGroupPtr_.append(otLIDs_.size());
           }
         }
       }
-    CHECK_ZERO(sparseMatrixOT_->FillComplete());
+
+    // the flops in ApplyOT() are counted for all processes together
+    double numWeights = otW_.size();
+    CHECK_ZERO(comm_->SumAll(&numWeights, &otGlobalLength_, 1));
     }
-#ifdef HYMLS_STORE_MATRICES
-  MatrixUtils::Dump(*sparseMatrixOT_,
-    "Householder" + Teuchos::toString(myLevel_) + ".txt");
-#endif
   return 0;
   }
 
@@ -603,8 +689,18 @@ int SchurPreconditioner::ComputeNextLevel()
     }
   else
     {
-    reducedSchurSolver_ = Teuchos::rcp(new CoarseSolver(reducedSchur, myLevel_ + 1));
-    CHECK_ZERO(reducedSchurSolver_->SetParameters(PL()));
+    // keep the coarse solver if it can reuse its pattern
+    Teuchos::RCP<CoarseSolver> coarseSolver =
+      Teuchos::rcp_dynamic_cast<CoarseSolver>(reducedSchurSolver_);
+    if (coarseSolver != Teuchos::null && coarseSolver->ReuseSymbolic())
+      {
+      coarseSolver->SetMatrix(reducedSchur);
+      }
+    else
+      {
+      reducedSchurSolver_ = Teuchos::rcp(new CoarseSolver(reducedSchur, myLevel_ + 1));
+      CHECK_ZERO(reducedSchurSolver_->SetParameters(PL()));
+      }
     }
 
   HYMLS_DEBUG("Initialize solver for reduced Schur");
@@ -680,7 +776,17 @@ int SchurPreconditioner::Assemble()
   CHECK_ZERO(SchurComplement_->Construct(matrix));
 
   if (applyOT_)
-    matrix_ = OT_->Apply(*sparseMatrixOT_, *matrix);
+    {
+#ifdef HYMLS_TESTING
+    if (!matrix->RowMap().SameAs(*map_))
+      {
+      Tools::Error("Schur complement and OT have different maps", __FILE__, __LINE__);
+      }
+#endif
+    // transform the rows and columns of each separator group directly
+    matrix_ = OT_->Apply(*matrix, otGroupPtr_.size() - 1,
+      otGroupPtr_.getRawPtr(), otLIDs_.getRawPtr(), otW_.getRawPtr());
+    }
   else
     matrix_ = matrix;
 
@@ -720,16 +826,11 @@ int SchurPreconditioner::AssembleTransformAndDrop()
     matrix_ = matrix;
     }
 
-  Epetra_SerialDenseVector v;
-  Epetra_SerialDenseMatrix Sk;
-
   // part remaining after dropping
   Epetra_SerialDenseMatrix Spart;
 #ifdef HYMLS_LONG_LONG
-  Epetra_LongLongSerialDenseVector indices;
   Epetra_LongLongSerialDenseVector indsPart;
 #else
-  Epetra_IntSerialDenseVector indices;
   Epetra_IntSerialDenseVector indsPart;
 #endif
 
@@ -810,56 +911,36 @@ int SchurPreconditioner::AssembleTransformAndDrop()
   // group and sum them into the pattern defined above, dropping everything
   // that is not defined in the matrix pattern.
 
-  HYMLS_DEBUG("Add A22 part");
-  for (int sd = 0; sd < hid_->NumMySubdomains(); sd++)
-    {
-    HYMLS_LPROF3(label_, "Add A22 part");
-    // construct the local contribution of the SC
-    // (for all separators around the subdomain)
-    HYMLS_DEBVAR(sd);
-
-    // Construct the local A22
-    CHECK_ZERO(SchurComplement_->Construct22(sd, Sk, indices));
-
-    Teuchos::Array<Teuchos::RCP<Epetra_SerialDenseMatrix> > SkArray;
+  // The contributions are constructed per subdomain (possibly in parallel)
+  // and then put into the matrix in the order of the subdomains, so the
+  // result does not depend on the number of threads.
+  Teuchos::Array<Teuchos::Array<Teuchos::RCP<Epetra_SerialDenseMatrix> > > SkArrays;
 #ifdef HYMLS_LONG_LONG
-    Teuchos::Array<Teuchos::RCP<Epetra_LongLongSerialDenseVector> > indicesArray;
+  Teuchos::Array<Teuchos::Array<Teuchos::RCP<Epetra_LongLongSerialDenseVector> > > indicesArrays;
 #else
-    Teuchos::Array<Teuchos::RCP<Epetra_IntSerialDenseVector> > indicesArray;
+  Teuchos::Array<Teuchos::Array<Teuchos::RCP<Epetra_IntSerialDenseVector> > > indicesArrays;
 #endif
-    CHECK_ZERO(ConstructSCPart(sd, localTestVector, Sk, indices, SkArray, indicesArray));
 
-    for (int i = 0; i < SkArray.length(); i++)
+  HYMLS_DEBUG("Add A22 part");
+  CHECK_ZERO(ConstructSCParts(false, localTestVector, SkArrays, indicesArrays));
+  for (int sd = 0; sd < hid_->NumMySubdomains(); sd++)
+    {
+    for (int i = 0; i < SkArrays[sd].length(); i++)
       {
       HYMLS_DEBVAR(i);
-      CHECK_ZERO(matrix->ReplaceGlobalValues(*indicesArray[i], *SkArray[i]));
+      CHECK_ZERO(matrix->ReplaceGlobalValues(*indicesArrays[sd][i], *SkArrays[sd][i]));
       }
     }//sd
   CHECK_ZERO(matrix->GlobalAssemble(false, Insert));
 
   HYMLS_DEBUG("-A21*A11\\A12 part");
+  CHECK_ZERO(ConstructSCParts(true, localTestVector, SkArrays, indicesArrays));
   for (int sd = 0; sd < hid_->NumMySubdomains(); sd++)
     {
-    HYMLS_LPROF3(label_, "Add -A21*A11\\A12 part");
-    // construct the local contribution of the SC
-    // (for all separators around the subdomain)
-    HYMLS_DEBVAR(sd);
-
-    // Construct the local -A21*A11\A12
-    CHECK_ZERO(SchurComplement_->Construct11(sd, Sk, indices));
-
-    Teuchos::Array<Teuchos::RCP<Epetra_SerialDenseMatrix> > SkArray;
-#ifdef HYMLS_LONG_LONG
-    Teuchos::Array<Teuchos::RCP<Epetra_LongLongSerialDenseVector> > indicesArray;
-#else
-    Teuchos::Array<Teuchos::RCP<Epetra_IntSerialDenseVector> > indicesArray;
-#endif
-    CHECK_ZERO(ConstructSCPart(sd, localTestVector, Sk, indices, SkArray, indicesArray));
-
-    for (int i = 0; i < SkArray.length(); i++)
+    for (int i = 0; i < SkArrays[sd].length(); i++)
       {
       HYMLS_DEBVAR(i);
-      CHECK_ZERO(matrix->SumIntoGlobalValues(*indicesArray[i], *SkArray[i]));
+      CHECK_ZERO(matrix->SumIntoGlobalValues(*indicesArrays[sd][i], *SkArrays[sd][i]));
       }
     }//sd
   CHECK_ZERO(matrix->GlobalAssemble());
@@ -874,6 +955,89 @@ int SchurPreconditioner::AssembleTransformAndDrop()
   return 0;
   }
 
+int SchurPreconditioner::ConstructSCParts(bool part11,
+  Epetra_Vector const &localTestVector,
+  Teuchos::Array<Teuchos::Array<Teuchos::RCP<Epetra_SerialDenseMatrix> > > &SkArrays,
+#ifdef HYMLS_LONG_LONG
+  Teuchos::Array<Teuchos::Array<Teuchos::RCP<Epetra_LongLongSerialDenseVector> > > &indicesArrays
+#else
+  Teuchos::Array<Teuchos::Array<Teuchos::RCP<Epetra_IntSerialDenseVector> > > &indicesArrays
+#endif
+  ) const
+  {
+  const int num_sd = hid_->NumMySubdomains();
+
+  SkArrays.clear();
+  indicesArrays.clear();
+  SkArrays.resize(num_sd);
+  indicesArrays.resize(num_sd);
+
+  // The separator maps are spawned on demand and cached in the
+  // HierarchicalMap, which is not thread-safe, so we do that here.
+  for (int sd = 0; sd < num_sd; sd++)
+    {
+    hid_->SpawnMap(sd, HierarchicalMap::Separators);
+    }
+
+  std::exception_ptr eptr = nullptr;
+
+#ifdef HYMLS_USE_OPENMP
+#pragma omp parallel num_threads(numThreads_) if (numThreads_ > 1 && threadedAssembly_)
+#endif
+  {
+  Epetra_SerialDenseMatrix Sk;
+#ifdef HYMLS_LONG_LONG
+  Epetra_LongLongSerialDenseVector indices;
+#else
+  Epetra_IntSerialDenseVector indices;
+#endif
+
+#ifdef HYMLS_USE_OPENMP
+#pragma omp for schedule(dynamic)
+#endif
+  for (int sd = 0; sd < num_sd; sd++)
+    {
+    try
+      {
+      TraceSubdomain traceSd(sd);
+      // construct the local contribution of the SC
+      // (for all separators around the subdomain)
+      HYMLS_DEBVAR(sd);
+      if (part11)
+        {
+        HYMLS_LPROF3(label_, "Add -A21*A11\\A12 part");
+        // Construct the local -A21*A11\A12
+        CHECK_ZERO(SchurComplement_->Construct11(sd, Sk, indices));
+        CHECK_ZERO(ConstructSCPart(sd, localTestVector, Sk, indices,
+            SkArrays[sd], indicesArrays[sd]));
+        }
+      else
+        {
+        HYMLS_LPROF3(label_, "Add A22 part");
+        // Construct the local A22
+        CHECK_ZERO(SchurComplement_->Construct22(sd, Sk, indices));
+        CHECK_ZERO(ConstructSCPart(sd, localTestVector, Sk, indices,
+            SkArrays[sd], indicesArrays[sd]));
+        }
+      }
+    catch (...)
+      {
+#ifdef HYMLS_USE_OPENMP
+#pragma omp critical (HYMLS_SchurPreconditioner_ConstructSCParts)
+#endif
+      if (!eptr) eptr = std::current_exception();
+      }
+    }//sd
+  }
+
+  if (eptr)
+    {
+    std::rethrow_exception(eptr);
+    }
+
+  return 0;
+  }
+
 int SchurPreconditioner::ConstructSCPart(int sd, Epetra_Vector const &localTestVector,
   Epetra_SerialDenseMatrix &Sk,
 #ifdef HYMLS_LONG_LONG
@@ -1039,7 +1203,8 @@ int SchurPreconditioner::ApplyInverse(const Epetra_MultiVector &X,
 #endif
 
   // (1) Transform right-hand side, B=OT'*X
-  Epetra_MultiVector B(X);
+  Epetra_MultiVector &B = workspace_.Get(WS_B, X.Map(), X.NumVectors());
+  B = X;
 
   CHECK_ZERO(ApplyOT(true, B, &flopsApplyInverse_));
 
@@ -1067,15 +1232,12 @@ int SchurPreconditioner::ApplyInverse(const Epetra_MultiVector &X,
   CHECK_ZERO(UpdateVsumRhs(B, Y));
 
   // solve reduced Schur-complement problem
-  if (X.NumVectors() != vsumRhs_->NumVectors())
-    {
-    vsumRhs_ = Teuchos::rcp(new Epetra_MultiVector(*vsumMap_, X.NumVectors()));
-    vsumSol_ = Teuchos::rcp(new Epetra_MultiVector(*vsumMap_, X.NumVectors()));
-    }
+  Epetra_MultiVector &vsumRhs = workspace_.Get(WS_VSUM_RHS, *vsumMap_, X.NumVectors());
+  Epetra_MultiVector &vsumSol = workspace_.Get(WS_VSUM_SOL, *vsumMap_, X.NumVectors());
 
-  CHECK_ZERO(vsumRhs_->Import(Y, *vsumImporter_, Insert));
-  CHECK_ZERO(reducedSchurSolver_->ApplyInverse(*vsumRhs_, *vsumSol_));
-  CHECK_ZERO(Y.Export(*vsumSol_, *vsumImporter_, Insert));
+  CHECK_ZERO(vsumRhs.Import(Y, *vsumImporter_, Insert));
+  CHECK_ZERO(reducedSchurSolver_->ApplyInverse(vsumRhs, vsumSol));
+  CHECK_ZERO(Y.Export(vsumSol, *vsumImporter_, Insert));
 
   // transform back
   CHECK_ZERO(ApplyOT(false, Y, &flopsApplyInverse_));
@@ -1130,6 +1292,10 @@ double SchurPreconditioner::ComputeFlops() const
       total += blockSolver_[i]->ComputeFlops();
       }
     }
+  if (batchedSolver_ != Teuchos::null)
+    {
+    total += batchedSolver_->ComputeFlops();
+    }
   if (reducedSchurSolver_ != Teuchos::null)
     {
     total += reducedSchurSolver_->ComputeFlops();
@@ -1147,6 +1313,10 @@ double SchurPreconditioner::ApplyInverseFlops() const
       total += blockSolver_[i]->ApplyInverseFlops();
       }
     }
+  if (batchedSolver_ != Teuchos::null)
+    {
+    total += batchedSolver_->ApplyInverseFlops();
+    }
   if (reducedSchurSolver_ != Teuchos::null)
     {
     total += reducedSchurSolver_->ApplyInverseFlops();
@@ -1240,25 +1410,28 @@ int SchurPreconditioner::ApplyOT(bool trans, Epetra_MultiVector &v, double *flop
   if (!applyOT_)
     return 0;
 
-  if (sparseMatrixOT_ == Teuchos::null)
+  if (otGroupPtr_.size() == 0)
     {
-    HYMLS::Tools::Error("orth. transform not available as matrix!",
+    HYMLS::Tools::Error("orth. transform not available!",
       __FILE__, __LINE__);
     }
 
-  Epetra_MultiVector tmp = v;
+  // apply the transforms group by group in a single pass over v
+  const int numGroups = otGroupPtr_.size() - 1;
   if (trans)
     {
-    CHECK_ZERO(OT_->ApplyInverse(v, *sparseMatrixOT_, tmp));
+    CHECK_ZERO(OT_->ApplyInverse(v, numGroups, otGroupPtr_.getRawPtr(),
+        otLIDs_.getRawPtr(), otW_.getRawPtr()));
     }
   else
     {
-    CHECK_ZERO(OT_->Apply(v, *sparseMatrixOT_, tmp));
+    CHECK_ZERO(OT_->Apply(v, numGroups, otGroupPtr_.getRawPtr(),
+        otLIDs_.getRawPtr(), otW_.getRawPtr()));
     }
   if (flops != NULL)
     {
     //TODO: make this general for all OTs
-    *flops += sparseMatrixOT_->NumGlobalNonzeros64() * 4 + v.MyLength();
+    *flops += otGlobalLength_ * 4 + v.GlobalLength64();
     }
   // }
   return 0;
@@ -1312,6 +1485,12 @@ int SchurPreconditioner::ApplyBlockDiagonal
 (const Epetra_MultiVector &B, Epetra_MultiVector &Y) const
   {
   HYMLS_LPROF2(label_, "Block Diagonal Solve");
+  if (batchedSolver_ != Teuchos::null)
+    {
+    CHECK_ZERO(batchedSolver_->ApplyInverse(B, Y));
+    return 0;
+    }
+
   int numBlocks = blockSolver_.size(); // will be 0 on coarsest level
   for (int blk = 0; blk < numBlocks; blk++)
     {
@@ -1557,7 +1736,8 @@ int SchurPreconditioner::ApplyInverse(const Epetra_MultiVector &X,
   CHECK_ZERO(Y.PutScalar(0.0));
 
   // (1) Transform right-hand side, B=OT'*X
-  Epetra_MultiVector B(X);
+  Epetra_MultiVector &B = workspace_.Get(WS_B, X.Map(), X.NumVectors());
+  B = X;
 
   CHECK_ZERO(ApplyOT(true, B, &flopsApplyInverse_));
 
@@ -1577,15 +1757,10 @@ int SchurPreconditioner::ApplyInverse(const Epetra_MultiVector &X,
   // We do not have to form the augmented vectors here as
   // we use the BorderedOperator interface's ApplyInverse()
   // function recursively.
-  if (X.NumVectors() != vsumRhs_->NumVectors())
-    {
-    vsumRhs_ = Teuchos::rcp(new
-      Epetra_MultiVector(*vsumMap_, X.NumVectors()));
-    vsumSol_ = Teuchos::rcp(new
-      Epetra_MultiVector(*vsumMap_, X.NumVectors()));
-    }
+  Epetra_MultiVector &vsumRhs = workspace_.Get(WS_VSUM_RHS, *vsumMap_, X.NumVectors());
+  Epetra_MultiVector &vsumSol = workspace_.Get(WS_VSUM_SOL, *vsumMap_, X.NumVectors());
 
-  CHECK_ZERO(vsumRhs_->Import(B, *vsumImporter_, Insert));
+  CHECK_ZERO(vsumRhs.Import(B, *vsumImporter_, Insert));
 
   // compute W1'(M11\F1). note zeros in X2
   Epetra_SerialDenseMatrix Tcopy(T);
@@ -1597,10 +1772,10 @@ int SchurPreconditioner::ApplyInverse(const Epetra_MultiVector &X,
     {
     Tools::Error("cannot handle next level bordered system!", __FILE__, __LINE__);
     }
-  CHECK_ZERO(borderedNextLevel->ApplyInverse(*vsumRhs_, Tcopy, *vsumSol_, S));
+  CHECK_ZERO(borderedNextLevel->ApplyInverse(vsumRhs, Tcopy, vsumSol, S));
 
   // copy into Y
-  CHECK_ZERO(Y.Export(*vsumSol_, *vsumImporter_, Insert));
+  CHECK_ZERO(Y.Export(vsumSol, *vsumImporter_, Insert));
 
   // transform back
   CHECK_ZERO(ApplyOT(false, Y, &flopsApplyInverse_));
@@ -10,6 +10,7 @@
 #include "Ifpack_Preconditioner.h"
 
 #include "HYMLS_BorderedOperator.hpp"
+#include "HYMLS_MultiVectorPool.hpp"
 #include "HYMLS_PLA.hpp"
 
 #include <iosfwd>
@@ -41,6 +42,7 @@ class ParameterList;
 namespace HYMLS
   {
 
+class BatchedDenseSolver;
 class Epetra_Time;
 class HierarchicalMap;
 class OrthogonalTransform;
@@ -273,6 +275,12 @@ protected:
   //! switch for applying the OT
   bool applyOT_;
 
+  //! number of threads used for assembling the subdomain contributions
+  int numThreads_;
+
+  //! false if the subdomain solvers can not be used concurrently
+  bool threadedAssembly_;
+
   //! domain decomposition object
   Teuchos::RCP<const OverlappingPartitioner> hid_;
 
@@ -285,14 +293,28 @@ protected:
   //! orthogonal transformaion for separators
   Teuchos::RCP<OrthogonalTransform> OT_;
 
-  //! sparse matrix representation of OT
-  Teuchos::RCP<Epetra_CrsMatrix> sparseMatrixOT_;
+  //! compact representation of the OT that is used in ApplyOT(). The
+  //! transform of group g is defined by otW_ on the local rows otLIDs_
+  //! in the range otGroupPtr_[g], ..., otGroupPtr_[g+1]-1.
+  Teuchos::Array<int> otGroupPtr_, otLIDs_;
+  Teuchos::Array<double> otW_;
+
+  //! total length of otW_ over all processes
+  double otGlobalLength_;
 
   //! solvers for separator blocks (in principle they could be
   //! either Sparse- or DenseContainers, but presently we
   //! just make them Dense (which makes sense for our purposes)
   Teuchos::Array<Teuchos::RCP<Ifpack_Container> > blockSolver_;
 
+  //! solver for all separator blocks at once, which is used instead of
+  //! blockSolver_ for the "Block Diagonal" variant if "Batched Solves"
+  //! is set in the "Dense Solver" sublist
+  Teuchos::RCP<BatchedDenseSolver> batchedSolver_;
+
+  //! use batchedSolver_ for the "Block Diagonal" variant
+  bool batchedBlocks_;
+
   //! sparse matrix representation of preconditioner
   Teuchos::RCP<Epetra_CrsMatrix> matrix_;
 
@@ -305,8 +327,9 @@ protected:
   //! partitioner for the next level
   Teuchos::RCP<const OverlappingPartitioner> nextLevelHID_;
 
-  //! right-hand side and solution for the reduced SC (based on linear map)
-  mutable Teuchos::RCP<Epetra_MultiVector> vsumRhs_, vsumSol_;
+  //! temporary vectors for ApplyInverse(), including the right-hand side
+  //! and solution for the reduced SC (based on linear map)
+  mutable MultiVectorPool workspace_;
 
   //! solver for the reduced Schur complement. Note that Ifpack_Preconditioner
   //! is implemented by both Amesos (direct solver) and our HYMLS::Solver,
@@ -409,10 +432,28 @@ private:
 #endif
     ) const;
 
+  //! Construct the transformed contributions of all subdomains to the Schur
+  //! complement, using either the A22 part (part11=false) or the
+  //! -A21*A11\A12 part (part11=true). The contributions of subdomain sd
+  //! are stored in SkArrays[sd] and indicesArrays[sd]. The subdomains
+  //! are processed concurrently if "Subdomain Solver Num Threads" > 1.
+  int ConstructSCParts(bool part11, Epetra_Vector const &localTestVector,
+    Teuchos::Array<Teuchos::Array<Teuchos::RCP<Epetra_SerialDenseMatrix> > > &SkArrays,
+#ifdef HYMLS_LONG_LONG
+    Teuchos::Array<Teuchos::Array<Teuchos::RCP<Epetra_LongLongSerialDenseVector> > > &indicesArrays
+#else
+    Teuchos::Array<Teuchos::Array<Teuchos::RCP<Epetra_IntSerialDenseVector> > > &indicesArrays
+#endif
+    ) const;
+
   //! Initialize dense solvers for diagonal blocks
-  //! ("Block Diagonal" variant)
+  //! ("Block Diagonal" and "Lower Triangular" variant)
   int InitializeBlocks();
 
+  //! Initialize a batched dense solver for all diagonal blocks
+  //! ("Block Diagonal" variant)
+  int InitializeBatchedBlocks();
+
   //! Initialize single sparse solver for non-Vsums
   //! ("Domain Decomposition" variant)
   int InitializeSingleBlock();
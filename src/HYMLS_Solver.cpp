@@ -201,6 +201,16 @@ int Solver::getNumIter() const
   return solver_->getNumIter();
   }
 
+void Solver::ResetRecycledSpace()
+  {
+  solver_->ResetRecycledSpace();
+  }
+
+bool Solver::KeepRecycledSpace() const
+  {
+  return solver_->KeepRecycledSpace();
+  }
+
 int Solver::SetBorder(Teuchos::RCP<const Epetra_MultiVector> const &V,
   Teuchos::RCP<const Epetra_MultiVector> const &W,
   Teuchos::RCP<const Epetra_SerialDenseMatrix> const &C)
@@ -108,6 +108,13 @@ public:
   //! get number of iterations performed in last ApplyInverse() call
   int getNumIter() const;
 
+  //! discard the recycled subspace (only for 'Krylov Method' = 'GCRODR')
+  void ResetRecycledSpace();
+
+  //! whether the recycled subspace should be kept when the preconditioner
+  //! is recomputed
+  bool KeepRecycledSpace() const;
+
   //! For singular problems with a known null space, add the null space
   //! as a border so that in fact the linear system
   //!
@@ -20,6 +20,7 @@
 #include <cstdarg>
 
 #include <fstream>
+#include <algorithm>
 
 extern "C" {
 #ifdef HAVE_PARDISO
@@ -82,9 +83,15 @@ SparseDirectSolver::SparseDirectSolver(Epetra_RowMatrix* Matrix_in) :
   IsComputed_(false),
   UseTranspose_(false),
   Condest_(-1.0),
+  numInitialize_(0), numCompute_(0), numSymbolicReuse_(0),
+  numApplyInverse_(0), initializeTime_(0.0), computeTime_(0.0),
+  applyInverseTime_(0.0), applyInverseFlops_(0.0),
   serialMatrix_(Teuchos::null),
   serialImport_(Teuchos::null),
   ownOrdering_(false), ownScaling_(false),
+  reuseSymbolic_(false), refactorRcondRatio_(1.0e-2), factorRcond_(-1.0),
+  sparseRhs_(false), sparseReady_(false),
+  singleFactors_(false), refinementSteps_(1), singleReady_(false), stamp_(0),
   pardiso_initialized_(false)
   {
   HYMLS_PROF3(label_,"Constructor");
@@ -94,6 +101,7 @@ SparseDirectSolver::SparseDirectSolver(Epetra_RowMatrix* Matrix_in) :
   amd_printf = &my_printf;
 #endif
   MyPID_=Matrix_->Comm().MyPID();
+  time_=Teuchos::rcp(new Epetra_Time(Matrix_->Comm()));
 
   klu_=new KluWrapper();
   klu_->Common_=new T_KLU(klu_common)();
@@ -237,6 +245,17 @@ int SparseDirectSolver::SetParameters(Teuchos::ParameterList& params)
 
   ownOrdering_ = params.get("Custom Ordering", true);
   ownScaling_ = params.get("Custom Scaling", true);
+  reuseSymbolic_ = params.get("Reuse Symbolic Factorization", false);
+  refactorRcondRatio_ = params.get("Refactorization Rcond Ratio", refactorRcondRatio_);
+  sparseRhs_ = params.get("Sparse Right-hand Sides", false);
+  singleFactors_ = params.get("Single Precision Factors", false);
+  refinementSteps_ = params.get("Refinement Steps", refinementSteps_);
+
+  if (singleFactors_ && method_!=KLU)
+    {
+    Tools::Warning("Single precision factors are only available for KLU",__FILE__,__LINE__);
+    singleFactors_ = false;
+    }
 
   if (ownOrdering_)
     {
@@ -293,6 +312,13 @@ int SparseDirectSolver::SetParameters(Teuchos::ParameterList& params)
 #endif
     }
 
+  if ((sparseRhs_ || singleFactors_) && method_==KLU)
+    {
+    // The sparse and single precision solves need L and U of the whole
+    // matrix, not of the diagonal blocks of a block triangular form
+    klu_->Common_->btf = 0;
+    }
+
   return(0);
   }
 
@@ -300,6 +326,7 @@ int SparseDirectSolver::SetParameters(Teuchos::ParameterList& params)
 int SparseDirectSolver::Initialize()
   {
   HYMLS_PROF3(label_,"Initialize");
+  const double startTime = time_->WallTime();
   IsEmpty_ = false;
   IsInitialized_ = false;
   IsComputed_ = false;
@@ -319,6 +346,8 @@ int SparseDirectSolver::Initialize()
   if (Matrix_->NumGlobalRows() == 0) {
     IsEmpty_ = true;
     IsInitialized_ = true;
+    numInitialize_++;
+    initializeTime_ += time_->WallTime() - startTime;
     return(0);
     }
 
@@ -351,6 +380,8 @@ int SparseDirectSolver::Initialize()
     return -99;
     }
   IsInitialized_ = true;
+  numInitialize_++;
+  initializeTime_ += time_->WallTime() - startTime;
   return(0);
   }
 
@@ -358,15 +389,20 @@ int SparseDirectSolver::Initialize()
 int SparseDirectSolver::Compute()
   {
   HYMLS_PROF3(label_,"Compute");
+  const double startTime = time_->WallTime();
   if (!IsInitialized())
     CHECK_ZERO(Initialize());
 
   if (IsEmpty_) {
     IsComputed_ = true;
+    numCompute_++;
+    computeTime_ += time_->WallTime() - startTime;
     return(0);
     }
 
   IsComputed_ = false;
+  sparseReady_ = false;
+  singleReady_ = false;
 
   if (Matrix_ == Teuchos::null)
     {
@@ -391,10 +427,43 @@ int SparseDirectSolver::Compute()
     {
     CHECK_ZERO(ComputeScaling());
     }
-  CHECK_ZERO(this->ConvertToCRS());
+
+  // If the pattern has not changed since the last factorization, we keep
+  // the ordering, the CRS structure and the symbolic factorization and
+  // only put in the new values. Only the first process holds the CRS
+  // arrays, so all processes have to agree on this, since Initialize()
+  // communicates. Initialize() has been called above if needed, so the
+  // CRS arrays are always there when we get here.
+  bool refactor = false;
+  if (reuseSymbolic_)
+    {
+    int refreshed = (MyPID_ != 0 ||
+      (Ap_.size() > 0 && this->RefreshCRSValues() == 0)) ? 1 : 0;
+    int allRefreshed;
+    CHECK_ZERO(Matrix_->Comm().MinAll(&refreshed, &allRefreshed, 1));
+    refactor = (allRefreshed == 1);
+    if (!refactor)
+      {
+      HYMLS_DEBUG("matrix pattern changed, recompute the symbolic factorization");
+      CHECK_ZERO(this->Initialize());
+      }
+    }
+  else
+    {
+    CHECK_ZERO(this->ConvertToCRS());
+    }
+
   if (method_==KLU)
     {
-    CHECK_ZERO(this->KluNumeric());
+    CHECK_ZERO(this->KluNumeric(refactor));
+    if (sparseRhs_)
+      {
+      CHECK_ZERO(this->KluSparseSetup());
+      }
+    if (singleFactors_)
+      {
+      CHECK_ZERO(this->KluSingleSetup());
+      }
     }
 #ifdef HAVE_SUITESPARSE
   else if (method_==UMFPACK)
@@ -414,6 +483,9 @@ int SparseDirectSolver::Compute()
     }
 
   IsComputed_ = true;
+  numCompute_++;
+  if (refactor) numSymbolicReuse_++;
+  computeTime_ += time_->WallTime() - startTime;
   return(0);
   }
 
@@ -438,6 +510,7 @@ Apply(const Epetra_MultiVector& X, Epetra_MultiVector& Y) const
 int SparseDirectSolver::
 ApplyInverse(const Epetra_MultiVector& X, Epetra_MultiVector& Y) const
   {
+  const double startTime = time_->WallTime();
   if (IsEmpty_) {
     return(0);
     }
@@ -460,7 +533,11 @@ ApplyInverse(const Epetra_MultiVector& X, Epetra_MultiVector& Y) const
     Xcopy = Teuchos::rcp( &X, false );
     }
 
-  if (method_==KLU)
+  if (method_==KLU && singleReady_)
+    {
+    CHECK_ZERO(this->KluSolveSingle(*Xcopy,Y));
+    }
+  else if (method_==KLU)
     {
     CHECK_ZERO(this->KluSolve(*Xcopy,Y));
     }
@@ -491,11 +568,12 @@ ApplyInverse(const Epetra_MultiVector& X, Epetra_MultiVector& Y) const
   CHECK_ZERO(X.Norm2(bnorm2));
 
   double rcond = Condest();
+  double tol = singleReady_? 1.0e-6: 1.0e-12;
 
   bool bad_res=false;
   for (int i=0;i<X.NumVectors();i++)
     {
-    if (rnorm2[i]/bnorm2[i] > 1.0e-12/rcond)
+    if (rnorm2[i]/bnorm2[i] > tol/rcond)
       {
       bad_res=true;
       Tools::Warning("bad residual found: "+Teuchos::toString(rnorm2[i])+"\n"
@@ -513,6 +591,14 @@ ApplyInverse(const Epetra_MultiVector& X, Epetra_MultiVector& Y) const
   delete [] bnorm2;
 #endif
 
+  // the factors are only on the first process
+  if (method_==KLU && MyPID_==0)
+    {
+    applyInverseFlops_ += 2.0 * X.NumVectors() *
+      (NumGlobalNonzerosL() + NumGlobalNonzerosU());
+    }
+  numApplyInverse_++;
+  applyInverseTime_ += time_->WallTime() - startTime;
   return(0);
   }
 
@@ -728,6 +814,54 @@ int SparseDirectSolver::ConvertToCRS()
   return 0;
   }
 
+//=============================================================================
+int SparseDirectSolver::RefreshCRSValues()
+  {
+  HYMLS_PROF3(label_,"RefreshCRSValues");
+
+  if (MyPID_ == 0)
+    {
+    int N = serialMatrix_->NumMyRows();
+    if (Ap_.size() != N+1 || Ap_[N] != serialMatrix_->NumMyNonzeros())
+      {
+      return 1;
+      }
+
+    int NumEntries = serialMatrix_->MaxNumEntries();
+    Teuchos::Array<double> values(NumEntries);
+    Teuchos::Array<int> indices(NumEntries);
+    Teuchos::Array<int> invperm(N);
+    for (int i=0;i<N;i++) invperm[col_perm_[i]]=i;
+
+    const int *Ai_ptr = Ai_.getRawPtr();
+    int len;
+    for (int i = 0 ; i < N; i++)
+      {
+      int MyRow = row_perm_[i];
+      CHECK_ZERO(serialMatrix_->ExtractMyRowCopy(MyRow, NumEntries,
+          len, values.getRawPtr(), indices.getRawPtr()));
+      if (len != Ap_[i+1] - Ap_[i])
+        {
+        return 1;
+        }
+      // the rows in Ai are sorted, so we can find each entry by bisection
+      const int *first = Ai_ptr + Ap_[i];
+      const int *last = Ai_ptr + Ap_[i+1];
+      for (int j=0;j<len;j++)
+        {
+        const int *pos = std::lower_bound(first, last, invperm[indices[j]]);
+        if (pos == last || *pos != invperm[indices[j]])
+          {
+          return 1;
+          }
+        Aval_[pos - Ai_ptr] = values[j] *
+          (*scaLeft_)[MyRow] * (*scaRight_)[indices[j]];
+        }
+      }
+    }
+  return 0;
+  }
+
 //////////////////////////////////////////////////////////////////////
 // KLU INTERFACE                                                    //
 //////////////////////////////////////////////////////////////////////
@@ -761,11 +895,29 @@ int SparseDirectSolver::KluSymbolic()
 
 //=============================================================================
 
-int SparseDirectSolver::KluNumeric()
+int SparseDirectSolver::KluNumeric(bool refactor)
   {
   HYMLS_PROF3(label_,"KluNumeric");
   if (MyPID_!=0) return 0;
 
+  if (refactor && klu_->Numeric_)
+    {
+    // reuse the pivot sequence of the previous factorization
+    DO_KLU(refactor)(&Ap_[0], &Ai_[0], &Aval_[0],
+      klu_->Symbolic_, klu_->Numeric_, klu_->Common_);
+    if (klu_->Common_->status == 0)
+      {
+      DO_KLU(rcond)(klu_->Symbolic_,klu_->Numeric_,klu_->Common_);
+      if (klu_->Common_->rcond >= refactorRcondRatio_ * factorRcond_)
+        {
+        Condest_ = klu_->Common_->rcond;
+        return 0;
+        }
+      }
+    // the old pivots are no good for the new values
+    HYMLS_DEBUG("KLU refactorization is inaccurate, compute a full factorization");
+    }
+
   if (klu_->Numeric_) DO_KLU(free_numeric)(&klu_->Numeric_,klu_->Common_);
 
   klu_->Numeric_=DO_KLU(factor)(&Ap_[0], &Ai_[0], &Aval_[0],
@@ -780,6 +932,7 @@ int SparseDirectSolver::KluNumeric()
     }
   DO_KLU(rcond)(klu_->Symbolic_,klu_->Numeric_,klu_->Common_);
   Condest_ = klu_->Common_->rcond;
+  factorRcond_ = Condest_;
   return status;
   }
 
@@ -855,6 +1008,437 @@ int SparseDirectSolver::KluSolve(const Epetra_MultiVector& B, Epetra_MultiVector
   return status;
   }
 
+//=============================================================================
+
+int SparseDirectSolver::KluSparseSetup()
+  {
+  HYMLS_PROF3(label_,"KluSparseSetup");
+
+  if (MyPID_!=0 || Matrix_.get()!=serialMatrix_.get()) return 0;
+
+  // we can only handle a single block, which is the case without BTF
+  if (klu_->Symbolic_->nblocks != 1)
+    {
+    HYMLS_DEBUG("KLU factorization has more than one block, no sparse solves");
+    return 0;
+    }
+
+  int N = serialMatrix_->NumMyRows();
+  int lnz = klu_->Numeric_->lnz;
+  int unz = klu_->Numeric_->unz;
+
+  Teuchos::Array<int> Lp(N+1), Li(lnz), Up(N+1), Ui(unz), P(N), Q(N);
+  Teuchos::Array<double> Lx(lnz), Ux(unz), Rs(N);
+
+  DO_KLU(extract)(klu_->Numeric_, klu_->Symbolic_,
+    Lp.getRawPtr(), Li.getRawPtr(), Lx.getRawPtr(),
+    Up.getRawPtr(), Ui.getRawPtr(), Ux.getRawPtr(),
+    NULL, NULL, NULL, P.getRawPtr(), Q.getRawPtr(), Rs.getRawPtr(), NULL,
+    klu_->Common_);
+  if (klu_->Common_->status)
+    {
+    HYMLS::Tools::Error("KLU Extract Error "+Teuchos::toString(klu_->Common_->status),
+      __FILE__,__LINE__);
+    }
+
+  // KLU factors the transpose of our (permuted and scaled) matrix,
+  // Rs\A^T(P,Q) = L*U, so we solve U^T*L^T*y = b(Q) and x(P) = y./Rs(P)
+
+  // strictly lower part of U^T, i.e. the transpose of U without the diagonal
+  fwdP_.assign(N+1, 0);
+  fwdDiag_.resize(N);
+  for (int j = 0; j < N; j++)
+    {
+    for (int p = Up[j]; p < Up[j+1]; p++)
+      {
+      if (Ui[p] == j)
+        fwdDiag_[j] = Ux[p];
+      else
+        fwdP_[Ui[p]+1]++;
+      }
+    }
+  for (int i = 0; i < N; i++)
+    {
+    fwdP_[i+1] += fwdP_[i];
+    }
+  fwdI_.resize(fwdP_[N]);
+  fwdX_.resize(fwdP_[N]);
+  Teuchos::Array<int> next(fwdP_.begin(), fwdP_.end()-1);
+  for (int j = 0; j < N; j++)
+    {
+    for (int p = Up[j]; p < Up[j+1]; p++)
+      {
+      if (Ui[p] != j)
+        {
+        int q = next[Ui[p]]++;
+        fwdI_[q] = j;
+        fwdX_[q] = Ux[p];
+        }
+      }
+    }
+
+  // strictly lower part of L, the unit diagonal is dropped
+  bwdP_.resize(N+1);
+  bwdI_.resize(lnz);
+  bwdX_.resize(lnz);
+  int pos = 0;
+  for (int j = 0; j < N; j++)
+    {
+    bwdP_[j] = pos;
+    for (int p = Lp[j]; p < Lp[j+1]; p++)
+      {
+      if (Li[p] != j)
+        {
+        bwdI_[pos] = Li[p];
+        bwdX_[pos++] = Lx[p];
+        }
+      }
+    }
+  bwdP_[N] = pos;
+
+  // combine our own permutation and scaling with the one of KLU
+  Teuchos::Array<int> invQ(N), invP(N);
+  for (int i = 0; i < N; i++)
+    {
+    invQ[Q[i]] = i;
+    invP[P[i]] = i;
+    }
+
+  rhsPos_.resize(N);
+  rhsScale_.resize(N);
+  solPos_.resize(N);
+  solScale_.resize(N);
+  for (int i = 0; i < N; i++)
+    {
+    rhsPos_[row_perm_[i]] = invQ[i];
+    rhsScale_[row_perm_[i]] = (*scaLeft_)[row_perm_[i]];
+    solPos_[col_perm_[i]] = invP[i];
+    solScale_[col_perm_[i]] = (*scaRight_)[col_perm_[i]] / Rs[i];
+    }
+
+  work_.assign(N, 0.0);
+  reach_.resize(N);
+  needed_.resize(N);
+  stack_.resize(N);
+  pstack_.resize(N);
+  mark_.assign(N, 0);
+  stamp_ = 0;
+
+  sparseReady_ = true;
+  return 0;
+  }
+
+//=============================================================================
+
+int SparseDirectSolver::KluSingleSetup()
+  {
+  HYMLS_PROF3(label_,"KluSingleSetup");
+
+  if (MyPID_!=0 || Matrix_.get()!=serialMatrix_.get()) return 0;
+
+  // The factors are extracted in the same form as for the sparse solves.
+  // We only keep the double precision values if we need those as well.
+  bool keepDouble = sparseReady_;
+  if (!keepDouble)
+    {
+    CHECK_ZERO(this->KluSparseSetup());
+    if (!sparseReady_)
+      {
+      HYMLS_DEBUG("could not extract the KLU factors, keep them in double precision");
+      return 0;
+      }
+    }
+
+  fwdXs_.assign(fwdX_.begin(), fwdX_.end());
+  fwdDiags_.assign(fwdDiag_.begin(), fwdDiag_.end());
+  bwdXs_.assign(bwdX_.begin(), bwdX_.end());
+  workSingle_.resize(serialMatrix_->NumMyRows());
+
+  if (!keepDouble)
+    {
+    Teuchos::Array<double>().swap(fwdX_);
+    Teuchos::Array<double>().swap(fwdDiag_);
+    Teuchos::Array<double>().swap(bwdX_);
+    Teuchos::Array<double>().swap(work_);
+    sparseReady_ = false;
+    }
+
+  // All solves are now done with the single precision factors, so we
+  // do not keep the KLU factors. If the symbolic factorization is reused,
+  // the next Compute() factors with the stored ordering but new pivots.
+  DO_KLU(free_numeric)(&klu_->Numeric_,klu_->Common_);
+
+  singleReady_ = true;
+  return 0;
+  }
+
+//=============================================================================
+
+int SparseDirectSolver::KluSolveSingle(const Epetra_MultiVector& B, Epetra_MultiVector& X) const
+  {
+  HYMLS_PROF3(label_,"KluSolveSingle");
+
+  CHECK_ZERO(this->SingleSolve(B, X));
+
+  if (refinementSteps_ > 0)
+    {
+    // iterative refinement with the residual computed in double precision.
+    // The work vectors are only allocated again if the vectors change.
+    if (refineR_ == Teuchos::null ||
+      refineR_->NumVectors() != B.NumVectors() ||
+      !refineR_->Map().PointSameAs(B.Map()) ||
+      !refineD_->Map().PointSameAs(X.Map()))
+      {
+      refineR_ = Teuchos::rcp(new Epetra_MultiVector(B.Map(), B.NumVectors(), false));
+      refineD_ = Teuchos::rcp(new Epetra_MultiVector(X.Map(), X.NumVectors(), false));
+      }
+    Epetra_MultiVector &R = *refineR_;
+    Epetra_MultiVector &D = *refineD_;
+    for (int step = 0; step < refinementSteps_; step++)
+      {
+      CHECK_ZERO(Matrix_->Multiply(UseTranspose_, X, R));
+      CHECK_ZERO(R.Update(1.0, B, -1.0));
+      CHECK_ZERO(this->SingleSolve(R, D));
+      CHECK_ZERO(X.Update(1.0, D, 1.0));
+      }
+    }
+  return 0;
+  }
+
+//=============================================================================
+
+int SparseDirectSolver::SingleSolve(const Epetra_MultiVector& B, Epetra_MultiVector& X) const
+  {
+  int N = serialMatrix_->NumMyRows();
+  float *w = workSingle_.getRawPtr();
+
+  const int *fwdP = fwdP_.getRawPtr();
+  const int *fwdI = fwdI_.getRawPtr();
+  const float *fwdX = fwdXs_.getRawPtr();
+  const float *fwdDiag = fwdDiags_.getRawPtr();
+  const int *bwdP = bwdP_.getRawPtr();
+  const int *bwdI = bwdI_.getRawPtr();
+  const float *bwdX = bwdXs_.getRawPtr();
+
+  // For the transpose we solve L*U*y = b(P) instead of U^T*L^T*y = b(Q),
+  // which swaps the permutation and scaling of the right-hand side and
+  // the solution.
+  const Teuchos::Array<int>& inPos = UseTranspose_? solPos_: rhsPos_;
+  const Teuchos::Array<double>& inScale = UseTranspose_? solScale_: rhsScale_;
+  const Teuchos::Array<int>& outPos = UseTranspose_? rhsPos_: solPos_;
+  const Teuchos::Array<double>& outScale = UseTranspose_? rhsScale_: solScale_;
+
+  for (int k = 0; k < X.NumVectors(); k++)
+    {
+    const double *b = B[k];
+    for (int i = 0; i < N; i++)
+      {
+      w[inPos[i]] = (float)(b[i] * inScale[i]);
+      }
+
+    if (!UseTranspose_)
+      {
+      // forward solve with U^T
+      for (int j = 0; j < N; j++)
+        {
+        w[j] /= fwdDiag[j];
+        const float wj = w[j];
+        for (int p = fwdP[j]; p < fwdP[j+1]; p++)
+          {
+          w[fwdI[p]] -= fwdX[p] * wj;
+          }
+        }
+
+      // backward solve with L^T
+      for (int j = N-1; j >= 0; j--)
+        {
+        float wj = w[j];
+        for (int p = bwdP[j]; p < bwdP[j+1]; p++)
+          {
+          wj -= bwdX[p] * w[bwdI[p]];
+          }
+        w[j] = wj;
+        }
+      }
+    else
+      {
+      // forward solve with L
+      for (int j = 0; j < N; j++)
+        {
+        const float wj = w[j];
+        for (int p = bwdP[j]; p < bwdP[j+1]; p++)
+          {
+          w[bwdI[p]] -= bwdX[p] * wj;
+          }
+        }
+
+      // backward solve with U, the rows of which are stored in fwd
+      for (int j = N-1; j >= 0; j--)
+        {
+        float wj = w[j];
+        for (int p = fwdP[j]; p < fwdP[j+1]; p++)
+          {
+          wj -= fwdX[p] * w[fwdI[p]];
+          }
+        w[j] = wj / fwdDiag[j];
+        }
+      }
+
+    double *x = X[k];
+    for (int i = 0; i < N; i++)
+      {
+      x[i] = w[outPos[i]] * outScale[i];
+      }
+    }
+  return 0;
+  }
+
+//=============================================================================
+
+int SparseDirectSolver::Reach(int j, const int *Gp, const int *Gi, int top) const
+  {
+  // this is the non-recursive depth-first search from CSparse (cs_dfs)
+  int head = 0;
+  stack_[0] = j;
+  while (head >= 0)
+    {
+    j = stack_[head];
+    if (mark_[j] != stamp_)
+      {
+      mark_[j] = stamp_;
+      pstack_[head] = Gp[j];
+      }
+    bool done = true;
+    for (int p = pstack_[head]; p < Gp[j+1]; p++)
+      {
+      int i = Gi[p];
+      if (mark_[i] == stamp_) continue;
+      pstack_[head] = p + 1;
+      stack_[++head] = i;
+      done = false;
+      break;
+      }
+    if (done)
+      {
+      head--;
+      reach_[--top] = j;
+      }
+    }
+  return top;
+  }
+
+//=============================================================================
+
+bool SparseDirectSolver::HasSparseApplyInverse() const
+  {
+  return IsComputed_ && !IsEmpty_ && sparseReady_ && !UseTranspose_;
+  }
+
+//=============================================================================
+
+int SparseDirectSolver::ApplyInverseSparse(int NumVectors,
+  const int *Bp, const int *Bi, const double *Bx,
+  int NumRowsX, const int *RowsX, double *X, int LDX) const
+  {
+  HYMLS_PROF3(label_,"ApplyInverseSparse");
+
+  if (!HasSparseApplyInverse()) return -99;
+
+  int N = serialMatrix_->NumMyRows();
+  double *w = work_.getRawPtr();
+
+  // Find the rows of the backward solve that we need to compute the rows
+  // RowsX of the solution. These do not depend on the right-hand side.
+  stamp_++;
+  int top_needed = N;
+  for (int t = 0; t < NumRowsX; t++)
+    {
+    int j = solPos_[RowsX[t]];
+    if (mark_[j] != stamp_)
+      {
+      top_needed = Reach(j, bwdP_.getRawPtr(), bwdI_.getRawPtr(), top_needed);
+      }
+    }
+  // the nodes are in topological order, so in the backward solve we
+  // traverse them in reverse order
+  int num_needed = N - top_needed;
+  for (int t = 0; t < num_needed; t++)
+    {
+    needed_[t] = reach_[N - 1 - t];
+    }
+
+  const int *fwdP = fwdP_.getRawPtr();
+  const int *fwdI = fwdI_.getRawPtr();
+  const double *fwdX = fwdX_.getRawPtr();
+  const int *bwdP = bwdP_.getRawPtr();
+  const int *bwdI = bwdI_.getRawPtr();
+  const double *bwdX = bwdX_.getRawPtr();
+
+  // only the operations on the nodes that are actually visited
+  double flops = 2.0 * Bp[NumVectors] + 1.0 * NumVectors * NumRowsX;
+
+  for (int k = 0; k < NumVectors; k++)
+    {
+    // scatter the permuted and scaled right-hand side into w and find
+    // the nodes of U^T that are reachable from its nonzeros
+    stamp_++;
+    int top = N;
+    for (int p = Bp[k]; p < Bp[k+1]; p++)
+      {
+      int j = rhsPos_[Bi[p]];
+      w[j] += Bx[p] * rhsScale_[Bi[p]];
+      if (mark_[j] != stamp_)
+        {
+        top = Reach(j, fwdP, fwdI, top);
+        }
+      }
+
+    // forward solve with U^T
+    for (int t = top; t < N; t++)
+      {
+      int j = reach_[t];
+      w[j] /= fwdDiag_[j];
+      const double wj = w[j];
+      for (int p = fwdP[j]; p < fwdP[j+1]; p++)
+        {
+        w[fwdI[p]] -= fwdX[p] * wj;
+        }
+      flops += 1.0 + 2.0 * (fwdP[j+1] - fwdP[j]);
+      }
+
+    // backward solve with L^T, only for the rows we need
+    for (int t = 0; t < num_needed; t++)
+      {
+      int j = needed_[t];
+      double wj = w[j];
+      for (int p = bwdP[j]; p < bwdP[j+1]; p++)
+        {
+        wj -= bwdX[p] * w[bwdI[p]];
+        }
+      w[j] = wj;
+      flops += 2.0 * (bwdP[j+1] - bwdP[j]);
+      }
+
+    double *x = X + k * LDX;
+    for (int t = 0; t < NumRowsX; t++)
+      {
+      x[t] = w[solPos_[RowsX[t]]] * solScale_[RowsX[t]];
+      }
+
+    // clear the work space
+    for (int t = top; t < N; t++)
+      {
+      w[reach_[t]] = 0.0;
+      }
+    for (int t = 0; t < num_needed; t++)
+      {
+      w[needed_[t]] = 0.0;
+      }
+    }
+  applyInverseFlops_ += flops;
+  return 0;
+  }
+
 //////////////////////////////////////////////////////////////////////
 // END KLU INTERFACE                                                //
 //////////////////////////////////////////////////////////////////////
@@ -1275,8 +1859,16 @@ int SparseDirectSolver::NumGlobalNonzerosA() const
   return Matrix_->NumGlobalNonzeros();
   }
 
+bool SparseDirectSolver::HasSingleFactors() const
+  {
+  return IsComputed_ && !IsEmpty_ && singleReady_;
+  }
+
 int SparseDirectSolver::NumGlobalNonzerosL() const
   {
+    // the single precision factors do not store the unit diagonal of L
+    if (method_==KLU && singleReady_)
+      return bwdP_.back() + bwdP_.size() - 1;
     if (method_==KLU)
       return klu_->Numeric_->lnz;
     return 0;
@@ -1284,6 +1876,8 @@ int SparseDirectSolver::NumGlobalNonzerosL() const
 
 int SparseDirectSolver::NumGlobalNonzerosU() const
   {
+    if (method_==KLU && singleReady_)
+      return fwdP_.back() + fwdDiags_.size();
     if (method_==KLU)
       return klu_->Numeric_->unz;
     return 0;
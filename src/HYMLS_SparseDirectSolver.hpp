@@ -19,6 +19,8 @@ class KluWrapper;
 
 namespace HYMLS {
 
+class Epetra_Time;
+
 //! this is our own interface to some serial sparse direct
 //! solvers. Using our own interface gives us access to more
 //! settings of the methods and allows us to use own ordering
@@ -36,6 +38,31 @@ namespace HYMLS {
 //! "Custom Scaling" (bool) If true we construct our own row and col
 //!             scaling, otherwise we leave it to the method.
 //! "OutputLevel" (int) controls the verbosity of the method.
+//! "Reuse Symbolic Factorization" (bool) if true, repeated calls to
+//!             Compute() keep the ordering, CRS structure and symbolic
+//!             factorization and only refresh the values. For KLU the
+//!             pivot sequence of the previous factorization is reused
+//!             as well (klu_refactor).
+//! "Refactorization Rcond Ratio" (double) if the reciprocal condition
+//!             estimate after a KLU refactorization drops below this
+//!             ratio times that of the last full factorization, a full
+//!             factorization with new pivots is computed instead.
+//! "Sparse Right-hand Sides" (bool) if true, the KLU factors are also
+//!             stored in a form that allows ApplyInverseSparse(), which
+//!             only visits the part of the factors reachable from the
+//!             nonzeros of the right-hand side. This disables the BTF
+//!             pre-ordering of KLU.
+//! "Single Precision Factors" (bool) if true, the KLU factors are stored
+//!             in single precision after the factorization and the
+//!             triangular solves are done in single precision. This
+//!             halves the memory used by the factors. The solution is
+//!             improved by iterative refinement with the original matrix.
+//!             This disables the BTF pre-ordering of KLU. The double
+//!             precision KLU factors are not kept, so if "Reuse Symbolic
+//!             Factorization" is also set, only the ordering and symbolic
+//!             factorization are reused and not the pivot sequence.
+//! "Refinement Steps" (int) number of iterative refinement steps after
+//!             a single precision solve (default 1).
 //!
 class SparseDirectSolver : public Ifpack_Preconditioner 
 {
@@ -195,37 +222,44 @@ public:
   //! Returns the number of calls to Initialize().
   virtual int NumInitialize() const
   {
-    return -1;
+    return numInitialize_;
   }
 
   //! Returns the number of calls to Compute().
   virtual int NumCompute() const
   {
-    return -1;
+    return numCompute_;
   }
 
   //! Returns the number of calls to ApplyInverse().
   virtual int NumApplyInverse() const
   {
-    return -1;
+    return numApplyInverse_;
   }
 
   //! Returns the total time spent in Initialize().
   virtual double InitializeTime() const
   {
-    return -1.0;
+    return initializeTime_;
   }
 
   //! Returns the total time spent in Compute().
   virtual double ComputeTime() const
   {
-    return  -1.0;
+    return computeTime_;
+  }
+
+  //! Returns the number of calls to Compute() that only refreshed the
+  //! values and kept the symbolic factorization ("Reuse Symbolic Factorization").
+  int NumSymbolicReuse() const
+  {
+    return numSymbolicReuse_;
   }
 
   //! Returns the total time spent in ApplyInverse().
   virtual double ApplyInverseTime() const
   {
-    return  -1.0;
+    return applyInverseTime_;
   }
 
   //! Returns the number of flops in the initialization phase.
@@ -240,10 +274,11 @@ public:
     return -1.0;
   }
 
-  //! Returns the total number of flops to apply the preconditioner.
+  //! Returns the total number of flops to apply the preconditioner,
+  //! which are only counted for KLU.
   virtual double ApplyInverseFlops() const
   {
-    return -1.0;
+    return applyInverseFlops_;
   }
 
   //! Prints on ostream basic information about \c this object.
@@ -251,9 +286,28 @@ public:
 
   //@}
   
+  //! returns true if ApplyInverseSparse() can be used
+  bool HasSparseApplyInverse() const;
+
+  //! Solve A X = B for a B with only a few nonzero rows. B is given in
+  //! compressed column format (Bp, Bi, Bx) with NumVectors columns and row
+  //! indices in the row map of the matrix. Only the NumRowsX rows RowsX of
+  //! the solution are computed and stored in the column major array X with
+  //! leading dimension LDX, so X(t,k) is row RowsX[t] of the k-th solution.
+  //! The triangular solves only visit the parts of the factors that are
+  //! reachable from the nonzeros in B or needed for the rows in RowsX,
+  //! and only those operations are added to ApplyInverseFlops().
+  //! Returns -99 if HasSparseApplyInverse() is false.
+  int ApplyInverseSparse(int NumVectors,
+    const int *Bp, const int *Bi, const double *Bx,
+    int NumRowsX, const int *RowsX, double *X, int LDX) const;
+
   //! return number of nonzeros in original matrix
   int NumGlobalNonzerosA() const;
 
+  //! returns true if the factors are stored in single precision
+  bool HasSingleFactors() const;
+
   //! return number of nonzeros in L
   int NumGlobalNonzerosL() const;
 
@@ -315,6 +369,22 @@ private:
 
   //! Contains the estimated condition number.
   double Condest_;
+
+  //! number of successful calls to Initialize() and Compute(), and the
+  //! number of calls to Compute() that reused the symbolic factorization
+  int numInitialize_, numCompute_, numSymbolicReuse_;
+
+  //! number of successful calls to ApplyInverse()
+  mutable int numApplyInverse_;
+
+  //! time spent in Initialize() and Compute()
+  double initializeTime_, computeTime_;
+
+  //! time and flops spent in ApplyInverse()
+  mutable double applyInverseTime_, applyInverseFlops_;
+
+  //! timer for the above
+  Teuchos::RCP<Epetra_Time> time_;
   
   //!
   int MyPID_;
@@ -334,6 +404,67 @@ private:
   //! use Umfpack or our own scaling
   bool ownScaling_;
 
+  //! keep the symbolic factorization in repeated calls to Compute()
+  bool reuseSymbolic_;
+
+  //! fall back to a full factorization if the rcond estimate of a
+  //! refactorization drops below this ratio times factorRcond_
+  double refactorRcondRatio_;
+
+  //! rcond estimate of the last full (non-reused) numeric factorization
+  double factorRcond_;
+
+  //! keep the factors in a form that allows ApplyInverseSparse()
+  bool sparseRhs_;
+
+  //! true if the arrays below are up to date with the factorization
+  bool sparseReady_;
+
+  //! store the factors in single precision
+  bool singleFactors_;
+
+  //! number of iterative refinement steps after a single precision solve
+  int refinementSteps_;
+
+  //! true if the single precision factors are up to date with the
+  //! factorization. The KLU factors are freed in that case.
+  bool singleReady_;
+
+  //! \name Factors for sparse right-hand sides
+  //! We solve with the transpose of the KLU factors, see KluSolve(),
+  //! so the forward solve is with U^T and the backward solve with L^T.
+  //@{
+
+    //! strictly lower part of U^T in compressed column format
+    Teuchos::Array<int> fwdP_, fwdI_;
+    Teuchos::Array<double> fwdX_;
+    //! diagonal of U
+    Teuchos::Array<double> fwdDiag_;
+    //! strictly lower part of L in compressed column format, which are
+    //! the rows of the strictly upper part of L^T
+    Teuchos::Array<int> bwdP_, bwdI_;
+    Teuchos::Array<double> bwdX_;
+    //! position of each row of B in the permuted right-hand side and
+    //! the scaling factor for that row
+    Teuchos::Array<int> rhsPos_;
+    Teuchos::Array<double> rhsScale_;
+    //! position of each row of X in the permuted solution and the
+    //! scaling factor for that row
+    Teuchos::Array<int> solPos_;
+    Teuchos::Array<double> solScale_;
+    //! work space for the solves
+    mutable Teuchos::Array<double> work_;
+    mutable Teuchos::Array<int> reach_, needed_, stack_, pstack_, mark_;
+    mutable int stamp_;
+    //! single precision copies of fwdX_, fwdDiag_ and bwdX_. The double
+    //! precision values are only kept if we also need them for sparse solves.
+    Teuchos::Array<float> fwdXs_, fwdDiags_, bwdXs_;
+    //! single precision work space
+    mutable Teuchos::Array<float> workSingle_;
+    //! residual and correction of the iterative refinement
+    mutable Teuchos::RCP<Epetra_MultiVector> refineR_, refineD_;
+  //@}
+
   //! \name SuiteSparse interface, reordering etc
   //@{
 
@@ -387,6 +518,17 @@ private:
   */
   int ConvertToCRS();
 
+  /*
+    RefreshCRSValues - Refill Aval with the values of the matrix, keeping
+    the structure in Ap and Ai.
+    Preconditions:
+      ConvertToCRS() has been called for a matrix with the same pattern
+    Postconditions:
+      returns 0 if the values were refreshed and 1 if the pattern of the
+      matrix has changed, in which case Aval is invalid.
+  */
+  int RefreshCRSValues();
+
   /*! symbolic factorization using Umfpack
   */      
   int UmfpackSymbolic();
@@ -402,13 +544,35 @@ private:
   */      
   int KluSymbolic();
 
-  /*! numeric factorization using KLU
+  /*! numeric factorization using KLU. If refactor is true, the pivot
+      sequence of the previous factorization is reused if that is accurate
+      enough.
   */
-  int KluNumeric();
+  int KluNumeric(bool refactor=false);
 
   /*! perform solve using KLU */
   int KluSolve(const Epetra_MultiVector& B, Epetra_MultiVector& X) const;
 
+  /*! extract the KLU factors for ApplyInverseSparse() */
+  int KluSparseSetup();
+
+  /*! convert the KLU factors to single precision and free the KLU factors */
+  int KluSingleSetup();
+
+  /*! perform a solve with the single precision factors followed by
+      refinementSteps_ steps of iterative refinement */
+  int KluSolveSingle(const Epetra_MultiVector& B, Epetra_MultiVector& X) const;
+
+  /*! perform a solve with the single precision factors only */
+  int SingleSolve(const Epetra_MultiVector& B, Epetra_MultiVector& X) const;
+
+  /*! depth-first search in the graph of a strictly triangular matrix
+      in compressed column format, starting at node j. The nodes that
+      are reached are put in reach_ at positions [top-#found, top) in
+      topological order. Returns the new top.
+  */
+  int Reach(int j, const int *Gp, const int *Gi, int top) const;
+
   /*! symbolic factorization using Pardiso
   */      
   int PardisoSymbolic();
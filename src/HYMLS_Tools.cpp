@@ -9,6 +9,7 @@
 #include "Teuchos_toString.hpp"
 
 #include <cstdlib>
+#include <cstdint>
 #include <cstdarg>
 #include <dlfcn.h>
 #include <signal.h>
@@ -26,6 +27,17 @@
 #include "EpetraExt_RowMatrixOut.h"
 
 #include <fstream>
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <deque>
+#include <vector>
+#include <mutex>
+#include <sstream>
+
+#ifdef HYMLS_USE_OPENMP
+#include <omp.h>
+#endif
 
 class Epetra_RowMatrix;
 
@@ -54,13 +66,11 @@ int printf (const char *fmt, ...)
 namespace HYMLS {
 
 RCP<const Epetra_Comm> Tools::comm_=null;
-ParameterList Tools::timerList_;
 ParameterList Tools::breakpointList_;
 ParameterList Tools::memList_;
 RCP<FancyOStream> Tools::output_stream = null;
 RCP<FancyOStream> Tools::debug_stream = null;
 int Tools::traceLevel_=0;
-int Tools::timerCounter_=0;
 std::stack<std::string> Tools::functionStack_;
 std::streambuf* Tools::rdbuf_bak = std::cout.rdbuf();
 
@@ -342,9 +352,316 @@ int Tools::SplitBox(int nx, int ny, int nz, int nparts, int& ndx, int& ndy, int&
 // Timing functionality                                         //
 //////////////////////////////////////////////////////////////////
 
-RCP<Epetra_Time> Tools::StartTiming(std::string const &fname)
+namespace {
+
+//! protects the timer registry below
+std::mutex timerMutex;
+
+//! timer ids by label, and labels and levels by id
+std::map<std::string, int> timerIds;
+std::deque<std::string> timerLabels;
+std::deque<int> timerLevels;
+
+//! number of workspace vectors allocated
+std::atomic<long long> numWorkspaceAllocations(0);
+
+//! timers started with StartTiming() that may be stopped by name
+std::map<std::string, RCP<HYMLS::Epetra_Time> > startedTimers;
+
+//! timing counters of a single thread, these are only written by
+//! the owning thread and summed up in PrintTiming(), which may run in
+//! another thread at the same time. The counters are atomic so that
+//! this is not a data race, and they are in a deque so that they do
+//! not move when more timers are added.
+struct ThreadTimers
+  {
+  std::deque<std::atomic<long long> > ncalls;
+  std::deque<std::atomic<double> > elapsed;
+
+  ThreadTimers();
+
+  ~ThreadTimers();
+  };
+
+//! counters of all running threads
+std::vector<ThreadTimers*> threadTimers;
+
+//! counters of threads that have already finished
+std::vector<long long> retiredCalls;
+std::vector<double> retiredElapsed;
+
+ThreadTimers::ThreadTimers()
+  {
+  std::lock_guard<std::mutex> lock(timerMutex);
+  threadTimers.push_back(this);
+  }
+
+ThreadTimers::~ThreadTimers()
+  {
+  std::lock_guard<std::mutex> lock(timerMutex);
+  if (retiredCalls.size() < ncalls.size())
+    {
+    retiredCalls.resize(ncalls.size(), 0);
+    retiredElapsed.resize(ncalls.size(), 0.0);
+    }
+  for (size_t i = 0; i < ncalls.size(); i++)
+    {
+    retiredCalls[i] += ncalls[i].load(std::memory_order_relaxed);
+    retiredElapsed[i] += elapsed[i].load(std::memory_order_relaxed);
+    }
+  for (size_t i = 0; i < threadTimers.size(); i++)
+    {
+    if (threadTimers[i] == this)
+      {
+      threadTimers.erase(threadTimers.begin() + i);
+      break;
+      }
+    }
+  }
+
+ThreadTimers& MyTimers()
+  {
+  thread_local ThreadTimers timers;
+  return timers;
+  }
+
+//! a single timer call in the trace, times in microseconds
+struct TraceEvent
+  {
+  int id;
+  int thread;
+  int subdomain;
+  double start;
+  double duration;
+  };
+
+//! trace events of a single thread. Only the owning thread writes the
+//! events, and it publishes them by increasing the count afterwards, so
+//! WriteTrace() can read them from another thread. The buffers are kept
+//! in traceBuffers when the thread finishes, so they are shared.
+struct ThreadTrace
+  {
+  //! ring buffer with the last events of this thread
+  std::vector<TraceEvent> events;
+
+  //! total number of events recorded, the buffer holds the last ones
+  std::atomic<long long> count;
+
+  //! trace that the events belong to, see StartTrace()
+  int generation;
+
+  ThreadTrace() : count(0), generation(-1) {}
+  };
+
+//! trace buffers of all threads
+std::vector<std::shared_ptr<ThreadTrace> > traceBuffers;
+
+//! number of events that fit in the buffer of each thread
+std::atomic<int> traceCapacity(1);
+
+//! increased by StartTrace(), so every thread clears its buffer before
+//! it records the first event of a new trace
+std::atomic<int> traceGeneration(0);
+
+//! tracing is enabled if this is true
+std::atomic<bool> tracing(false);
+
+//! the time at which the trace was started
+std::chrono::steady_clock::time_point traceStart;
+
+//! subdomain that the current thread works on
+thread_local int traceSubdomain = -1;
+
+ThreadTrace& MyTrace()
+  {
+  thread_local std::shared_ptr<ThreadTrace> trace;
+  if (!trace)
+    {
+    trace = std::make_shared<ThreadTrace>();
+    std::lock_guard<std::mutex> lock(timerMutex);
+    traceBuffers.push_back(trace);
+    }
+  return *trace;
+  }
+
+std::string JsonEscape(std::string const &str)
+  {
+  std::string ret;
+  for (char c : str)
+    {
+    if (c == '"' || c == '\\')
+      ret += '\\';
+    if ((unsigned char)c < 0x20)
+      ret += ' ';
+    else
+      ret += c;
+    }
+  return ret;
+  }
+
+  }
+
+int Tools::RegisterTimer(std::string const &label, int level)
+  {
+  std::lock_guard<std::mutex> lock(timerMutex);
+  auto it = timerIds.find(label);
+  if (it != timerIds.end())
+    return it->second;
+  const int id = timerLabels.size();
+  timerLabels.push_back(label);
+  timerLevels.push_back(level);
+  timerIds[label] = id;
+  return id;
+  }
+
+std::string const &Tools::TimerLabel(int id)
+  {
+  std::lock_guard<std::mutex> lock(timerMutex);
+  return timerLabels[id];
+  }
+
+void Tools::AddTiming(int id, double elapsed)
+  {
+  ThreadTimers &timers = MyTimers();
+  if (id >= (int)timers.ncalls.size())
+    {
+    // PrintTiming may be reading the counters
+    std::lock_guard<std::mutex> lock(timerMutex);
+    while (timers.ncalls.size() < timerLabels.size())
+      {
+      timers.ncalls.emplace_back(0);
+      timers.elapsed.emplace_back(0.0);
+      }
+    }
+
+  // there is only one writer, so we do not need an atomic increment
+  std::atomic<long long> &ncalls = timers.ncalls[id];
+  std::atomic<double> &total = timers.elapsed[id];
+  ncalls.store(ncalls.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  total.store(total.load(std::memory_order_relaxed) + elapsed, std::memory_order_relaxed);
+  }
+
+void Tools::StartTrace(int capacity)
+  {
+  std::lock_guard<std::mutex> lock(timerMutex);
+  tracing = false;
+  traceCapacity = std::max(capacity, 1);
+  traceGeneration++;
+  traceStart = std::chrono::steady_clock::now();
+  tracing = true;
+  }
+
+void Tools::RecordTrace(int id, std::chrono::steady_clock::time_point start,
+  std::chrono::steady_clock::time_point end)
+  {
+  // timers that were started before the trace are not recorded
+  if (!tracing || start < traceStart)
+    return;
+
+  ThreadTrace &trace = MyTrace();
+  const int generation = traceGeneration;
+  if (trace.generation != generation)
+    {
+    // the events of a previous trace are discarded
+    trace.count.store(0, std::memory_order_relaxed);
+    trace.events.resize(traceCapacity);
+    trace.generation = generation;
+    }
+
+  const long long count = trace.count.load(std::memory_order_relaxed);
+  TraceEvent &event = trace.events[count % trace.events.size()];
+  event.id = id;
+#ifdef HYMLS_USE_OPENMP
+  event.thread = omp_get_thread_num();
+#else
+  event.thread = 0;
+#endif
+  event.subdomain = traceSubdomain;
+  event.start = std::chrono::duration<double, std::micro>(start - traceStart).count();
+  event.duration = std::chrono::duration<double, std::micro>(end - start).count();
+  trace.count.store(count + 1, std::memory_order_release);
+  }
+
+int Tools::SetTraceSubdomain(int sd)
+  {
+  int previous = traceSubdomain;
+  traceSubdomain = sd;
+  return previous;
+  }
+
+void Tools::WriteTrace(std::string const &filename)
+  {
+  const int rank = comm_ != null ? comm_->MyPID() : 0;
+
+  // stop recording while we convert the events
+  tracing = false;
+
+  std::ostringstream ss;
+  ss.precision(15);
+  {
+  std::lock_guard<std::mutex> lock(timerMutex);
+  ss << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << rank
+     << ",\"args\":{\"name\":\"rank " << rank << "\"}},\n";
+
+  // merge the buffers of all threads that recorded events in this trace
+  long long total = 0;
+  long long written = 0;
+  for (std::shared_ptr<ThreadTrace> const &trace : traceBuffers)
+    {
+    if (trace->generation != traceGeneration)
+      continue;
+    const long long count = trace->count.load(std::memory_order_acquire);
+    const long long size = trace->events.size();
+    for (long long i = std::max(0LL, count - size); i < count; i++)
+      {
+      TraceEvent const &event = trace->events[i % size];
+      ss << "{\"name\":\"" << JsonEscape(timerLabels[event.id])
+         << "\",\"cat\":\"hymls\",\"ph\":\"X\""
+         << ",\"ts\":" << event.start << ",\"dur\":" << event.duration
+         << ",\"pid\":" << rank << ",\"tid\":" << event.thread
+         << ",\"args\":{\"level\":" << timerLevels[event.id]
+         << ",\"subdomain\":" << event.subdomain << "}},\n";
+      written++;
+      }
+    total += count;
+    }
+  if (total > written)
+    {
+    Tools::Warning("trace buffer overflow, only the last " + Teuchos::toString(written)
+      + " of " + Teuchos::toString(total) + " events are written", __FILE__, __LINE__);
+    }
+  }
+  std::string local = ss.str();
+
+  // collect the events of all processes on the root process
+  std::string global = local;
+  const Epetra_MpiComm *mpiComm = dynamic_cast<const Epetra_MpiComm*>(comm_.get());
+  if (mpiComm != NULL && mpiComm->NumProc() > 1)
+    {
+    int len = local.size();
+    std::vector<int> lengths(mpiComm->NumProc()), offsets(mpiComm->NumProc() + 1, 0);
+    MPI_Gather(&len, 1, MPI_INT, lengths.data(), 1, MPI_INT, 0, mpiComm->Comm());
+    for (int p = 0; p < mpiComm->NumProc(); p++)
+      {
+      offsets[p+1] = offsets[p] + lengths[p];
+      }
+    global.resize(rank == 0 ? offsets.back() : 0);
+    MPI_Gatherv(&local[0], len, MPI_CHAR, &global[0], lengths.data(), offsets.data(),
+      MPI_CHAR, 0, mpiComm->Comm());
+    }
+
+  if (rank == 0)
+    {
+    // remove the separator after the last event
+    if (global.size() >= 2)
+      global.resize(global.size() - 2);
+    std::ofstream ofs(filename.c_str());
+    ofs << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n" << global << "\n]}\n";
+    }
+  }
+
+void Tools::EnterFunction(std::string const &fname)
   {
-  RCP<Epetra_Time> T=null;
 #ifdef HYMLS_FUNCTION_TRACING
   traceLevel_++;
   functionStack_.push(fname);
@@ -362,20 +679,9 @@ RCP<Epetra_Time> Tools::StartTiming(std::string const &fname)
     }
 #endif
 #endif
-  if (InitializedIO())
-    {
-    T=rcp(new Epetra_Time(*comm_));
-    if (timerList_.sublist("timer id").isParameter(fname)==false)
-      {
-      timerCounter_++;
-      timerList_.sublist("timer id").set(fname,timerCounter_);
-      }  
-    timerList_.sublist("timers").set(fname,T);
-    }
-    return T;
   }
 
-void Tools::StopTiming(std::string const &fname, bool print, RCP<Epetra_Time> T)
+void Tools::LeaveFunction(std::string const &fname)
   {
 #ifdef HYMLS_FUNCTION_TRACING
   // when an exception or other error is encountered,
@@ -391,18 +697,37 @@ void Tools::StopTiming(std::string const &fname, bool print, RCP<Epetra_Time> T)
     }
   traceLevel_--;
 #endif
+  }
+
+RCP<Epetra_Time> Tools::StartTiming(std::string const &fname)
+  {
+  RCP<Epetra_Time> T=null;
+  EnterFunction(fname);
+  if (InitializedIO())
+    {
+    T=rcp(new Epetra_Time(*comm_));
+    // make sure the timer gets its position in the output
+    RegisterTimer(fname);
+    std::lock_guard<std::mutex> lock(timerMutex);
+    startedTimers[fname]=T;
+    }
+    return T;
+  }
+
+void Tools::StopTiming(std::string const &fname, bool print, RCP<Epetra_Time> T)
+  {
+  LeaveFunction(fname);
   if (T == null)
     {
-    T=timerList_.sublist("timers").get(fname,T);
+    std::lock_guard<std::mutex> lock(timerMutex);
+    auto it = startedTimers.find(fname);
+    if (it != startedTimers.end())
+      T = it->second;
     }
-  double elapsed=0;
   if (T!=null)
     {
-    elapsed=T->ElapsedTime();
-    int ncalls=timerList_.sublist("number of calls").get(fname,0);
-    double total_time=timerList_.sublist("total time").get(fname,0.0);
-    timerList_.sublist("number of calls").set(fname,ncalls+1);
-    timerList_.sublist("total time").set(fname,total_time+elapsed);
+    double elapsed=T->ElapsedTime();
+    AddTiming(RegisterTimer(fname), elapsed);
 
     if (print)
       {
@@ -546,10 +871,6 @@ std::basic_ostream<charT, traits>& operator<<(std::basic_ostream<charT, traits>&
 
 void Tools::PrintTiming(std::ostream& os)
   {
-  ParameterList& idList=timerList_.sublist("timer id");
-  ParameterList& ncallsList=timerList_.sublist("number of calls");
-  ParameterList& elapsedList=timerList_.sublist("total time");
-
   os << std::setfill('=') << std::setw(120) << centered(" TIMING RESULTS ") << std::endl;
   os << std::setfill(' ') << std::setw(120-17*3) << std::left << "Description"
      << std::setfill(' ') << std::setw(17) << std::left << "# Calls"
@@ -558,31 +879,47 @@ void Tools::PrintTiming(std::ostream& os)
      << std::endl;
   os << std::setfill('=') << std::setw(120) << "" << std::endl;
 
-  // first construct a correctly sorted list according to timer ID
-  Teuchos::ParameterList sortedList;
-  for (ParameterList::ConstIterator i=ncallsList.begin();i!=ncallsList.end();i++)
+  // sum up the counters of all threads. The timers are listed by id,
+  // which is the order in which they were first used.
+  std::lock_guard<std::mutex> lock(timerMutex);
+  std::vector<long long> ncallsList(retiredCalls);
+  std::vector<double> elapsedList(retiredElapsed);
+  ncallsList.resize(timerLabels.size(), 0);
+  elapsedList.resize(timerLabels.size(), 0.0);
+  for (ThreadTimers const *timers : threadTimers)
     {
-    const string& fname = i->first;
-    int id = idList.get(fname,0);
-    std::stringstream label;
-    label << std::setw(6) << std::setfill('0') << id << " " << fname;
-    sortedList.set(label.str(),fname);
+    for (size_t i = 0; i < timers->ncalls.size(); i++)
+      {
+      ncallsList[i] += timers->ncalls[i].load(std::memory_order_relaxed);
+      elapsedList[i] += timers->elapsed[i].load(std::memory_order_relaxed);
+      }
     }
 
-  for (ParameterList::ConstIterator i=sortedList.begin();i!=sortedList.end();i++)
+  for (size_t i = 0; i < timerLabels.size(); i++)
     {
-    const string& label = i->first;
-    string fname = sortedList.get(label,"bad label");
-    int ncalls = ncallsList.get(fname,0);
-    double elapsed = elapsedList.get(fname,0.0);
-    os << std::setfill(' ') << std::setw(120-17*3) << std::left << fname
+    long long ncalls = ncallsList[i];
+    if (ncalls == 0) continue;
+    double elapsed = elapsedList[i];
+    os << std::setfill(' ') << std::setw(120-17*3) << std::left << timerLabels[i]
        << std::setfill(' ') << std::setw(17) << std::left << ncalls
        << std::setfill(' ') << std::setw(17) << std::left << elapsed
        << std::setfill(' ') << std::setw(17) << std::left
-       << (ncalls > 0 ? elapsed/(double)ncalls : 0.0)
+       << elapsed/(double)ncalls
        << std::endl;
     }
   os << std::setfill('=') << std::setw(120) << "" << std::endl;
+  os << "Workspace vectors allocated: " << numWorkspaceAllocations.load() << std::endl;
+  os << std::setfill('=') << std::setw(120) << "" << std::endl;
+  }
+
+void Tools::CountWorkspaceAllocation()
+  {
+  numWorkspaceAllocations++;
+  }
+
+long long Tools::NumWorkspaceAllocations()
+  {
+  return numWorkspaceAllocations;
   }
 
 void Tools::PrintMemUsage(std::ostream& os)
@@ -737,18 +1074,117 @@ bool Tools::GetCheckPoint(std::string fname, std::string& msg,
 
 TimerObject::TimerObject(std::string const &s, bool print)
   :
-  s_(s),
-  print_(print)
+  id_(Tools::RegisterTimer(s)),
+  print_(print),
+  memory_used_(0),
+  memory_allocated_(0)
+  {
+  Start();
+  }
+
+TimerObject::TimerObject(int id, bool print)
+  :
+  id_(id),
+  print_(print),
+  memory_used_(0),
+  memory_allocated_(0)
+  {
+  Start();
+  }
+
+void TimerObject::Start()
   {
-  T_=Tools::StartTiming(s);
-  auto m = Tools::StartMemory(s);
+#ifdef HYMLS_FUNCTION_TRACING
+  Tools::EnterFunction(Tools::TimerLabel(id_));
+#endif
+  active_ = Tools::InitializedIO();
+#ifdef HYMLS_MEMORY_PROFILING
+  auto m = Tools::StartMemory(Tools::TimerLabel(id_));
   memory_used_ = std::get<0>(m);
   memory_allocated_ = std::get<1>(m);
+#endif
+  start_ = std::chrono::steady_clock::now();
   }
 
 TimerObject::~TimerObject()
   {
-  Tools::StopTiming(s_, print_, T_);
-  Tools::StopMemory(s_, print_, memory_used_, memory_allocated_);
+  const std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+  const double elapsed = std::chrono::duration<double>(end - start_).count();
+#ifdef HYMLS_FUNCTION_TRACING
+  Tools::LeaveFunction(Tools::TimerLabel(id_));
+#endif
+  if (active_)
+    {
+    Tools::AddTiming(id_, elapsed);
+    Tools::RecordTrace(id_, start_, end);
+    if (print_)
+      {
+      Tools::out() << "### timing: " << Tools::TimerLabel(id_)
+                   << " " << elapsed << std::endl;
+      }
+    }
+#ifdef HYMLS_MEMORY_PROFILING
+  Tools::StopMemory(Tools::TimerLabel(id_), print_, memory_used_, memory_allocated_);
+#endif
+  }
+
+TimerSite::~TimerSite()
+  {
+  for (std::atomic<const Entry *> &entry : entries_)
+    {
+    delete entry.load(std::memory_order_relaxed);
+    }
+  }
+
+int TimerSite::Find(const char *s1, const char *s2, int level)
+  {
+  // The addresses of the strings are a cheap hash. The strings themselves
+  // are compared as well, since an address may be reused for another label.
+  std::size_t hash = reinterpret_cast<std::uintptr_t>(s1) >> 3;
+  hash = 31 * hash + (reinterpret_cast<std::uintptr_t>(s2) >> 3);
+  hash = 31 * hash + (level + 1);
+
+  Entry *entry = NULL;
+  for (int k = 0; k < capacity_; k++)
+    {
+    std::atomic<const Entry *> &slot = entries_[(hash + k) % capacity_];
+    const Entry *e = slot.load(std::memory_order_acquire);
+    if (e == NULL)
+      {
+      if (entry == NULL)
+        {
+        entry = NewEntry(s1, s2, level);
+        }
+      if (slot.compare_exchange_strong(e, entry, std::memory_order_acq_rel))
+        {
+        return entry->id;
+        }
+      // another thread stored an entry in this slot, which is now in e
+      }
+    if (e->level == level && e->s1 == s1 && e->s2 == s2)
+      {
+      delete entry;
+      return e->id;
+      }
+    }
+
+  // the cache is full, so we do not keep the entry
+  if (entry == NULL)
+    {
+    entry = NewEntry(s1, s2, level);
+    }
+  const int id = entry->id;
+  delete entry;
+  return id;
+  }
+
+TimerSite::Entry *TimerSite::NewEntry(const char *s1, const char *s2, int level)
+  {
+  std::string label = s1;
+  if (level >= 0)
+    label += "_L" + Teuchos::toString(level);
+  label += ": ";
+  label += s2;
+  return new Entry{s1, s2, level, Tools::RegisterTimer(label, level)};
   }
 }
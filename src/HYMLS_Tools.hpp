@@ -7,6 +7,9 @@
 #include <cstdio>
 #include <string>
 #include <iosfwd>
+#include <array>
+#include <atomic>
+#include <chrono>
 
 #include "Teuchos_RCP.hpp"
 #include "Teuchos_FancyOStream.hpp"
@@ -86,6 +89,43 @@ public:
   static void StopTiming(std::string const &fname, bool print=false,
     Teuchos::RCP<Epetra_Time> T=Teuchos::null);
 
+  //! return the id of a timer label, registering it if it was not seen
+  //! before. Ids are handed out in the order in which timers are first
+  //! used, which is also the order in the output of PrintTiming(). The
+  //! level is only used for the trace output.
+  static int RegisterTimer(std::string const &label, int level=-1);
+
+  //! label of a timer obtained from RegisterTimer()
+  static std::string const &TimerLabel(int id);
+
+  //! add a measurement to a registered timer. The counters are kept per
+  //! thread, so this does not need any locking.
+  static void AddTiming(int id, double elapsed);
+
+  //! start recording the begin and end of every timer in a ring buffer
+  //! per thread that holds the last capacity events of that thread
+  static void StartTrace(int capacity=1000000);
+
+  //! add a timer event to the trace if tracing was started
+  static void RecordTrace(int id, std::chrono::steady_clock::time_point start,
+    std::chrono::steady_clock::time_point end);
+
+  //! gather the traces of all processes and write them to a file in the
+  //! Chrome trace (JSON) format, which can be viewed in Perfetto or
+  //! chrome://tracing. Has to be called by all processes, outside of
+  //! parallel regions.
+  static void WriteTrace(std::string const &filename);
+
+  //! set the subdomain that the calling thread is working on, it is
+  //! stored with the events in the trace. Returns the previous value.
+  static int SetTraceSubdomain(int sd);
+
+  //! function tracing and check points when entering a timed function
+  static void EnterFunction(std::string const &fname);
+
+  //! function tracing when leaving a timed function
+  static void LeaveFunction(std::string const &fname);
+
   //! start memory profiling a specific part of the code
   static std::tuple<long long, long long> StartMemory(std::string const &label);
 
@@ -107,9 +147,17 @@ public:
   static bool GetCheckPoint(std::string function, std::string& msg,
     std::string& file, int& line);
 
-  //! print timing results
+  //! print timing results, followed by the number of workspace vectors
+  //! that were allocated (see CountWorkspaceAllocation())
   static void PrintTiming(std::ostream& os);
 
+  //! count the allocation of a workspace vector, e.g. by MultiVectorPool
+  static void CountWorkspaceAllocation();
+
+  //! total number of workspace vectors allocated by this process. This
+  //! should not change between repeated solves with the same preconditioner.
+  static long long NumWorkspaceAllocations();
+
   //! report memory usage
   static void PrintMemUsage(std::ostream& os);
 
@@ -126,12 +174,6 @@ private:
 
   static std::streambuf* rdbuf_bak;
 
-  //! parameter list for timing individual parts of the code
-  static Teuchos::ParameterList timerList_;
-
-  //! keeps track of timer numbers (to get the ordering correct)
-  static int timerCounter_;
-
   //! parameter list for setting breakpoints
   static Teuchos::ParameterList breakpointList_;
 
@@ -163,22 +205,105 @@ public:
 
   //!
   TimerObject(std::string const &s, bool print);
+  //! start a timer that was registered with Tools::RegisterTimer()
+  TimerObject(int id, bool print);
   //!
   virtual ~TimerObject();
 
 private:
   //!
-  std::string s_;
+  void Start();
+  //!
+  int id_;
   //!
   bool print_;
+  //! false if the I/O was not initialized when the timer was started
+  bool active_;
   //!
-  Teuchos::RCP<Epetra_Time> T_;
+  std::chrono::steady_clock::time_point start_;
   //!
   size_t memory_used_;
   //!
   size_t memory_allocated_;
   };
 
+//! sets the subdomain for the trace output of the calling thread
+//! in the current scope
+class TraceSubdomain
+  {
+public:
+
+  //!
+  TraceSubdomain(int sd) : previous_(Tools::SetTraceSubdomain(sd)) {}
+
+  //!
+  ~TraceSubdomain() {Tools::SetTraceSubdomain(previous_);}
+
+private:
+
+  //!
+  int previous_;
+  };
+
+//! Caches the timer ids of a single call site of the HYMLS_PROF macros,
+//! so that the timer label only has to be built and looked up the first
+//! time the call site is reached with a given label and level.
+class TimerSite
+  {
+public:
+
+  //!
+  TimerSite()
+    {
+    for (std::atomic<const Entry *> &entry : entries_)
+      {
+      entry.store(NULL, std::memory_order_relaxed);
+      }
+    }
+
+  //!
+  ~TimerSite();
+
+  //! timer id for the label "s1: s2", or "s1_L<level>: s2" if level>=0.
+  //! The ids are cached by the strings s1 and s2 and the level, so the
+  //! label may depend on the object, e.g. its label_.
+  template<typename S1, typename S2>
+  int Id(S1 const &s1, S2 const &s2, int level=-1)
+    {
+    return Find(CStr(s1), CStr(s2), level);
+    }
+
+private:
+
+  //! a cached label and its timer id, never changed after it is stored
+  struct Entry
+    {
+    std::string s1, s2;
+    int level;
+    int id;
+    };
+
+  //!
+  static const char *CStr(const char *s) {return s;}
+
+  //!
+  static const char *CStr(std::string const &s) {return s.c_str();}
+
+  //! look up the timer id, and register the timer and cache its id if
+  //! it is not there yet
+  int Find(const char *s1, const char *s2, int level);
+
+  //! register the timer for the label
+  static Entry *NewEntry(const char *s1, const char *s2, int level);
+
+  //! number of different labels that are cached for a call site. Labels
+  //! that do not fit take the slow path through Tools::RegisterTimer
+  static const int capacity_ = 32;
+
+  //! hash table of the cached labels, with linear probing
+  std::array<std::atomic<const Entry *>, capacity_> entries_;
+  };
+
   }
 
 #endif
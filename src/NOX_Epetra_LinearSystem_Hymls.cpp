@@ -197,6 +197,9 @@ createPreconditioner(const NOX::Epetra::Vector& x, Teuchos::ParameterList& p,
                      bool recomputeGraph) const
   {
   LinearSystemAztecOO::createPreconditioner(x,p,recomputeGraph);
+  // the recycled Krylov subspace was built with the old preconditioner
+  if (!hymls_->KeepRecycledSpace())
+    hymls_->ResetRecycledSpace();
   // setup deflation in the solver
   if (massMatrix_!=Teuchos::null)
     hymls_->SetMassMatrix(massMatrix_);
@@ -210,6 +213,9 @@ bool NOX::Epetra::LinearSystemHymls::
 recomputePreconditioner(const NOX::Epetra::Vector& x, Teuchos::ParameterList& p) const
   {
   LinearSystemAztecOO::recomputePreconditioner(x,p);
+  // the recycled Krylov subspace was built with the old preconditioner
+  if (!hymls_->KeepRecycledSpace())
+    hymls_->ResetRecycledSpace();
   // setup deflation in the solver
   if (massMatrix_!=Teuchos::null)
     hymls_->SetMassMatrix(massMatrix_);
@@ -88,6 +88,8 @@ bool status=true;
   Teuchos::RCP<HYMLS::Solver> solver = Teuchos::null;
   Teuchos::RCP<Epetra_CrsMatrix> M = Teuchos::null;
 
+  std::string trace_file = "";
+
   try {
 
   HYMLS_PROF("main","entire run");
@@ -135,6 +137,11 @@ bool status=true;
     double perturbation = driverList.get("Diagonal Perturbation",0.0);
     double diag_shift = driverList.get("Diagonal Shift",0.0);
     double diag_shift_i = driverList.get("Diagonal Shift (imag)",0.0);
+
+    // write a timeline of all timed functions in Chrome trace format
+    trace_file = driverList.get("Trace File","");
+    int trace_size = driverList.get("Trace Buffer Size",1000000);
+    if (trace_file!="") HYMLS::Tools::StartTrace(trace_size);
     
     std::string galeriLabel=driverList.get("Galeri Label","");
     Teuchos::ParameterList galeriList;
@@ -146,6 +153,7 @@ bool status=true;
     std::string datadir,file_format;
     bool have_rhs=false;
     bool have_exact_sol=false;
+    bool convert_binary=false;
     std::string nullSpaceType=driverList.get("Null Space Type","None");
     int dim0=0; // if the problem is read from a file, a null space can be read, too, with dim0 columns.
 
@@ -160,6 +168,9 @@ bool status=true;
                 __FILE__,__LINE__);
         }                
       file_format = driverList.get("File Format","MatrixMarket");
+      // write the system that was read to the "Binary" format, which
+      // is much faster to read in later runs
+      convert_binary = driverList.get("Convert To Binary",false);
       have_rhs = driverList.get("RHS Available",false);
       have_exact_sol = driverList.get("Exact Solution Available",false);
       if (nullSpaceType=="File") dim0=driverList.get("Null Space Dimension",0);
@@ -190,6 +201,10 @@ HYMLS::MatrixUtils::Dump(*map,"MainMatrixMap.txt");
   if (read_problem)
     {
     K=HYMLS::MainUtils::read_matrix(datadir,file_format,map);
+    if (convert_binary)
+      {
+      CHECK_ZERO(HYMLS::MainUtils::write_matrix(*K,datadir));
+      }
     }
   else
     {
@@ -244,10 +259,18 @@ HYMLS::MatrixUtils::Dump(*map,"MainMatrixMap.txt");
     if (have_exact_sol)
       {
       x_ex=HYMLS::MainUtils::read_vector("sol",datadir,file_format,map);
+      if (convert_binary)
+        {
+        CHECK_ZERO(HYMLS::MainUtils::write_vector(*(*x_ex)(0),"sol",datadir));
+        }
       }
     if (have_rhs)
       {
       b=HYMLS::MainUtils::read_vector("rhs",datadir,file_format,map);
+      if (convert_binary)
+        {
+        CHECK_ZERO(HYMLS::MainUtils::write_vector(*(*b)(0),"rhs",datadir));
+        }
       }
     else
       {
@@ -515,6 +538,12 @@ HYMLS_DEBVAR(*b);
   HYMLS::Tools::PrintTiming(HYMLS::Tools::out());
   HYMLS::Tools::PrintMemUsage(HYMLS::Tools::out());
 
+  if (trace_file!="")
+    {
+    HYMLS::Tools::WriteTrace(trace_file);
+    HYMLS::Tools::out() << "trace is written to file " << trace_file << std::endl;
+    }
+
   comm->Barrier();
 
   map = Teuchos::null;
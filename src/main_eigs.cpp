@@ -164,6 +164,7 @@ bool status=true;
     
     std::string datadir,file_format;
     bool have_massmatrix=false;
+    bool convert_binary=false;
 
     if (read_problem)
       {
@@ -174,6 +175,9 @@ bool status=true;
                 __FILE__,__LINE__);
         }                
       file_format = driverList.get("File Format","MatrixMarket");
+      // write the matrices that were read to the "Binary" format, which
+      // is much faster to read in later runs
+      convert_binary = driverList.get("Convert To Binary",false);
       have_massmatrix = driverList.get("Mass Matrix Available",false);
       if (nullSpaceType=="File")
         {
@@ -205,6 +209,10 @@ HYMLS::MatrixUtils::Dump(*map,"MainMatrixMap.txt");
   if (read_problem)
     {
      K=HYMLS::MainUtils::read_matrix(datadir,file_format,map);
+     if (convert_binary)
+       {
+       CHECK_ZERO(HYMLS::MainUtils::write_matrix(*K,datadir));
+       }
     }
   else
     {
@@ -244,6 +252,10 @@ HYMLS::MatrixUtils::Dump(*map,"MainMatrixMap.txt");
     if (have_massmatrix)
       {
       M = HYMLS::MainUtils::read_matrix(datadir, file_format, map, "mass");
+      if (convert_binary)
+        {
+        CHECK_ZERO(HYMLS::MainUtils::write_matrix(*M, datadir, "mass"));
+        }
       }
     else
       {
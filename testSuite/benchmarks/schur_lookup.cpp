@@ -0,0 +1,232 @@
+// Micro-benchmark for filling the dense separator blocks in
+// SchurComplement::Construct11/Construct22: compares the original
+// linear search over the separator GIDs with the column position
+// table stored in the MatrixBlock.
+//
+// usage: schur_lookup <parameter_filename> [number of repetitions]
+
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include <mpi.h>
+
+#include "HYMLS_config.h"
+
+#include "Epetra_MpiComm.h"
+#include "Epetra_Map.h"
+#include "Epetra_Vector.h"
+#include "Epetra_CrsMatrix.h"
+#include "Epetra_SerialDenseMatrix.h"
+#include "Epetra_Time.h"
+
+#include "Teuchos_RCP.hpp"
+#include "Teuchos_ParameterList.hpp"
+#include "Teuchos_XMLParameterListHelpers.hpp"
+#include "Teuchos_StandardCatchMacros.hpp"
+
+#include "HYMLS_Macros.hpp"
+#include "HYMLS_HyperCube.hpp"
+#include "HYMLS_Tools.hpp"
+#include "HYMLS_MainUtils.hpp"
+#include "HYMLS_MatrixBlock.hpp"
+#include "HYMLS_OverlappingPartitioner.hpp"
+#include "HYMLS_Preconditioner.hpp"
+
+namespace {
+
+//! Gives access to the matrix blocks of the preconditioner
+class BenchmarkPreconditioner : public HYMLS::Preconditioner
+  {
+public:
+
+  BenchmarkPreconditioner(Teuchos::RCP<const Epetra_RowMatrix> K,
+    Teuchos::RCP<Teuchos::ParameterList> params,
+    Teuchos::RCP<Epetra_Vector> testVector)
+    :
+    HYMLS::Preconditioner(K, params, testVector)
+    {}
+
+  HYMLS::MatrixBlock const &A12() const {return *A12_;}
+
+  HYMLS::MatrixBlock const &A22() const {return *A22_;}
+  };
+
+//! Fill the dense block of A into S by searching for every column GID
+//! in the row map of R (the implementation before the lookup table)
+double FillBySearch(Epetra_CrsMatrix const &A, Epetra_CrsMatrix const &R,
+  Epetra_SerialDenseMatrix &S)
+  {
+  int nrows = R.NumMyRows();
+
+  // look up the row GIDs only once, so we only measure the search
+  std::vector<hymls_gidx> rowGIDs(nrows);
+  for (int j = 0; j < nrows; j++)
+    {
+    rowGIDs[j] = R.GRID64(j);
+    }
+
+  int len;
+  int *indices;
+  double *values;
+  for (int i = 0; i < A.NumMyRows(); i++)
+    {
+    CHECK_ZERO(A.ExtractMyRowView(i, len, values, indices));
+    for (int k = 0; k < len; k++)
+      {
+      const hymls_gidx gcid = A.GCID64(indices[k]);
+      for (int j = 0; j < nrows; j++)
+        {
+        if (gcid == rowGIDs[j])
+          {
+          S(i, j) = values[k];
+          break;
+          }
+        }
+      }
+    }
+  return S.NormOne();
+  }
+
+//! Fill the dense block of A into S using the column position table
+double FillByTable(Epetra_CrsMatrix const &A, Teuchos::Array<int> const &table,
+  Epetra_SerialDenseMatrix &S)
+  {
+  int len;
+  int *indices;
+  double *values;
+  for (int i = 0; i < A.NumMyRows(); i++)
+    {
+    CHECK_ZERO(A.ExtractMyRowView(i, len, values, indices));
+    for (int k = 0; k < len; k++)
+      {
+      const int j = table[indices[k]];
+      if (j >= 0)
+        {
+        S(i, j) = values[k];
+        }
+      }
+    }
+  return S.NormOne();
+  }
+
+  }
+
+int main(int argc, char* argv[])
+  {
+  MPI_Init(&argc, &argv);
+
+  bool status = true;
+
+  HYMLS::HyperCube Topology;
+  Teuchos::RCP<const Epetra_MpiComm> comm = Teuchos::rcp(&Topology.Comm(), false);
+
+  HYMLS::Tools::InitializeIO(comm);
+
+  try
+    {
+    if (argc < 2)
+      {
+      HYMLS::Tools::Out("USAGE: schur_lookup <parameter_filename> [repetitions]");
+      MPI_Finalize();
+      return 0;
+      }
+
+    std::string param_file = argv[1];
+    int repetitions = argc > 2 ? std::atoi(argv[2]) : 10;
+
+    Teuchos::RCP<Teuchos::ParameterList> params =
+      Teuchos::getParametersFromXmlFile(param_file);
+
+    Teuchos::ParameterList driverList = params->sublist("Driver");
+    params->remove("Driver");
+
+    Teuchos::RCP<Epetra_Map> map = HYMLS::MainUtils::create_map(*comm, params);
+
+    Teuchos::ParameterList probl_params = params->sublist("Problem");
+    Teuchos::RCP<Epetra_CrsMatrix> K;
+    if (driverList.get("Read Linear System", false))
+      {
+      K = HYMLS::MainUtils::read_matrix(driverList.get("Data Directory", "."),
+        driverList.get("File Format", "MatrixMarket"), map);
+      }
+    else
+      {
+      Teuchos::ParameterList galeriList;
+      if (driverList.isSublist("Galeri")) galeriList = driverList.sublist("Galeri");
+      K = HYMLS::MainUtils::create_matrix(*map, probl_params,
+        driverList.get("Galeri Label", ""), galeriList);
+      }
+
+    Teuchos::RCP<Epetra_Vector> testvector =
+      HYMLS::MainUtils::create_testvector(probl_params, *K);
+
+    BenchmarkPreconditioner prec(K, params, testvector);
+    CHECK_ZERO(prec.Initialize());
+    CHECK_ZERO(prec.Compute());
+
+    int num_sd = prec.A22().Partitioner().NumMySubdomains();
+
+    Epetra_SerialDenseMatrix S;
+    Epetra_Time timer(*comm);
+    double t_search = 0.0, t_table = 0.0;
+    double check_search = 0.0, check_table = 0.0;
+
+    for (int r = 0; r < repetitions; r++)
+      {
+      for (int sd = 0; sd < num_sd; sd++)
+        {
+        Epetra_CrsMatrix const &A12 = *prec.A12().SubBlock(sd);
+        Epetra_CrsMatrix const &A22 = *prec.A22().SubBlock(sd);
+        int nsep = A22.NumMyRows();
+
+        // A11 right-hand sides
+        CHECK_ZERO(S.Shape(A12.NumMyRows(), nsep));
+        timer.ResetStartTime();
+        check_search += FillBySearch(A12, A22, S);
+        t_search += timer.ElapsedTime();
+
+        CHECK_ZERO(S.Shape(A12.NumMyRows(), nsep));
+        timer.ResetStartTime();
+        check_table += FillByTable(A12, prec.A12().SubBlockColumnPositions(sd), S);
+        t_table += timer.ElapsedTime();
+
+        // A22 contribution
+        CHECK_ZERO(S.Shape(nsep, nsep));
+        timer.ResetStartTime();
+        check_search += FillBySearch(A22, A22, S);
+        t_search += timer.ElapsedTime();
+
+        CHECK_ZERO(S.Shape(nsep, nsep));
+        timer.ResetStartTime();
+        check_table += FillByTable(A22, prec.A22().SubBlockColumnPositions(sd), S);
+        t_table += timer.ElapsedTime();
+        }
+      }
+
+    double t_max;
+    comm->MaxAll(&t_search, &t_max, 1);
+    t_search = t_max;
+    comm->MaxAll(&t_table, &t_max, 1);
+    t_table = t_max;
+
+    HYMLS::Tools::out() << "subdomains on proc 0: " << num_sd
+                        << ", repetitions: " << repetitions << std::endl;
+    HYMLS::Tools::out() << "linear search: " << t_search << " s" << std::endl;
+    HYMLS::Tools::out() << "lookup table:  " << t_table << " s" << std::endl;
+    HYMLS::Tools::out() << "speedup:       " << t_search / t_table << std::endl;
+
+    if (check_search != check_table)
+      {
+      HYMLS::Tools::Warning("lookup table gives different results than the linear search",
+        __FILE__, __LINE__);
+      status = false;
+      }
+    }
+  TEUCHOS_STANDARD_CATCH_STATEMENTS(true, std::cerr, status);
+
+  HYMLS::Tools::PrintTiming(HYMLS::Tools::out());
+
+  MPI_Finalize();
+  return status ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
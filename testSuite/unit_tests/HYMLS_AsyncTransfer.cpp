@@ -0,0 +1,64 @@
+#include "HYMLS_AsyncTransfer.hpp"
+
+#include "Epetra_MpiComm.h"
+#include "Epetra_Map.h"
+#include "Epetra_Import.h"
+#include "Epetra_MultiVector.h"
+
+#include "Teuchos_Array.hpp"
+
+#include <stdexcept>
+
+#include "HYMLS_UnitTests.hpp"
+
+TEUCHOS_UNIT_TEST(AsyncTransfer, GuardFinishesPendingTransfer)
+  {
+  Epetra_MpiComm Comm(MPI_COMM_WORLD);
+
+  // every process also needs the first row of the next process
+  Epetra_Map map(-1, 4, 0, Comm);
+  int numGlobal = map.NumGlobalElements();
+  Teuchos::Array<int> gids;
+  for (int i = 0; i < map.NumMyElements(); i++)
+    {
+    gids.push_back(map.GID(i));
+    }
+  if (Comm.NumProc() > 1)
+    {
+    gids.push_back((map.MaxMyGID() + 1) % numGlobal);
+    }
+  Epetra_Map overlappingMap(-1, gids.size(), &gids[0], 0, Comm);
+  Epetra_Import import(overlappingMap, map);
+
+  Epetra_MultiVector source(map, 2);
+  source.Random();
+  Epetra_MultiVector expected(overlappingMap, 2);
+  TEST_EQUALITY(expected.Import(source, import, Insert), 0);
+
+  HYMLS::AsyncTransfer transfer;
+  Epetra_MultiVector target(overlappingMap, 2);
+
+  // an exception between the Post and the Wait() does not leave the
+  // transfer pending, and the values are still received
+  bool caught = false;
+  try
+    {
+    HYMLS::AsyncTransferGuard guard(transfer);
+    TEST_EQUALITY(transfer.PostImport(source, target, import), 0);
+    TEST_EQUALITY(transfer.Pending(), true);
+    throw std::runtime_error("failure while the transfer is pending");
+    }
+  catch (std::runtime_error const &)
+    {
+    caught = true;
+    }
+  TEST_EQUALITY(caught, true);
+  TEST_EQUALITY(transfer.Pending(), false);
+  TEST_EQUALITY(HYMLS::UnitTests::NormInfAminusB(target, expected), 0.0);
+
+  // so the transfer can be used again
+  target.PutScalar(0.0);
+  TEST_EQUALITY(transfer.PostImport(source, target, import), 0);
+  TEST_EQUALITY(transfer.Wait(), 0);
+  TEST_EQUALITY(HYMLS::UnitTests::NormInfAminusB(target, expected), 0.0);
+  }
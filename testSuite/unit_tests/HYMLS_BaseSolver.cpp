@@ -0,0 +1,141 @@
+#include "HYMLS_BaseSolver.hpp"
+
+#include <Teuchos_RCP.hpp>
+#include <Teuchos_ParameterList.hpp>
+
+#include <Epetra_MpiComm.h>
+#include <Epetra_Map.h>
+#include <Epetra_MultiVector.h>
+#include <Epetra_CrsMatrix.h>
+
+#include "HYMLS_Macros.hpp"
+
+#include "HYMLS_UnitTests.hpp"
+
+#include <cmath>
+
+namespace {
+
+//! nonsymmetric tridiagonal matrix of a 1D convection-diffusion problem
+Teuchos::RCP<Epetra_CrsMatrix> createConvDiffMatrix(Epetra_Map const &map,
+  double diagonal = 3.0)
+  {
+  Teuchos::RCP<Epetra_CrsMatrix> A = Teuchos::rcp(new Epetra_CrsMatrix(Copy, map, 3));
+  for (int i = 0; i < map.NumMyElements(); i++)
+    {
+    hymls_gidx gid = map.GID64(i);
+    hymls_gidx indices[3] = {gid - 1, gid, gid + 1};
+    double values[3] = {-1.3, diagonal, -0.7};
+    if (gid == 0)
+      {
+      CHECK_ZERO(A->InsertGlobalValues(gid, 2, values + 1, indices + 1));
+      }
+    else if (gid == map.MaxAllGID64())
+      {
+      CHECK_ZERO(A->InsertGlobalValues(gid, 2, values, indices));
+      }
+    else
+      {
+      CHECK_ZERO(A->InsertGlobalValues(gid, 3, values, indices));
+      }
+    }
+  CHECK_ZERO(A->FillComplete());
+  return A;
+  }
+
+Teuchos::RCP<Teuchos::ParameterList> createParameterList(std::string const &method)
+  {
+  Teuchos::RCP<Teuchos::ParameterList> params = Teuchos::rcp(new Teuchos::ParameterList());
+  params->sublist("Problem").set("Dimension", 1);
+  params->sublist("Problem").set("Degrees of Freedom", 1);
+
+  Teuchos::ParameterList &solverList = params->sublist("Solver");
+  solverList.set("Krylov Method", method);
+  solverList.set("Initial Vector", "Zero");
+
+  Teuchos::ParameterList &belosList = solverList.sublist("Iterative Solver");
+  belosList.set("Convergence Tolerance", 1e-10);
+  belosList.set("Maximum Iterations", 1000);
+  // small enough to restart a few times
+  belosList.set("Num Blocks", 10);
+  return params;
+  }
+
+  }
+
+TEUCHOS_UNIT_TEST(BaseSolver, PipelinedGMRES)
+  {
+  Epetra_MpiComm Comm(MPI_COMM_WORLD);
+  DISABLE_OUTPUT;
+
+  Epetra_Map map((hymls_gidx)200, 0, Comm);
+  Teuchos::RCP<Epetra_CrsMatrix> A = createConvDiffMatrix(map);
+
+  Epetra_MultiVector X_EX(map, 2);
+  Epetra_MultiVector X(map, 2);
+  Epetra_MultiVector B(map, 2);
+  X_EX.Random();
+  CHECK_ZERO(A->Multiply(false, X_EX, B));
+
+  HYMLS::BaseSolver solver(A, Teuchos::null, createParameterList("Pipelined GMRES"));
+  int ierr = solver.ApplyInverse(B, X);
+  TEST_EQUALITY(ierr, 0);
+  TEST_COMPARE(HYMLS::UnitTests::NormInfAminusB(X, X_EX), <, 1e-8);
+
+  // In exact arithmetic we get the same iterates as with standard GMRES
+  Epetra_MultiVector B1(View, B, 0, 1);
+  Epetra_MultiVector X1(View, X, 0, 1);
+  ierr = solver.ApplyInverse(B1, X1);
+  TEST_EQUALITY(ierr, 0);
+
+  HYMLS::BaseSolver gmres(A, Teuchos::null, createParameterList("GMRES"));
+  ierr = gmres.ApplyInverse(B1, X1);
+  TEST_EQUALITY(ierr, 0);
+  TEST_COMPARE(std::abs(solver.getNumIter() - gmres.getNumIter()), <=, 2);
+  }
+
+TEUCHOS_UNIT_TEST(BaseSolver, GCRODR)
+  {
+  Epetra_MpiComm Comm(MPI_COMM_WORLD);
+  DISABLE_OUTPUT;
+
+  Epetra_Map map((hymls_gidx)200, 0, Comm);
+  Teuchos::RCP<Epetra_CrsMatrix> A = createConvDiffMatrix(map, 2.2);
+
+  Teuchos::RCP<Teuchos::ParameterList> params = createParameterList("GCRODR");
+  Teuchos::ParameterList &belosList =
+    params->sublist("Solver").sublist("Iterative Solver");
+  belosList.set("Num Blocks", 20);
+  belosList.set("Num Recycled Blocks", 5);
+
+  HYMLS::BaseSolver solver(A, Teuchos::null, params);
+
+  Epetra_MultiVector X_EX(map, 1);
+  Epetra_MultiVector X(map, 1);
+  Epetra_MultiVector B(map, 1);
+  X_EX.Random();
+  CHECK_ZERO(A->Multiply(false, X_EX, B));
+
+  int ierr = solver.ApplyInverse(B, X);
+  TEST_EQUALITY(ierr, 0);
+  TEST_COMPARE(HYMLS::UnitTests::NormInfAminusB(X, X_EX), <, 1e-8);
+  int firstIter = solver.getNumIter();
+
+  // a nearby system is solved faster with the recycled space
+  CHECK_ZERO(A->Scale(1.01));
+  X_EX.Random();
+  CHECK_ZERO(A->Multiply(false, X_EX, B));
+
+  ierr = solver.ApplyInverse(B, X);
+  TEST_EQUALITY(ierr, 0);
+  TEST_COMPARE(HYMLS::UnitTests::NormInfAminusB(X, X_EX), <, 1e-8);
+  int recycledIter = solver.getNumIter();
+  TEST_COMPARE(recycledIter, <, firstIter);
+
+  // but not after discarding it
+  solver.ResetRecycledSpace();
+  ierr = solver.ApplyInverse(B, X);
+  TEST_EQUALITY(ierr, 0);
+  TEST_COMPARE(HYMLS::UnitTests::NormInfAminusB(X, X_EX), <, 1e-8);
+  TEST_COMPARE(solver.getNumIter(), >, recycledIter);
+  }
@@ -0,0 +1,150 @@
+#include "HYMLS_BatchedDenseSolver.hpp"
+
+#include "HYMLS_Macros.hpp"
+
+#include "Epetra_MpiComm.h"
+#include "Epetra_Map.h"
+#include "Epetra_MultiVector.h"
+#include "Epetra_CrsMatrix.h"
+
+#include "Teuchos_Array.hpp"
+
+#include <cmath>
+
+#include "HYMLS_UnitTests.hpp"
+
+TEUCHOS_UNIT_TEST(BatchedDenseSolver, ApplyInverse)
+  {
+  Epetra_MpiComm Comm(MPI_COMM_WORLD);
+
+  // blocks of different sizes, with more blocks of size 3 than fit in a batch
+  int sizes[] = {3, 3, 3, 1, 5, 3, 2};
+  int numBlocks = 7;
+  Teuchos::Array<int> blockPtr(numBlocks + 1, 0);
+  for (int blk = 0; blk < numBlocks; blk++)
+    {
+    blockPtr[blk + 1] = blockPtr[blk] + sizes[blk];
+    }
+  int n = blockPtr[numBlocks];
+
+  // the rows of the blocks are scattered over the local rows
+  Teuchos::Array<int> rows(n);
+  for (int i = 0; i < n; i++)
+    {
+    rows[i] = (7 * i) % n;
+    }
+
+  Epetra_Map map(-1, n, 0, Comm);
+  Epetra_CrsMatrix A(Copy, map, 6);
+  Epetra_CrsMatrix Afull(Copy, map, 7);
+  for (int blk = 0; blk < numBlocks; blk++)
+    {
+    for (int i = blockPtr[blk]; i < blockPtr[blk + 1]; i++)
+      {
+      int grid = map.GID(rows[i]);
+      for (int j = blockPtr[blk]; j < blockPtr[blk + 1]; j++)
+        {
+        int gcid = map.GID(rows[j]);
+        // a zero diagonal in the first block to test the pivoting
+        double value = (blk == 0 && i == j) ? 0.0 : std::sin(1.0 + 3 * i + 7 * j);
+        CHECK_ZERO(A.InsertGlobalValues(grid, 1, &value, &gcid));
+        CHECK_ZERO(Afull.InsertGlobalValues(grid, 1, &value, &gcid));
+        }
+      // entries outside the blocks should be ignored
+      int gcid = map.GID(rows[(blockPtr[blk + 1]) % n]);
+      double value = 100.0;
+      CHECK_ZERO(Afull.InsertGlobalValues(grid, 1, &value, &gcid));
+      }
+    }
+  CHECK_ZERO(A.FillComplete());
+  CHECK_ZERO(Afull.FillComplete());
+
+  HYMLS::BatchedDenseSolver solver(2);
+  CHECK_ZERO(solver.Initialize(numBlocks, &blockPtr[0], &rows[0]));
+  TEST_EQUALITY(solver.NumBlocks(), numBlocks);
+  TEST_EQUALITY(solver.NumBatches(), 5);
+  CHECK_ZERO(solver.Compute(Afull));
+
+  Epetra_MultiVector X_EX(map, 3);
+  Epetra_MultiVector X(map, 3);
+  Epetra_MultiVector B(map, 3);
+  X_EX.Random();
+  CHECK_ZERO(A.Multiply(false, X_EX, B));
+
+  CHECK_ZERO(solver.ApplyInverse(B, X));
+  TEST_COMPARE(HYMLS::UnitTests::NormInfAminusB(X, X_EX), <, 1e-10);
+
+  // solving in place should give the same result
+  CHECK_ZERO(solver.ApplyInverse(B, B));
+  TEST_COMPARE(HYMLS::UnitTests::NormInfAminusB(B, X_EX), <, 1e-10);
+
+  // and so should solving one block at a time, which is counted as well
+  double flops = solver.ApplyInverseFlops();
+  CHECK_ZERO(A.Multiply(false, X_EX, B));
+  for (int blk = 0; blk < numBlocks; blk++)
+    {
+    int nrows = solver.NumRows(blk);
+    TEST_EQUALITY(nrows, sizes[blk]);
+
+    Teuchos::Array<double> x(nrows * 3);
+    for (int k = 0; k < 3; k++)
+      {
+      for (int i = 0; i < nrows; i++)
+        {
+        x[i + k * nrows] = B[k][rows[blockPtr[blk] + i]];
+        }
+      }
+    CHECK_ZERO(solver.ApplyInverse(blk, 3, &x[0], nrows));
+    for (int k = 0; k < 3; k++)
+      {
+      for (int i = 0; i < nrows; i++)
+        {
+        TEST_COMPARE(std::abs(x[i + k * nrows] - X_EX[k][rows[blockPtr[blk] + i]]), <, 1e-10);
+        }
+      }
+    }
+  TEST_COMPARE(solver.ApplyInverseFlops(), >, flops);
+  }
+
+TEUCHOS_UNIT_TEST(BatchedDenseSolver, SingularBlock)
+  {
+  DISABLE_OUTPUT;
+  Epetra_MpiComm Comm(MPI_COMM_WORLD);
+
+  // three blocks of size 2 in two batches, block 1 is zero
+  int numBlocks = 3;
+  int blockPtr[] = {0, 2, 4, 6};
+  int rows[] = {0, 1, 2, 3, 4, 5};
+
+  Epetra_Map map(-1, 6, 0, Comm);
+  Epetra_CrsMatrix A(Copy, map, 2);
+  for (int blk = 0; blk < numBlocks; blk++)
+    {
+    for (int i = blockPtr[blk]; i < blockPtr[blk + 1]; i++)
+      {
+      int grid = map.GID(rows[i]);
+      for (int j = blockPtr[blk]; j < blockPtr[blk + 1]; j++)
+        {
+        int gcid = map.GID(rows[j]);
+        double value = blk == 1 ? 0.0 : (i == j ? 2.0 : 1.0);
+        CHECK_ZERO(A.InsertGlobalValues(grid, 1, &value, &gcid));
+        }
+      }
+    }
+  CHECK_ZERO(A.FillComplete());
+
+  HYMLS::BatchedDenseSolver solver(2);
+  CHECK_ZERO(solver.Initialize(numBlocks, blockPtr, rows));
+  TEST_COMPARE(solver.Compute(A), >, 0);
+  TEST_EQUALITY(solver.SingularBlock(), 1);
+  TEST_ASSERT(!solver.IsComputed());
+
+  // all batches were factored
+  TEST_FLOATING_EQUALITY(solver.ComputeFlops(), 2.0 / 3.0 * 8 * 3, 1e-12);
+
+  Epetra_MultiVector X(map, 1);
+  Epetra_MultiVector B(map, 1);
+  B.PutScalar(1.0);
+  TEST_INEQUALITY(solver.ApplyInverse(B, X), 0);
+  TEST_INEQUALITY(solver.ApplyInverse(0, 1, X[0], 2), 0);
+  }
@@ -13,6 +13,7 @@
 #include <Epetra_SerialDenseMatrix.h>
 
 #include "HYMLS_DenseUtils.hpp"
+#include "HYMLS_Exception.hpp"
 #include "HYMLS_Preconditioner.hpp"
 
 #include "Galeri_CrsMatrices.h"
@@ -105,3 +106,19 @@ TEUCHOS_UNIT_TEST(BorderedSolver, BorderedApplyInverse)
   TEST_COMPARE(HYMLS::UnitTests::NormInfAminusB(*X, *X_EX), <, 1e-10);
   TEST_COMPARE(HYMLS::UnitTests::NormInfAminusB(*X2, *X_EX2), <, 1e-10);
   }
+
+TEUCHOS_UNIT_TEST(BorderedSolver, UnsupportedKrylovMethod)
+  {
+  Teuchos::RCP<Epetra_MpiComm> comm = Teuchos::rcp(new Epetra_MpiComm(MPI_COMM_WORLD));
+  DISABLE_OUTPUT;
+
+  Teuchos::RCP<Teuchos::ParameterList> params = HYMLS::UnitTests::CreateTestParameterList();
+  Teuchos::RCP<Epetra_CrsMatrix> A = HYMLS::UnitTests::CreateTestMatrix(params, *comm);
+
+  // Pipelined GMRES and GCRODR are only used with Epetra vectors
+  params->sublist("Solver").set("Krylov Method", "Pipelined GMRES");
+  TEST_THROW(HYMLS::BorderedSolver solver(A, Teuchos::null, params), HYMLS::Exception);
+
+  params->sublist("Solver").set("Krylov Method", "GCRODR");
+  TEST_THROW(HYMLS::BorderedSolver solver(A, Teuchos::null, params), HYMLS::Exception);
+  }
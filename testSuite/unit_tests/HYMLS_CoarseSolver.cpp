@@ -6,6 +6,7 @@
 #include <Epetra_MpiComm.h>
 #include <Epetra_Map.h>
 #include <Epetra_MultiVector.h>
+#include <Epetra_Vector.h>
 #include <Epetra_CrsMatrix.h>
 #include <Epetra_SerialDenseMatrix.h>
 
@@ -14,8 +15,7 @@
 
 #include "HYMLS_UnitTests.hpp"
 
-Teuchos::RCP<HYMLS::CoarseSolver> createCoarseSolver(
-  Teuchos::RCP<Teuchos::ParameterList> &params,
+Teuchos::RCP<Epetra_CrsMatrix> createCoarseMatrix(
   Teuchos::RCP<Epetra_Comm> const &comm)
   {
   Teuchos::RCP<Epetra_Map> map = Teuchos::rcp(new Epetra_Map((hymls_gidx)100, 0, *comm));
@@ -35,7 +35,14 @@ Teuchos::RCP<HYMLS::CoarseSolver> createCoarseSolver(
     CHECK_ZERO(A->InsertGlobalValues(i, 1, &A_val2, &i));
   }
   CHECK_ZERO(A->FillComplete());
+  return A;
+  }
 
+Teuchos::RCP<HYMLS::CoarseSolver> createCoarseSolver(
+  Teuchos::RCP<Teuchos::ParameterList> &params,
+  Teuchos::RCP<Epetra_Comm> const &comm)
+  {
+  Teuchos::RCP<Epetra_CrsMatrix> A = createCoarseMatrix(comm);
   Teuchos::RCP<HYMLS::CoarseSolver> solver = Teuchos::rcp(new HYMLS::CoarseSolver(A, 0));
   solver->SetParameters(*params);
 
@@ -123,3 +130,41 @@ TEUCHOS_UNIT_TEST(CoarseSolver, BorderedApplyInverse)
   TEST_COMPARE(HYMLS::UnitTests::NormInfAminusB(*X, *X_EX), <, 1e-10);
   TEST_COMPARE(HYMLS::UnitTests::NormInfAminusB(*X2, *X_EX2), <, 1e-10);
   }
+
+TEUCHOS_UNIT_TEST(CoarseSolver, ReuseSymbolicFactorization)
+  {
+  Teuchos::RCP<Epetra_MpiComm> comm = Teuchos::rcp(new Epetra_MpiComm(MPI_COMM_WORLD));
+  DISABLE_OUTPUT;
+
+  Teuchos::RCP<Teuchos::ParameterList> params = Teuchos::rcp(new Teuchos::ParameterList());
+  params->sublist("Coarse Solver").set("Reuse Symbolic Factorization", true);
+  Teuchos::RCP<HYMLS::CoarseSolver> solver = createCoarseSolver(params, comm);
+  TEST_EQUALITY(solver->Initialize(), 0);
+  TEST_EQUALITY(solver->Compute(), 0);
+
+  // a new matrix with the same pattern but different values
+  Teuchos::RCP<Epetra_CrsMatrix> A = createCoarseMatrix(comm);
+  Epetra_Vector scaling(A->RowMap());
+  scaling.Random();
+  for (int i = 0; i < scaling.MyLength(); i++)
+    {
+    scaling[i] = 2.0 + scaling[i];
+    }
+  CHECK_ZERO(A->LeftScale(scaling));
+
+  solver->SetMatrix(A);
+  TEST_EQUALITY(solver->Initialize(), 0);
+  TEST_EQUALITY(solver->Compute(), 0);
+
+  Epetra_Map const &map = solver->OperatorRangeMap();
+
+  Epetra_MultiVector X(map, 2);
+  Epetra_MultiVector X_EX(map, 2);
+  X_EX.Random();
+
+  Epetra_MultiVector B(map, 2);
+  TEST_EQUALITY(A->Multiply(false, X_EX, B), 0);
+
+  TEST_EQUALITY(solver->ApplyInverse(B, X), 0);
+  TEST_COMPARE(HYMLS::UnitTests::NormInfAminusB(X, X_EX), <, 1e-10);
+  }
@@ -0,0 +1,157 @@
+#include "HYMLS_Householder.hpp"
+#include "HYMLS_Macros.hpp"
+
+#include "Epetra_SerialComm.h"
+#include "Epetra_Map.h"
+#include "Epetra_CrsMatrix.h"
+#include "Epetra_MultiVector.h"
+#include "Epetra_SerialDenseVector.h"
+#ifdef HYMLS_LONG_LONG
+#include "Epetra_LongLongSerialDenseVector.h"
+#else
+#include "Epetra_IntSerialDenseVector.h"
+#endif
+
+#include "HYMLS_UnitTests.hpp"
+
+#include <cmath>
+#include <map>
+
+namespace {
+
+// two contiguous groups, a non-contiguous one and some rows that are in
+// no group at all. Both the sparse and the compact form are constructed.
+Teuchos::Array<Teuchos::Array<int> > CreateGroups(HYMLS::Householder const &OT,
+  Epetra_CrsMatrix &T, Teuchos::Array<int> &groupPtr, Teuchos::Array<int> &lids,
+  Teuchos::Array<double> &W)
+  {
+  Teuchos::Array<Teuchos::Array<int> > groups(3);
+  groups[0] = Teuchos::tuple(0, 1, 2, 3);
+  groups[1] = Teuchos::tuple(5, 6, 7);
+  groups[2] = Teuchos::tuple(8, 10, 11);
+
+  groupPtr.assign(1, 0);
+  lids.clear();
+  W.clear();
+  for (auto const &group : groups)
+    {
+    int len = group.size();
+#ifdef HYMLS_LONG_LONG
+    Epetra_LongLongSerialDenseVector inds(len);
+#else
+    Epetra_IntSerialDenseVector inds(len);
+#endif
+    Epetra_SerialDenseVector vec(len), w;
+    for (int i = 0; i < len; i++)
+      {
+      inds[i] = group[i];
+      vec[i] = 1.0 + 0.1 * group[i];
+      }
+    CHECK_ZERO(OT.Construct(T, inds, vec));
+    CHECK_ZERO(OT.Construct(w, vec));
+    for (int i = 0; i < len; i++)
+      {
+      lids.append(group[i]);
+      W.append(w[i]);
+      }
+    groupPtr.append(lids.size());
+    }
+  CHECK_ZERO(T.FillComplete());
+  return groups;
+  }
+
+  }
+
+TEUCHOS_UNIT_TEST(Householder, GroupedApply)
+  {
+  Epetra_SerialComm comm;
+  int n = 12;
+  Epetra_Map map(n, 0, comm);
+
+  HYMLS::Householder OT;
+
+  Epetra_CrsMatrix T(Copy, map, 4);
+  Teuchos::Array<int> groupPtr, lids;
+  Teuchos::Array<double> W;
+  Teuchos::Array<Teuchos::Array<int> > groups =
+    CreateGroups(OT, T, groupPtr, lids, W);
+
+  Epetra_MultiVector v(map, 3);
+  CHECK_ZERO(v.Random());
+
+  Epetra_MultiVector Tv(map, 3);
+  CHECK_ZERO(OT.Apply(Tv, T, v));
+
+  Epetra_MultiVector Tv2(v);
+  CHECK_ZERO(OT.Apply(Tv2, groups.size(), groupPtr.getRawPtr(),
+      lids.getRawPtr(), W.getRawPtr()));
+
+  TEST_COMPARE(HYMLS::UnitTests::NormInfAminusB(Tv, Tv2), <, 1e-12);
+
+  // the transform is its own inverse
+  CHECK_ZERO(OT.ApplyInverse(Tv2, groups.size(), groupPtr.getRawPtr(),
+      lids.getRawPtr(), W.getRawPtr()));
+  TEST_COMPARE(HYMLS::UnitTests::NormInfAminusB(Tv2, v), <, 1e-12);
+
+  // the test vector is mapped onto the first entry of each group
+  Epetra_MultiVector t(map, 1);
+  for (auto const &group : groups)
+    for (int i : group)
+      t[0][i] = 1.0 + 0.1 * i;
+  CHECK_ZERO(OT.Apply(t, groups.size(), groupPtr.getRawPtr(),
+      lids.getRawPtr(), W.getRawPtr()));
+  for (auto const &group : groups)
+    for (int i = 1; i < group.size(); i++)
+      TEST_COMPARE(std::abs(t[0][group[i]]), <, 1e-12);
+  }
+
+TEUCHOS_UNIT_TEST(Householder, GroupedMatrixApply)
+  {
+  Epetra_SerialComm comm;
+  int n = 12;
+  Epetra_Map map(n, 0, comm);
+
+  HYMLS::Householder OT;
+
+  Epetra_CrsMatrix T(Copy, map, 4);
+  Teuchos::Array<int> groupPtr, lids;
+  Teuchos::Array<double> W;
+  Teuchos::Array<Teuchos::Array<int> > groups =
+    CreateGroups(OT, T, groupPtr, lids, W);
+
+  // nonsymmetric matrix with a pattern that is different for the rows
+  // within a group
+  Epetra_CrsMatrix A(Copy, map, 4);
+  for (int i = 0; i < n; i++)
+    {
+    std::map<int, double> row;
+    row[i] += 4.0 + i;
+    row[(i + 1) % n] += -1.0;
+    row[(3 * i + 2) % n] += 0.5 - 0.1 * i;
+    row[(i + 7) % n] += 0.25 * i;
+    for (auto const &entry : row)
+      {
+      int col = entry.first;
+      double val = entry.second;
+      CHECK_ZERO(A.InsertGlobalValues(i, 1, &val, &col));
+      }
+    }
+  CHECK_ZERO(A.FillComplete());
+
+  Teuchos::RCP<Epetra_CrsMatrix> TAT = OT.Apply(T, A);
+  Teuchos::RCP<Epetra_CrsMatrix> HAH = OT.Apply(A, groups.size(),
+    groupPtr.getRawPtr(), lids.getRawPtr(), W.getRawPtr());
+
+  TEST_EQUALITY(HAH->RowMap().SameAs(map), true);
+
+  // compare the matrices by their action on some random vectors
+  Epetra_MultiVector x(map, 3), y1(map, 3), y2(map, 3);
+  CHECK_ZERO(x.Random());
+  CHECK_ZERO(TAT->Multiply(false, x, y1));
+  CHECK_ZERO(HAH->Multiply(false, x, y2));
+  TEST_COMPARE(HYMLS::UnitTests::NormInfAminusB(y1, y2), <, 1e-12);
+
+  CHECK_ZERO(TAT->Multiply(true, x, y1));
+  CHECK_ZERO(HAH->Multiply(true, x, y2));
+  TEST_COMPARE(HYMLS::UnitTests::NormInfAminusB(y1, y2), <, 1e-12);
+  }
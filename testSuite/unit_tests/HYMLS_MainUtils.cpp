@@ -0,0 +1,167 @@
+#include "HYMLS_MainUtils.hpp"
+
+#include <Teuchos_RCP.hpp>
+#include <Teuchos_ParameterList.hpp>
+
+#include <Epetra_MpiComm.h>
+#include <Epetra_Map.h>
+#include <Epetra_MultiVector.h>
+#include <Epetra_Vector.h>
+#include <Epetra_CrsMatrix.h>
+
+#include "HYMLS_Exception.hpp"
+#include "HYMLS_Macros.hpp"
+
+#include "HYMLS_UnitTests.hpp"
+
+#include <cstdio>
+#include <fstream>
+
+#include <unistd.h>
+
+Teuchos::RCP<Epetra_Map> createLaplaceMap(
+  Teuchos::RCP<Teuchos::ParameterList> &params,
+  Teuchos::RCP<Epetra_Comm> const &comm)
+  {
+  Teuchos::ParameterList &problemList = params->sublist("Problem");
+  problemList.set("Equations", "Laplace");
+  problemList.set("Dimension", 2);
+  problemList.set("Degrees of Freedom", 1);
+  problemList.set("nx", 8);
+  problemList.set("ny", 8);
+  problemList.set("nz", 1);
+
+  params->sublist("Preconditioner").set("Separator Length", 4);
+
+  return HYMLS::MainUtils::create_map(*comm, params);
+  }
+
+TEUCHOS_UNIT_TEST(MainUtils, BinaryMatrix)
+  {
+  Teuchos::RCP<Epetra_MpiComm> comm = Teuchos::rcp(new Epetra_MpiComm(MPI_COMM_WORLD));
+  DISABLE_OUTPUT;
+
+  Teuchos::RCP<Teuchos::ParameterList> params = Teuchos::rcp(new Teuchos::ParameterList());
+  Teuchos::RCP<Epetra_Map> map = createLaplaceMap(params, comm);
+
+  Teuchos::ParameterList galeriList;
+  Teuchos::RCP<Epetra_CrsMatrix> A = HYMLS::MainUtils::create_matrix(*map,
+    params->sublist("Problem"), "", galeriList);
+
+  TEST_EQUALITY(HYMLS::MainUtils::write_matrix(*A, ".", "binary_matrix"), 0);
+
+  Teuchos::RCP<Epetra_CrsMatrix> B = HYMLS::MainUtils::read_matrix(".", "Binary",
+    map, "binary_matrix");
+
+  comm->Barrier();
+  if (comm->MyPID() == 0)
+    std::remove("./binary_matrix.bin");
+
+  TEST_EQUALITY(B->NumGlobalNonzeros64(), A->NumGlobalNonzeros64());
+  TEST_ASSERT(B->RowMap().SameAs(A->RowMap()));
+
+  Epetra_MultiVector X(*map, 2);
+  X.Random();
+
+  Epetra_MultiVector AX(*map, 2);
+  Epetra_MultiVector BX(*map, 2);
+  CHECK_ZERO(A->Multiply(false, X, AX));
+  CHECK_ZERO(B->Multiply(false, X, BX));
+
+  TEST_COMPARE(HYMLS::UnitTests::NormInfAminusB(AX, BX), <, 1e-14);
+  }
+
+TEUCHOS_UNIT_TEST(MainUtils, BinaryVector)
+  {
+  Teuchos::RCP<Epetra_MpiComm> comm = Teuchos::rcp(new Epetra_MpiComm(MPI_COMM_WORLD));
+  DISABLE_OUTPUT;
+
+  Teuchos::RCP<Teuchos::ParameterList> params = Teuchos::rcp(new Teuchos::ParameterList());
+  Teuchos::RCP<Epetra_Map> map = createLaplaceMap(params, comm);
+
+  Epetra_Vector x(*map);
+  x.Random();
+
+  TEST_EQUALITY(HYMLS::MainUtils::write_vector(x, "binary_vector", "."), 0);
+
+  Teuchos::RCP<Epetra_Vector> y = HYMLS::MainUtils::read_vector("binary_vector", ".",
+    "Binary", map);
+
+  comm->Barrier();
+  if (comm->MyPID() == 0)
+    std::remove("./binary_vector.bin");
+
+  TEST_COMPARE(HYMLS::UnitTests::NormInfAminusB(x, *y), ==, 0.0);
+  }
+
+TEUCHOS_UNIT_TEST(MainUtils, TruncatedBinaryMatrix)
+  {
+  Teuchos::RCP<Epetra_MpiComm> comm = Teuchos::rcp(new Epetra_MpiComm(MPI_COMM_WORLD));
+  DISABLE_OUTPUT;
+
+  Teuchos::RCP<Teuchos::ParameterList> params = Teuchos::rcp(new Teuchos::ParameterList());
+  Teuchos::RCP<Epetra_Map> map = createLaplaceMap(params, comm);
+
+  Teuchos::ParameterList galeriList;
+  Teuchos::RCP<Epetra_CrsMatrix> A = HYMLS::MainUtils::create_matrix(*map,
+    params->sublist("Problem"), "", galeriList);
+
+  TEST_EQUALITY(HYMLS::MainUtils::write_matrix(*A, ".", "truncated_matrix"), 0);
+
+  // cut off the values at the end, so only the last ranks read too little
+  comm->Barrier();
+  if (comm->MyPID() == 0)
+    {
+    std::ifstream ifs("./truncated_matrix.bin", std::ios::binary | std::ios::ate);
+    long long size = ifs.tellg();
+    ifs.close();
+    CHECK_ZERO(truncate("./truncated_matrix.bin", size - sizeof(double)));
+    }
+  comm->Barrier();
+
+  // this should fail on all ranks instead of hanging
+  TEST_THROW(HYMLS::MainUtils::read_matrix(".", "Binary", map, "truncated_matrix"),
+    HYMLS::Exception);
+
+  comm->Barrier();
+  if (comm->MyPID() == 0)
+    std::remove("./truncated_matrix.bin");
+  }
+
+TEUCHOS_UNIT_TEST(MainUtils, CorruptBinaryRowPointer)
+  {
+  Teuchos::RCP<Epetra_MpiComm> comm = Teuchos::rcp(new Epetra_MpiComm(MPI_COMM_WORLD));
+  DISABLE_OUTPUT;
+
+  Teuchos::RCP<Teuchos::ParameterList> params = Teuchos::rcp(new Teuchos::ParameterList());
+  Teuchos::RCP<Epetra_Map> map = createLaplaceMap(params, comm);
+
+  Teuchos::ParameterList galeriList;
+  Teuchos::RCP<Epetra_CrsMatrix> A = HYMLS::MainUtils::create_matrix(*map,
+    params->sublist("Problem"), "", galeriList);
+
+  TEST_EQUALITY(HYMLS::MainUtils::write_matrix(*A, ".", "corrupt_matrix"), 0);
+
+  // Overwrite a row pointer in the middle with a huge value, so only the
+  // ranks that read that row would try to allocate too much. The row
+  // pointers follow the 40 byte header.
+  comm->Barrier();
+  if (comm->MyPID() == 0)
+    {
+    std::fstream fs("./corrupt_matrix.bin",
+      std::ios::binary | std::ios::in | std::ios::out);
+    long long rowPtr = 1LL << 50;
+    fs.seekp(40 + (map->NumGlobalElements64() / 2) * sizeof(long long));
+    fs.write(reinterpret_cast<const char *>(&rowPtr), sizeof(rowPtr));
+    fs.close();
+    }
+  comm->Barrier();
+
+  // this should fail on all ranks instead of hanging
+  TEST_THROW(HYMLS::MainUtils::read_matrix(".", "Binary", map, "corrupt_matrix"),
+    HYMLS::Exception);
+
+  comm->Barrier();
+  if (comm->MyPID() == 0)
+    std::remove("./corrupt_matrix.bin");
+  }
@@ -1261,3 +1261,76 @@ TEUCHOS_UNIT_TEST_INST(OverlappingPartitioner, SkewStokes3D, 1, 8, 8, 8, 4, 4, 4
 TEUCHOS_UNIT_TEST_INST(OverlappingPartitioner, SkewStokes3D, 2, 16, 16, 16, 4, 4, 4);
 TEUCHOS_UNIT_TEST_INST(OverlappingPartitioner, SkewStokes3D, 3, 16, 8, 8, 4, 4, 4);
 TEUCHOS_UNIT_TEST_INST(OverlappingPartitioner, SkewStokes3D, 4, 16, 16, 16, 8, 8, 8);
+
+TEUCHOS_UNIT_TEST(OverlappingPartitioner, InteriorMapOrdering)
+  {
+  Teuchos::RCP<Epetra_MpiComm> Comm = Teuchos::rcp(new Epetra_MpiComm(MPI_COMM_WORLD));
+
+  DISABLE_OUTPUT;
+
+  Teuchos::RCP<Teuchos::ParameterList> paramList = Teuchos::rcp(new Teuchos::ParameterList);
+  Teuchos::ParameterList &problemList = paramList->sublist("Problem");
+  problemList.set("nx", 16);
+  problemList.set("ny", 16);
+  problemList.set("nz", 1);
+
+  problemList.set("Dimension", 2);
+  problemList.set("Degrees of Freedom", 1);
+
+  Teuchos::ParameterList &solverList = paramList->sublist("Preconditioner");
+  solverList.set("Separator Length", 4);
+  solverList.set("Coarsening Factor", 2);
+
+  Teuchos::RCP<HYMLS::CartesianPartitioner> part = Teuchos::rcp(
+    new HYMLS::CartesianPartitioner(Teuchos::null, paramList, *Comm));
+  part->Partition(true);
+  Teuchos::RCP<const Epetra_Map> map = part->GetMap();
+  HYMLS::OverlappingPartitioner opart(map, paramList, 0);
+
+  ENABLE_OUTPUT;
+
+  // The interior nodes of each subdomain must be one contiguous range in the
+  // interior map, in the order of the interior group
+  Teuchos::RCP<const Epetra_Map> interiorMap =
+    opart.Spawn(HYMLS::HierarchicalMap::Interior)->GetMap();
+  int pos = 0;
+  for (int sd = 0; sd < opart.NumMySubdomains(); sd++)
+    {
+    HYMLS::InteriorGroup const &group = opart.GetInteriorGroup(sd);
+    for (hymls_gidx gid: group.nodes())
+      {
+      TEST_EQUALITY(interiorMap->GID64(pos++), gid);
+      }
+    }
+  TEST_EQUALITY(pos, interiorMap->NumMyElements());
+  }
+
+TEUCHOS_UNIT_TEST(OverlappingPartitioner, CacheKey)
+  {
+  Teuchos::RCP<Epetra_MpiComm> Comm = Teuchos::rcp(new Epetra_MpiComm(MPI_COMM_WORLD));
+
+  Teuchos::ParameterList params;
+  Teuchos::ParameterList &problemList = params.sublist("Problem");
+  problemList.set("nx", 8);
+  problemList.set("ny", 8);
+  problemList.set("Dimension", 2);
+  problemList.set("Degrees of Freedom", 3);
+  problemList.sublist("Variable 2").set("Variable Type", "Pressure");
+  params.sublist("Preconditioner").set("Separator Length", 4);
+
+  Epetra_Map map(192, 0, *Comm);
+  std::string key = HYMLS::OverlappingPartitioner::CacheKey(map, params);
+
+  // parameters that the partitioner does not read do not matter
+  params.sublist("Preconditioner").set("Number of Levels", 3);
+  params.sublist("Preconditioner").sublist("Coarse Solver").set("Amesos Solver", "Klu");
+  TEST_EQUALITY(HYMLS::OverlappingPartitioner::CacheKey(map, params), key);
+
+  // but the variable types and the retained nodes per level do
+  problemList.sublist("Variable 2").set("Variable Type", "Laplace");
+  std::string newKey = HYMLS::OverlappingPartitioner::CacheKey(map, params);
+  TEST_INEQUALITY(newKey, key);
+
+  params.sublist("Preconditioner").set("Retain Nodes at Level 1", 2);
+  TEST_INEQUALITY(HYMLS::OverlappingPartitioner::CacheKey(map, params), newKey);
+  }
@@ -2,6 +2,7 @@
 
 #include <Teuchos_RCP.hpp>
 #include <Teuchos_ParameterList.hpp>
+#include <Teuchos_toString.hpp>
 
 #include <Epetra_SerialComm.h>
 #include <Epetra_MpiComm.h>
@@ -12,10 +13,17 @@
 #include <Epetra_Import.h>
 #include <Epetra_SerialDenseMatrix.h>
 
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
 #include "HYMLS_Macros.hpp"
 #include "HYMLS_DenseUtils.hpp"
 #include "HYMLS_MatrixBlock.hpp"
+#include "HYMLS_MultiVectorPool.hpp"
+#include "HYMLS_OverlappingPartitioner.hpp"
 #include "HYMLS_SchurComplement.hpp"
+#include "HYMLS_Tools.hpp"
 #include "HYMLS_CartesianPartitioner.hpp"
 #include "HYMLS_SkewCartesianPartitioner.hpp"
 
@@ -47,6 +55,8 @@ public:
     HYMLS::Preconditioner(A, params)
     {}
 
+  using HYMLS::Preconditioner::Partitioner;
+
   Epetra_CrsMatrix const &A22()
     {
     return *A22_->Block();
@@ -61,6 +71,12 @@ public:
     {
     return V_;
     }
+
+  Epetra_CrsMatrix &NonconstMatrix()
+    {
+    return const_cast<Epetra_CrsMatrix &>(
+      dynamic_cast<Epetra_CrsMatrix const &>(*matrix_));
+    }
   };
 
 Teuchos::RCP<TestablePreconditioner> createPreconditioner(
@@ -376,3 +392,215 @@ TEUCHOS_UNIT_TEST(Preconditioner, BorderedApplyInverse)
   TEST_COMPARE(HYMLS::UnitTests::NormInfAminusB(*X, *X_EX), <, 1e-10);
   TEST_COMPARE(HYMLS::UnitTests::NormInfAminusB(*X2, *X_EX2), <, 1e-10);
   }
+
+#ifdef HYMLS_USE_OPENMP
+// without OpenMP the threaded preconditioner is the serial one
+TEUCHOS_UNIT_TEST(Preconditioner, ThreadedSubdomainSolves)
+  {
+  Teuchos::RCP<Epetra_MpiComm> comm = Teuchos::rcp(new Epetra_MpiComm(MPI_COMM_WORLD));
+  DISABLE_OUTPUT;
+
+  Teuchos::RCP<Teuchos::ParameterList> params = Teuchos::rcp(new Teuchos::ParameterList());
+  Teuchos::RCP<TestablePreconditioner> prec = create2DStokesPreconditioner(params, comm);
+  prec->Initialize();
+  prec->Compute();
+
+  Teuchos::RCP<Teuchos::ParameterList> threadedParams = Teuchos::rcp(new Teuchos::ParameterList());
+  threadedParams->sublist("Preconditioner").set("Subdomain Solver Num Threads", 4);
+  Teuchos::RCP<TestablePreconditioner> threadedPrec = create2DStokesPreconditioner(threadedParams, comm);
+  threadedPrec->Initialize();
+  threadedPrec->Compute();
+
+  Epetra_Map const &map = prec->OperatorRangeMap();
+  Epetra_MultiVector B(map, 3);
+  B.Random();
+
+  Epetra_MultiVector X(map, 3);
+  Epetra_MultiVector threadedX(map, 3);
+  TEST_EQUALITY(prec->ApplyInverse(B, X), 0);
+  TEST_EQUALITY(threadedPrec->ApplyInverse(B, threadedX), 0);
+
+  // The subdomain solves are independent, so the results should be bitwise identical
+  TEST_EQUALITY(HYMLS::UnitTests::NormInfAminusB(X, threadedX), 0.0);
+  }
+#endif
+
+TEUCHOS_UNIT_TEST(Preconditioner, ApplyInverseWorkspace)
+  {
+  Teuchos::RCP<Epetra_MpiComm> comm = Teuchos::rcp(new Epetra_MpiComm(MPI_COMM_WORLD));
+  DISABLE_OUTPUT;
+
+  Teuchos::RCP<Teuchos::ParameterList> params = Teuchos::rcp(new Teuchos::ParameterList());
+  Teuchos::RCP<TestablePreconditioner> prec = createPreconditioner(params, comm);
+  prec->Initialize();
+  prec->Compute();
+
+  Epetra_Map const &map = prec->OperatorRangeMap();
+  Epetra_MultiVector b(map, 1), x1(map, 1), x2(map, 1);
+  Epetra_MultiVector b3(map, 3), x3(map, 3);
+  b.Random();
+  b3.Random();
+
+  prec->ApplyInverse(b, x1);
+  prec->ApplyInverse(b3, x3);
+  long long allocations = HYMLS::MultiVectorPool::NumAllocations();
+
+  // the workspace for both numbers of vectors is reused
+  for (int i = 0; i < 3; i++)
+    {
+    prec->ApplyInverse(b, x2);
+    prec->ApplyInverse(b3, x3);
+    TEST_EQUALITY(HYMLS::MultiVectorPool::NumAllocations(), allocations);
+    }
+
+  // and does not change the result
+  TEST_COMPARE(HYMLS::UnitTests::NormInfAminusB(x1, x2), <, 1e-12);
+
+  // the count is reported with the timings
+  std::ostringstream ss;
+  HYMLS::Tools::PrintTiming(ss);
+  TEST_INEQUALITY(ss.str().find("Workspace vectors allocated: " +
+      Teuchos::toString(allocations) + "\n"), std::string::npos);
+  }
+
+TEUCHOS_UNIT_TEST(Preconditioner, AsynchronousCommunication)
+  {
+  Teuchos::RCP<Epetra_MpiComm> comm = Teuchos::rcp(new Epetra_MpiComm(MPI_COMM_WORLD));
+  DISABLE_OUTPUT;
+
+  Teuchos::RCP<Teuchos::ParameterList> params = Teuchos::rcp(new Teuchos::ParameterList());
+  Teuchos::RCP<TestablePreconditioner> prec = create2DStokesPreconditioner(params, comm);
+  prec->Initialize();
+  prec->Compute();
+
+  Teuchos::RCP<Teuchos::ParameterList> asyncParams = Teuchos::rcp(new Teuchos::ParameterList());
+  asyncParams->sublist("Preconditioner").set("Asynchronous Communication", true);
+  Teuchos::RCP<TestablePreconditioner> asyncPrec = create2DStokesPreconditioner(asyncParams, comm);
+  asyncPrec->Initialize();
+  asyncPrec->Compute();
+
+  Epetra_Map const &map = prec->OperatorRangeMap();
+  Epetra_MultiVector B(map, 3);
+  B.Random();
+
+  Epetra_MultiVector X(map, 3);
+  Epetra_MultiVector asyncX(map, 3);
+  TEST_EQUALITY(prec->ApplyInverse(B, X), 0);
+  TEST_EQUALITY(asyncPrec->ApplyInverse(B, asyncX), 0);
+
+  // only the order in which the received values are added may differ
+  TEST_COMPARE(HYMLS::UnitTests::NormInfAminusB(X, asyncX), <, 1e-12);
+
+  // and the pending transfers are finished, so we can apply it again
+  TEST_EQUALITY(asyncPrec->ApplyInverse(B, asyncX), 0);
+  TEST_COMPARE(HYMLS::UnitTests::NormInfAminusB(X, asyncX), <, 1e-12);
+  }
+
+TEUCHOS_UNIT_TEST(Preconditioner, RecomputeWithNewValues)
+  {
+  Teuchos::RCP<Epetra_MpiComm> comm = Teuchos::rcp(new Epetra_MpiComm(MPI_COMM_WORLD));
+  DISABLE_OUTPUT;
+
+  Teuchos::RCP<Teuchos::ParameterList> params = Teuchos::rcp(new Teuchos::ParameterList());
+  Teuchos::RCP<TestablePreconditioner> prec = create2DStokesPreconditioner(params, comm);
+  prec->Initialize();
+  prec->Compute();
+
+  // Change the values but not the pattern, so only the values of the
+  // reordered matrix and the blocks are refreshed
+  CHECK_ZERO(prec->NonconstMatrix().Scale(2.0));
+  TEST_EQUALITY(prec->Compute(), 0);
+
+  Teuchos::RCP<Teuchos::ParameterList> newParams = Teuchos::rcp(new Teuchos::ParameterList());
+  Teuchos::RCP<TestablePreconditioner> newPrec = create2DStokesPreconditioner(newParams, comm);
+  CHECK_ZERO(newPrec->NonconstMatrix().Scale(2.0));
+  newPrec->Initialize();
+  newPrec->Compute();
+
+  Epetra_Map const &map = prec->OperatorRangeMap();
+  Epetra_MultiVector B(map, 2);
+  B.Random();
+
+  Epetra_MultiVector X(map, 2);
+  Epetra_MultiVector newX(map, 2);
+  TEST_EQUALITY(prec->ApplyInverse(B, X), 0);
+  TEST_EQUALITY(newPrec->ApplyInverse(B, newX), 0);
+
+  TEST_COMPARE(HYMLS::UnitTests::NormInfAminusB(X, newX), <, 1e-10);
+  }
+
+TEUCHOS_UNIT_TEST(Preconditioner, SaveAndLoad)
+  {
+  Teuchos::RCP<Epetra_MpiComm> comm = Teuchos::rcp(new Epetra_MpiComm(MPI_COMM_WORLD));
+  DISABLE_OUTPUT;
+
+  Teuchos::RCP<Teuchos::ParameterList> params = Teuchos::rcp(new Teuchos::ParameterList());
+  Teuchos::RCP<TestablePreconditioner> prec = create2DStokesPreconditioner(params, comm);
+  TEST_COMPARE(prec->Save("SaveAndLoad.hid"), !=, 0);
+  prec->Initialize();
+  prec->Compute();
+  TEST_EQUALITY(prec->Save("SaveAndLoad.hid"), 0);
+
+  Teuchos::RCP<Teuchos::ParameterList> newParams = Teuchos::rcp(new Teuchos::ParameterList());
+  Teuchos::RCP<TestablePreconditioner> newPrec = create2DStokesPreconditioner(newParams, comm);
+  TEST_EQUALITY(newPrec->Load("NonExistent.hid"), -1);
+  TEST_EQUALITY(newPrec->Load("SaveAndLoad.hid"), 0);
+  TEST_EQUALITY(newPrec->Initialize(), 0);
+  TEST_EQUALITY(newPrec->Compute(), 0);
+
+  // the time it took to partition all levels is kept with the partitioning
+  TEST_COMPARE(prec->Partitioner().PartitionTime(), >, 0.0);
+  TEST_EQUALITY(newPrec->Partitioner().PartitionTime(),
+    prec->Partitioner().PartitionTime());
+
+  std::remove(("SaveAndLoad.hid." + Teuchos::toString(comm->MyPID())).c_str());
+
+  // the loaded partitioning should give exactly the same preconditioner
+  Epetra_Map const &map = prec->OperatorRangeMap();
+  Epetra_MultiVector B(map, 2);
+  B.Random();
+
+  Epetra_MultiVector X(map, 2);
+  Epetra_MultiVector newX(map, 2);
+  TEST_EQUALITY(prec->ApplyInverse(B, X), 0);
+  TEST_EQUALITY(newPrec->ApplyInverse(B, newX), 0);
+
+  TEST_COMPARE(HYMLS::UnitTests::NormInfAminusB(X, newX), <, 1e-12);
+  }
+
+TEUCHOS_UNIT_TEST(Preconditioner, PartitionCache)
+  {
+  Teuchos::RCP<Epetra_MpiComm> comm = Teuchos::rcp(new Epetra_MpiComm(MPI_COMM_WORLD));
+  DISABLE_OUTPUT;
+
+  Teuchos::RCP<Teuchos::ParameterList> params = Teuchos::rcp(new Teuchos::ParameterList());
+  params->sublist("Preconditioner").set("Partition Cache Directory", ".");
+  Teuchos::RCP<TestablePreconditioner> prec = create2DStokesPreconditioner(params, comm);
+  prec->Initialize();
+  prec->Compute();
+
+  Teuchos::RCP<Teuchos::ParameterList> newParams = Teuchos::rcp(new Teuchos::ParameterList());
+  newParams->sublist("Preconditioner").set("Partition Cache Directory", ".");
+  Teuchos::RCP<TestablePreconditioner> newPrec = create2DStokesPreconditioner(newParams, comm);
+
+  // the first preconditioner should have written the file with this key
+  std::string filename = "./partition_" + HYMLS::OverlappingPartitioner::CacheKey(
+    newPrec->OperatorRangeMap(), *newParams) + "." + Teuchos::toString(comm->MyPID());
+  TEST_ASSERT(std::ifstream(filename.c_str()).good());
+
+  TEST_EQUALITY(newPrec->Initialize(), 0);
+  TEST_EQUALITY(newPrec->Compute(), 0);
+
+  std::remove(filename.c_str());
+
+  Epetra_Map const &map = prec->OperatorRangeMap();
+  Epetra_MultiVector B(map, 2);
+  B.Random();
+
+  Epetra_MultiVector X(map, 2);
+  Epetra_MultiVector newX(map, 2);
+  TEST_EQUALITY(prec->ApplyInverse(B, X), 0);
+  TEST_EQUALITY(newPrec->ApplyInverse(B, newX), 0);
+
+  TEST_COMPARE(HYMLS::UnitTests::NormInfAminusB(X, newX), <, 1e-12);
+  }
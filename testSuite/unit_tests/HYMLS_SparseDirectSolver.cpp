@@ -3,9 +3,13 @@
 #include "Epetra_SerialComm.h"
 #include "Epetra_Map.h"
 #include "Epetra_CrsMatrix.h"
+#include "Epetra_MultiVector.h"
+#include "Epetra_Vector.h"
 
 #include "GaleriExt_Stokes2D.h"
 
+#include <cmath>
+
 #include "HYMLS_Macros.hpp"
 #include "HYMLS_MatrixUtils.hpp"
 #include "HYMLS_UnitTests.hpp"
@@ -150,3 +154,164 @@ TEUCHOS_UNIT_TEST(SparseDirectSolver, CustomOrdering)
 
   TEST_EQUALITY(solver->NumGlobalNonzerosL(), 2033); // 2134 in the paper
   }
+
+TEUCHOS_UNIT_TEST(SparseDirectSolver, ReuseSymbolicFactorization)
+  {
+  DISABLE_OUTPUT;
+  Teuchos::RCP<Epetra_CrsMatrix> A = createStokesMatrix(5);
+  Teuchos::RCP<HYMLS::SparseDirectSolver> solver =
+    Teuchos::rcp(new HYMLS::SparseDirectSolver(A.get()));
+
+  Teuchos::ParameterList params;
+  params.set("Reuse Symbolic Factorization", true);
+
+  CHECK_ZERO(solver->SetParameters(params));
+  CHECK_ZERO(solver->Initialize());
+  CHECK_ZERO(solver->Compute());
+
+  int nnzL = solver->NumGlobalNonzerosL();
+  int numReuse = solver->NumSymbolicReuse();
+
+  // Change the values but not the pattern, and refactor
+  Epetra_Vector diag(A->RowMap());
+  CHECK_ZERO(A->ExtractDiagonalCopy(diag));
+  for (int i = 0; i < diag.MyLength(); i++)
+    diag[i] *= 1.5;
+  CHECK_ZERO(A->ReplaceDiagonalValues(diag));
+  CHECK_ZERO(A->Scale(2.0));
+  CHECK_ZERO(solver->Compute());
+
+  TEST_EQUALITY(solver->NumSymbolicReuse(), numReuse + 1);
+  TEST_EQUALITY(solver->NumGlobalNonzerosL(), nnzL);
+
+  Epetra_MultiVector X_EX(A->RowMap(), 2);
+  Epetra_MultiVector X(A->RowMap(), 2);
+  Epetra_MultiVector B(A->RowMap(), 2);
+  X_EX.Random();
+  CHECK_ZERO(A->Multiply(false, X_EX, B));
+
+  CHECK_ZERO(solver->ApplyInverse(B, X));
+  TEST_COMPARE(HYMLS::UnitTests::NormInfAminusB(X, X_EX), <, 1e-10);
+  }
+
+TEUCHOS_UNIT_TEST(SparseDirectSolver, SparseRightHandSides)
+  {
+  DISABLE_OUTPUT;
+  Teuchos::RCP<Epetra_CrsMatrix> A = createStokesMatrix(5);
+  Teuchos::RCP<HYMLS::SparseDirectSolver> solver =
+    Teuchos::rcp(new HYMLS::SparseDirectSolver(A.get()));
+
+  Teuchos::ParameterList params;
+  params.set("Sparse Right-hand Sides", true);
+
+  CHECK_ZERO(solver->SetParameters(params));
+  CHECK_ZERO(solver->Initialize());
+  CHECK_ZERO(solver->Compute());
+
+  TEST_ASSERT(solver->HasSparseApplyInverse());
+
+  // right-hand sides with two nonzeros each
+  int n = A->NumMyRows();
+  int nvec = 3;
+  Epetra_MultiVector B(A->RowMap(), nvec);
+  Teuchos::Array<int> Bp(nvec + 1), Bi(2 * nvec);
+  Teuchos::Array<double> Bx(2 * nvec);
+  for (int k = 0; k < nvec; k++)
+    {
+    Bp[k] = 2 * k;
+    Bi[2 * k] = 7 * k + 1;
+    Bi[2 * k + 1] = n - 5 * k - 1;
+    Bx[2 * k] = 1.0 + k;
+    Bx[2 * k + 1] = -2.0;
+    B[k][Bi[2 * k]] = Bx[2 * k];
+    B[k][Bi[2 * k + 1]] = Bx[2 * k + 1];
+    }
+  Bp[nvec] = 2 * nvec;
+
+  Epetra_MultiVector X(A->RowMap(), nvec);
+  CHECK_ZERO(solver->ApplyInverse(B, X));
+
+  // only compute every third row of the solution
+  Teuchos::Array<int> rows;
+  for (int i = 0; i < n; i += 3)
+    rows.append(i);
+  int nrows = rows.size();
+  Teuchos::Array<double> Xs(nrows * nvec);
+  CHECK_ZERO(solver->ApplyInverseSparse(nvec, &Bp[0], &Bi[0], &Bx[0],
+      nrows, &rows[0], &Xs[0], nrows));
+
+  double err = 0.0;
+  for (int k = 0; k < nvec; k++)
+    for (int t = 0; t < nrows; t++)
+      err = std::max(err, std::abs(Xs[k * nrows + t] - X[k][rows[t]]));
+  TEST_COMPARE(err, <, 1e-10);
+  }
+
+TEUCHOS_UNIT_TEST(SparseDirectSolver, SinglePrecisionFactors)
+  {
+  DISABLE_OUTPUT;
+  Teuchos::RCP<Epetra_CrsMatrix> A = createStokesMatrix(5);
+  Teuchos::RCP<HYMLS::SparseDirectSolver> solver =
+    Teuchos::rcp(new HYMLS::SparseDirectSolver(A.get()));
+
+  Teuchos::ParameterList params;
+  params.set("Single Precision Factors", true);
+  params.set("Refinement Steps", 3);
+
+  CHECK_ZERO(solver->SetParameters(params));
+  CHECK_ZERO(solver->Initialize());
+  CHECK_ZERO(solver->Compute());
+
+  TEST_ASSERT(solver->HasSingleFactors());
+
+  Epetra_MultiVector X_EX(A->RowMap(), 2);
+  Epetra_MultiVector X(A->RowMap(), 2);
+  Epetra_MultiVector B(A->RowMap(), 2);
+  X_EX.Random();
+
+  CHECK_ZERO(A->Multiply(false, X_EX, B));
+  CHECK_ZERO(solver->ApplyInverse(B, X));
+  TEST_COMPARE(HYMLS::UnitTests::NormInfAminusB(X, X_EX), <, 1e-10);
+
+  // the transposed solve uses the same factors
+  CHECK_ZERO(A->Multiply(true, X_EX, B));
+  CHECK_ZERO(solver->SetUseTranspose(true));
+  CHECK_ZERO(solver->ApplyInverse(B, X));
+  TEST_COMPARE(HYMLS::UnitTests::NormInfAminusB(X, X_EX), <, 1e-10);
+  }
+
+TEUCHOS_UNIT_TEST(SparseDirectSolver, SinglePrecisionFactorsReuseSymbolic)
+  {
+  DISABLE_OUTPUT;
+  Teuchos::RCP<Epetra_CrsMatrix> A = createStokesMatrix(5);
+  Teuchos::RCP<HYMLS::SparseDirectSolver> solver =
+    Teuchos::rcp(new HYMLS::SparseDirectSolver(A.get()));
+
+  Teuchos::ParameterList params;
+  params.set("Single Precision Factors", true);
+  params.set("Refinement Steps", 3);
+  params.set("Reuse Symbolic Factorization", true);
+
+  CHECK_ZERO(solver->SetParameters(params));
+  CHECK_ZERO(solver->Initialize());
+  CHECK_ZERO(solver->Compute());
+
+  int numReuse = solver->NumSymbolicReuse();
+
+  // Change the values but not the pattern. The double precision factors
+  // were freed, so this factors again with the stored ordering.
+  CHECK_ZERO(A->Scale(2.0));
+  CHECK_ZERO(solver->Compute());
+
+  TEST_EQUALITY(solver->NumSymbolicReuse(), numReuse + 1);
+  TEST_ASSERT(solver->HasSingleFactors());
+
+  Epetra_MultiVector X_EX(A->RowMap(), 2);
+  Epetra_MultiVector X(A->RowMap(), 2);
+  Epetra_MultiVector B(A->RowMap(), 2);
+  X_EX.Random();
+
+  CHECK_ZERO(A->Multiply(false, X_EX, B));
+  CHECK_ZERO(solver->ApplyInverse(B, X));
+  TEST_COMPARE(HYMLS::UnitTests::NormInfAminusB(X, X_EX), <, 1e-10);
+  }
@@ -4,8 +4,19 @@
 #include "Epetra_Map.h"
 #include "Epetra_SerialComm.h"
 
+#include "Teuchos_toString.hpp"
+#include "Teuchos_GlobalMPISession.hpp"
+
 #include "HYMLS_UnitTests.hpp"
 
+#include <sstream>
+#include <fstream>
+#include <cstdio>
+
+#ifdef HYMLS_USE_OPENMP
+#include <omp.h>
+#endif
+
 // A class for which we can set the number of processors that are available.
 class SplitBoxComm : public Epetra_SerialComm {
     int numProc_;
@@ -53,3 +64,147 @@ TEUCHOS_UNIT_TEST(Tools, SplitBox)
   TEST_EQUALITY(ny, 5);
   TEST_EQUALITY(nz, 5);
   }
+
+TEUCHOS_UNIT_TEST(Tools, TimerRegistry)
+  {
+  HYMLS::TimerSite site;
+  std::string label = "TimerRegistry";
+
+  int id0 = site.Id(label, "test", 0);
+  int id1 = site.Id(label, "test", 1);
+  TEST_INEQUALITY(id0, id1);
+  TEST_EQUALITY(site.Id(label, "test", 0), id0);
+  TEST_EQUALITY(site.Id("TimerRegistry", std::string("test"), 1), id1);
+  TEST_EQUALITY(HYMLS::Tools::TimerLabel(id0), "TimerRegistry_L0: test");
+  TEST_EQUALITY(HYMLS::Tools::TimerLabel(id1), "TimerRegistry_L1: test");
+
+  // a label that was seen before gets the same id
+  TEST_EQUALITY(HYMLS::Tools::RegisterTimer("TimerRegistry_L1: test"), id1);
+
+  // a label that changes in place, e.g. the label_ of another object
+  // at the same address, gets its own timer
+  std::string objectLabel = "TimerRegistryA";
+  int idA = site.Id(objectLabel, "test", 0);
+  objectLabel[objectLabel.size() - 1] = 'B';
+  int idB = site.Id(objectLabel, "test", 0);
+  TEST_INEQUALITY(idA, idB);
+  TEST_EQUALITY(HYMLS::Tools::TimerLabel(idA), "TimerRegistryA_L0: test");
+  TEST_EQUALITY(HYMLS::Tools::TimerLabel(idB), "TimerRegistryB_L0: test");
+
+  // more labels than fit in the cache of a call site
+  for (int lev = 0; lev < 40; lev++)
+    {
+    int id = site.Id(label, "test", lev);
+    TEST_EQUALITY(site.Id(label, "test", lev), id);
+    TEST_EQUALITY(HYMLS::Tools::TimerLabel(id),
+      "TimerRegistry_L" + Teuchos::toString(lev) + ": test");
+    }
+
+  // timers are only counted if the I/O is initialized
+  HYMLS::Tools::out();
+  for (int i = 0; i < 3; i++)
+    {
+    HYMLS::TimerObject timer(id1, false);
+    }
+
+  std::ostringstream ss;
+  HYMLS::Tools::PrintTiming(ss);
+  std::istringstream lines(ss.str());
+  std::string line;
+  bool found = false;
+  while (std::getline(lines, line))
+    {
+    std::istringstream words(line);
+    std::string name, level, ncalls;
+    words >> name >> level >> ncalls;
+    if (name == "TimerRegistry_L1:")
+      {
+      found = true;
+      TEST_EQUALITY(ncalls, "3");
+      }
+    }
+  TEST_EQUALITY(found, true);
+  }
+
+TEUCHOS_UNIT_TEST(Tools, WriteTrace)
+  {
+  HYMLS::TimerSite site;
+  int id = site.Id("WriteTrace", "test \"quoted\"");
+
+  // timers are only recorded if the I/O is initialized
+  HYMLS::Tools::out();
+
+  // more events than fit in the buffer
+  HYMLS::Tools::StartTrace(4);
+  for (int sd = 0; sd < 6; sd++)
+    {
+    HYMLS::TraceSubdomain traceSd(sd);
+    HYMLS::TimerObject timer(id, false);
+    }
+
+  // all processes write if the timers use a serial communicator
+  int rank = Teuchos::GlobalMPISession::getRank();
+  std::string filename = "trace_test_" + Teuchos::toString(rank) + ".json";
+  HYMLS::Tools::WriteTrace(filename);
+
+  if (rank == 0)
+    {
+    std::ifstream ifs(filename.c_str());
+    std::stringstream ss;
+    ss << ifs.rdbuf();
+    std::string trace = ss.str();
+
+    TEST_EQUALITY(trace.find("{\"displayTimeUnit\":\"ms\",\"traceEvents\":["), 0);
+    TEST_INEQUALITY(trace.find("\"name\":\"WriteTrace: test \\\"quoted\\\"\""), std::string::npos);
+    TEST_INEQUALITY(trace.find("\"subdomain\":5"), std::string::npos);
+    TEST_INEQUALITY(trace.find("\"subdomain\":2"), std::string::npos);
+    TEST_EQUALITY(trace.find("\"subdomain\":1"), std::string::npos);
+    TEST_EQUALITY(trace.substr(trace.size() - 4), "\n]}\n");
+    }
+
+  std::remove(filename.c_str());
+  }
+
+#ifdef HYMLS_USE_OPENMP
+TEUCHOS_UNIT_TEST(Tools, WriteTraceThreads)
+  {
+  HYMLS::TimerSite site;
+  int id = site.Id("WriteTraceThreads", "test");
+
+  // timers are only recorded if the I/O is initialized
+  HYMLS::Tools::out();
+
+  // every thread has its own buffer, so all events fit
+  const int numEvents = 1000;
+  HYMLS::Tools::StartTrace(numEvents);
+#pragma omp parallel for schedule(static)
+  for (int sd = 0; sd < numEvents; sd++)
+    {
+    HYMLS::TraceSubdomain traceSd(sd);
+    HYMLS::TimerObject timer(id, false);
+    }
+
+  int rank = Teuchos::GlobalMPISession::getRank();
+  std::string filename = "trace_threads_test_" + Teuchos::toString(rank) + ".json";
+  HYMLS::Tools::WriteTrace(filename);
+
+  if (rank == 0)
+    {
+    std::ifstream ifs(filename.c_str());
+    std::stringstream ss;
+    ss << ifs.rdbuf();
+    std::string trace = ss.str();
+
+    // every subdomain is in the trace exactly once
+    for (int sd = 0; sd < numEvents; sd++)
+      {
+      std::string event = "\"subdomain\":" + Teuchos::toString(sd) + "}";
+      size_t pos = trace.find(event);
+      TEST_INEQUALITY(pos, std::string::npos);
+      TEST_EQUALITY(trace.find(event, pos + 1), std::string::npos);
+      }
+    }
+
+  std::remove(filename.c_str());
+  }
+#endif